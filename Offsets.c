@@ -17,8 +17,11 @@
 ** Ubuntu systems).
 **
 ** If invoked with the -h option, generates a header file named offsets.h
-** which contains CPP macros for type sizes and the offsets into pcb_t and
-** context_t; otherwise, prints the same information to stdout.
+** which contains CPP macros for type sizes and the offsets into pcb_t,
+** context_t and cpu_t; otherwise, prints the same information to stdout.
+** Each structure's size is also given (e.g., PCB_SIZE), so that the
+** kernel can check at compile time that it agrees with this program
+** about the layout; see process.c and smp.c.
 */
 
 #define SP_KERNEL_SRC
@@ -31,6 +34,7 @@
 #include "process.h"
 #include "stacks.h"
 #include "queues.h"
+#include "smp.h"
 
 #include <stdio.h>
 #include <stddef.h>
@@ -99,6 +103,7 @@ void hsection( char *name, char *typename, size_t size ) {
         sname = name;
         fprintf( hfile, "\n// Offsets into %s\n// Size: %u bytes\n\n",
                 typename, size );
+        process( "SIZE", size );
     } else {
         printf( "Offsets into %s (%u bytes):\n", typename, size );
     }
@@ -172,16 +177,52 @@ int main( int argc, char *argv[] ) {
     hsection( "PCB", "pcb_t", sizeof(pcb_t) );
     process( "context", offsetof(pcb_t,context) );
     process( "stack", offsetof(pcb_t,stack) );
-    process( "wakeup", offsetof(pcb_t,wakeup) );
+    process( "runtime", offsetof(pcb_t,runtime) );
+    process( "systime", offsetof(pcb_t,systime) );
+    process( "readied", offsetof(pcb_t,readied) );
+    process( "top_runtime", offsetof(pcb_t,top_runtime) );
+    process( "top_systime", offsetof(pcb_t,top_systime) );
+    process( "wake", offsetof(pcb_t,wake) );
     process( "exit_status", offsetof(pcb_t,exit_status) );
     process( "pid", offsetof(pcb_t,pid) );
     process( "ppid", offsetof(pcb_t,ppid) );
+    process( "link", offsetof(pcb_t,link) );
+    process( "vruntime", offsetof(pcb_t,vruntime) );
+    process( "deadline", offsetof(pcb_t,deadline) );
+    process( "jobs", offsetof(pcb_t,jobs) );
+    process( "misses", offsetof(pcb_t,misses) );
+    process( "nvcsw", offsetof(pcb_t,nvcsw) );
+    process( "nivcsw", offsetof(pcb_t,nivcsw) );
+    process( "parent", offsetof(pcb_t,parent) );
+    process( "children", offsetof(pcb_t,children) );
+    process( "zombies", offsetof(pcb_t,zombies) );
+    process( "sibling", offsetof(pcb_t,sibling) );
+    process( "prev_sibling", offsetof(pcb_t,prev_sibling) );
+    process( "hnext", offsetof(pcb_t,hnext) );
+    process( "pgdir", offsetof(pcb_t,pgdir) );
+    process( "brk", offsetof(pcb_t,brk) );
+    process( "weight", offsetof(pcb_t,weight) );
+    process( "slot", offsetof(pcb_t,slot) );
+    process( "rt_runtime", offsetof(pcb_t,rt_runtime) );
+    process( "rt_period", offsetof(pcb_t,rt_period) );
+    process( "rt_deadline", offsetof(pcb_t,rt_deadline) );
+    process( "budget", offsetof(pcb_t,budget) );
     process( "state", offsetof(pcb_t,state) );
     process( "priority", offsetof(pcb_t,priority) );
+    process( "base", offsetof(pcb_t,base) );
     process( "quantum",offsetof(pcb_t,quantum) );
     process( "ticks", offsetof(pcb_t,ticks) );
+    process( "sclass", offsetof(pcb_t,sclass) );
+    process( "cpu", offsetof(pcb_t,cpu) );
     process( "filler", offsetof(pcb_t,filler) );
 
+    fputc( '\n', genheader ? hfile : stdout );
+
+    hsection( "CPU", "cpu_t", sizeof(cpu_t) );
+    process( "self", offsetof(cpu_t,self) );
+    process( "current", offsetof(cpu_t,current) );
+    process( "system_esp", offsetof(cpu_t,system_esp) );
+
     if( genheader ) {
         fputs( h_suffix, hfile );
         fclose( hfile );
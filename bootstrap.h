@@ -32,6 +32,10 @@
 #define	GDT_DATA	0x0018		/* All of memory, R/W */
 #define	GDT_STACK	0x0020		/* All of memory, R/W */
 
+	/* only in each CPU's own copy of the GDT (see smp.h) */
+#define	GDT_CPU		0x0028		/* That CPU's cpu_t, R/W */
+#define	GDT_TSS		0x0030		/* That CPU's TSS */
+
 /*
 ** The Interrupt Descriptor Table (0000:2500 - 0000:2D00)
 */
@@ -48,4 +52,12 @@
 #define	MMAP_CODE	0xE820		/* int 0x15 code */
 #define	MMAP_MAGIC_NUM	0x534D4150	/* for 0xE820 interrupt */
 
+/*
+** Application processor startup code (0000:7000 - 0000:7100)
+**
+** The startup IPI starts the other CPUs in real mode at the
+** beginning of a page below 1MB; the code is copied here first.
+*/
+#define	AP_TRAMPOLINE_ADDRESS	0x00007000
+
 #endif
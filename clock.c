@@ -17,6 +17,7 @@
 #include "clock.h"
 #include "process.h"
 #include "queues.h"
+#include "wheel.h"
 #include "scheduler.h"
 #include "sio.h"
 
@@ -24,6 +25,19 @@
 ** PRIVATE DEFINITIONS
 */
 
+// PIT input clock cycles per tick of our clock
+#define CYCLES_PER_TICK     (TIMER_FREQUENCY / CLOCK_FREQUENCY)
+
+#ifdef TICKLESS
+// the longest and shortest intervals we will program into the PIT
+#define CYCLES_MAX          0xffff
+#define CYCLES_MIN          16
+
+// OUT pin state in the read-back status byte (high once a
+// one-shot count has run out)
+#define TIMER_RB_OUTPUT     0x80
+#endif
+
 /*
 ** PRIVATE DATA TYPES
 */
@@ -36,6 +50,21 @@
 static uint32_t _pinwheel;   // pinwheel counter
 static uint32_t _pindex;     // index into pinwheel string
 
+// timer interrupt statistics, split by whether or not the idle
+// process was running when the time passed
+static uint32_t _irqs[2];    // interrupts taken
+static uint32_t _ticks[2];   // ticks elapsed
+
+// TSC rate measurement:  the TSC and the time at the last measurement
+static uint64_t _tsc_mark;
+static time_t _tsc_mark_time;
+
+#ifdef TICKLESS
+// one-shot state
+static uint32_t _armed;      // cycles programmed into the PIT
+static uint32_t _partial;    // cycles elapsed toward the next tick
+#endif
+
 /*
 ** PUBLIC GLOBAL VARIABLES
 */
@@ -43,56 +72,35 @@ static uint32_t _pindex;     // index into pinwheel string
 // current system time
 time_t _system_time;
 
-// we own the sleep queue
-queue_t _sleeping;
+// we own the sleep wheel, and the lock that protects it
+wheel_t _sleeping;
+lock_t _sleep_lock;
+
+// TSC cycles per clock tick
+uint32_t _tsc_per_tick;
 
 /*
 ** PRIVATE FUNCTIONS
 */
 
 /**
-** Name:  _cmp_wakeup
-**
-** Ordering function for the sleep queue
+** Name:  _clk_tick
 **
-** @param v1    First key value to examine
-** @param v2    Second key value to examine
+** Advance the system time, and do the work that is due
 **
-** @return Relationship between the key values:
-**      < 0   v1 < v2
-**      = 0   v1 == v2
-**      > 0   v1 > v2
+** @param n     Number of ticks that have elapsed
 */
-static int _cmp_wakeup( const key_t v1, const key_t v2 ) {
-
-    // QUESTION:  does it make more sense to put this function
-    // somewhere else with a name like "_cmp_uint32", which would
-    // make it more generic and thus usable for other ordered
-    // queues which sort in ascending order by uint32_t values?
-
-    if( v1 < v2 )
-        return( -1 );
-    else if( v1 == v2 )
-        return( 0 );
-    else
-        return( 1 );
-}
+static void _clk_tick( uint32_t n ) {
 
-/**
-** Name:  _clk_isr
-**
-** The ISR for the clock
-**
-** @param vector    Vector number for the clock interrupt
-** @param code      Error code (0 for this interrupt)
-*/
-static void _clk_isr( int vector, int code ) {
+    // charge the time to the idle or the busy column (the process
+    // itself is charged by _clk_slice(), below)
+    _ticks[ _current->priority == Deferred ] += n;
 
     // spin the pinwheel
 
-    ++_pinwheel;
-    if( _pinwheel == (CLOCK_FREQUENCY / 10) ) {
-        _pinwheel = 0;
+    _pinwheel += n;
+    if( _pinwheel >= (CLOCK_FREQUENCY / 10) ) {
+        _pinwheel %= (CLOCK_FREQUENCY / 10);
         ++_pindex;
         __cio_putchar_at( 0, 0, "|/-\\"[ _pindex & 3 ] );
     }
@@ -105,16 +113,23 @@ static void _clk_isr( int vector, int code ) {
     // reporting frequency, in seconds.
 
     uint32_t counts[ N_STATES ];
+    uint32_t rq[3] = { 0, 0, 0 };
+
+    // (report if any of the ticks we are covering is at the start
+    // of a reporting period)
+    uint32_t period = SEC_TO_TICKS(STATUS);
 
-    if( (_system_time % SEC_TO_TICKS(STATUS)) == 0 ) {
-        int32_t n = _pcount( counts );
+    if( ((_system_time + n - 1) / period) * period >= _system_time ) {
+        int32_t nprocs = _pcount( counts );
+        for( uint32_t i = 0; i < _n_cpus; ++i ) {
+            _sched_ready_bands( &_cpus[i], rq );
+        }
         __cio_printf_at( 2, 0,
             "%3d procs: n/%d r/%d R/%d s/%d b/%d w/%d k/%d z/%d  RQ[%d,%d,%d]",
-            n, counts[New],      counts[Ready],   counts[Running],
+            nprocs, counts[New],      counts[Ready],   counts[Running],
                counts[Sleeping], counts[Blocked], counts[Waiting],
                counts[Killed],   counts[Zombie],
-            _queue_length(_ready[System]),  _queue_length(_ready[User]),
-            _queue_length(_ready[Deferred])
+            rq[0], rq[1], rq[2]
         );
         // _sio_dump( true );
         // _ptable_dump( "Ptbl", false );
@@ -122,47 +137,165 @@ static void _clk_isr( int vector, int code ) {
 #endif
 
     // time marches on!
-    ++_system_time;
+    _system_time += n;
+
+    // once a second, measure how fast the TSC is running, and
+    // refresh the "top" display if it is on
+    if( _system_time - _tsc_mark_time >= CLOCK_FREQUENCY ) {
+        uint64_t now = __get_tsc();
+        if( _tsc_mark != 0 ) {
+            _tsc_per_tick = (uint32_t) __udiv64( now - _tsc_mark,
+                                        _system_time - _tsc_mark_time );
+        }
+        _tsc_mark = now;
+        _tsc_mark_time = _system_time;
+
+        if( _top_live ) {
+            _ptable_top();
+        }
+    }
 
     // wake up any sleeping processes whose time has come
     //
     // we give them preference over the current process
     // (when it is scheduled again)
 
-    do {
+    pcb_t *pcb;
 
-        // peek at the first member of the queue
-        key_t key = _queue_kpeek( _sleeping );
-
-        // the key value is the earliest wakeup time for any process
-        // on the queue; if that's greater than the current time, or
-        // if the queue is empty (indicated by a key value of 0),
-        // there's nobody to awaken
-
-        if( key == 0 || key > _system_time ) {
+    for(;;) {
+        _lock_acquire( &_sleep_lock );
+        pcb = _wheel_expire( _sleeping, _system_time );
+        _lock_release( &_sleep_lock );
+        if( pcb == NULL ) {
             break;
         }
+        _schedule( pcb );
+    }
 
-        // ok, we need to wake someone up
-        pcb_t *pcb = NULL;
-        status_t status = _queue_remove( _sleeping, (void **) &pcb );
-        assert1( status == E_SUCCESS && pcb != NULL );
+    // under MLFQ, periodically return everyone to their base levels
 
-        // schedule this process
-        _schedule( pcb );
+    if( _sched_policy == SchedMLFQ &&
+            (_system_time / MLFQ_BOOST) != ((_system_time - n) / MLFQ_BOOST) ) {
+        _sched_boost();
+    }
 
-    } while( 1 );
+    // if only deferred work is runnable, use some of the otherwise
+    // idle time to top up the pool of zeroed pages
 
-    // check the current process to see if its time slice has expired
-    _current->ticks -= 1;
+    if( _sched_idle() ) {
+        (void) _km_zero_refill();
+    }
 
-    if( _current->ticks < 1 ) {
-        // yes!  put it back on the ready queue
-        _schedule( _current );
-        // pick a new "current" process
-        _dispatch();
+    // the current process has used up some of its time slice
+    _clk_slice( n );
+}
+
+#ifdef TICKLESS
+/**
+** Name:  _clk_elapsed
+**
+** Determine how many ticks have passed since the PIT was last armed
+**
+** Whole ticks are returned; the remainder is carried forward, so no
+** time is lost however long the intervals are.
+**
+** @return the number of ticks
+*/
+static uint32_t _clk_elapsed( void ) {
+    uint32_t status, count, cycles;
+
+    // latch the status and count of channel 0 together
+    __outb( TIMER_CONTROL_PORT, TIMER_READBACK | TIMER_RB_CHAN_0 );
+    status = __inb( TIMER_0_PORT );
+    count = __inb( TIMER_0_PORT );
+    count |= __inb( TIMER_0_PORT ) << 8;
+
+    if( status & TIMER_RB_OUTPUT ) {
+        // the count ran out, and the counter has been wrapping
+        // around (from 0 to 0xffff) since then
+        cycles = _armed + ((0x10000 - count) & 0xffff);
+    } else {
+        cycles = _armed - count;
     }
 
+    _partial += cycles;
+    cycles = _partial / CYCLES_PER_TICK;
+    _partial %= CYCLES_PER_TICK;
+
+    return( cycles );
+}
+
+/**
+** Name:  _clk_arm
+**
+** Program the PIT to interrupt at the next time there will be
+** something for us to do:  the next wakeup, or the end of the
+** current process' time slice, whichever comes first.
+*/
+static void _clk_arm( void ) {
+    uint32_t ticks = CYCLES_MAX / CYCLES_PER_TICK + 1;
+    time_t when;
+
+    // a time slice only matters if something else could run when
+    // it ends
+    if( !_sched_idle() ) {
+        ticks = _current->ticks;
+    }
+
+    // an EDF task that should preempt the current process gets
+    // the CPU at the next tick
+    if( _sched_preempting() ) {
+        ticks = 1;
+    }
+
+    _lock_acquire( &_sleep_lock );
+    status_t status = _wheel_next( _sleeping, &when );
+    _lock_release( &_sleep_lock );
+
+    if( status == E_SUCCESS ) {
+        uint32_t delta = (int32_t) (when - _system_time) > 0 ?
+                         when - _system_time : 1;
+        if( delta < ticks ) {
+            ticks = delta;
+        }
+    }
+
+    // convert to cycles, allowing for the part of the current tick
+    // that has already passed
+    uint32_t cycles = ticks * CYCLES_PER_TICK;
+    if( ticks > CYCLES_MAX / CYCLES_PER_TICK ) {
+        cycles = CYCLES_MAX;
+    }
+    cycles = cycles > _partial + CYCLES_MIN ? cycles - _partial : CYCLES_MIN;
+
+    // one-shot mode; the count starts when the MSB is written
+    __outb( TIMER_CONTROL_PORT, TIMER_0_SELECT | TIMER_0_LOAD |
+                                TIMER_MODE_0 );
+    __outb( TIMER_0_PORT, cycles & 0xff );
+    __outb( TIMER_0_PORT, (cycles >> 8) & 0xff );
+    _armed = cycles;
+}
+#endif
+
+/**
+** Name:  _clk_isr
+**
+** The ISR for the clock
+**
+** @param vector    Vector number for the clock interrupt
+** @param code      Error code (0 for this interrupt)
+*/
+static void _clk_isr( int vector, int code ) {
+
+    _irqs[ _current->priority == Deferred ] += 1;
+
+#ifdef TICKLESS
+    // bring the time up to date, and set the next alarm
+    _clk_rearm();
+#else
+    _clk_tick( 1 );
+#endif
+
     // tell the PIC we're done
     __outb( PIC_PRI_CMD_PORT, PIC_EOI );
 }
@@ -171,6 +304,93 @@ static void _clk_isr( int vector, int code ) {
 ** PUBLIC FUNCTIONS
 */
 
+/**
+** Name:  _clk_slice
+**
+** Charge elapsed ticks to the current process on this CPU, and
+** switch processes if its time slice is over or something should
+** preempt it.  The other CPUs call this from their own timer ISRs.
+**
+** @param n     Number of ticks that have elapsed
+*/
+void _clk_slice( uint32_t n ) {
+
+    _sched_charge( _current, n );
+
+    // check the current process to see if its time slice has expired
+    _current->ticks = n < _current->ticks ? _current->ticks - n : 0;
+
+    if( _current->ticks < 1 || _current->state == Killed ) {
+        // yes (or it was killed from another CPU)!  put it back
+        // on the ready queue
+        _sched_preempt( _current );
+        // pick a new "current" process
+        _dispatch();
+    } else if( _sched_preempting() ) {
+        // no, but a real-time task with an earlier deadline has
+        // become ready, and can't wait for the slice to end (or
+        // this CPU is idling while there is work to do)
+        _sched_preempt( _current );
+        _dispatch();
+    }
+}
+
+/**
+** Name:  _clk_rearm
+**
+** In tickless mode, catch up with any time that has passed and
+** reprogram the timer.  Must be called whenever something happens
+** that might move the next timer event earlier (e.g., a process
+** goes to sleep or becomes ready).  Does nothing in periodic mode.
+**
+** The PIT, the system time and the time slice it enforces all belong
+** to the bootstrap CPU; the other CPUs slice their own processes with
+** their LAPIC timers.  On those CPUs this does nothing, so a change
+** they make to the sleep wheel is seen at the BSP's next one-shot
+** interrupt (at most about 55ms away).
+*/
+void _clk_rearm( void ) {
+#ifdef TICKLESS
+    if( _cpu->id != 0 ) {
+        return;
+    }
+
+    uint32_t n = _clk_elapsed();
+
+    if( n > 0 ) {
+        _clk_tick( n );
+    }
+    _clk_arm();
+#endif
+}
+
+/**
+** Name:  _clk_dump
+**
+** Report the timer interrupt rate, with the idle process running
+** and with other processes running, since the last report
+*/
+void _clk_dump( void ) {
+    static const char *what[2] = { "busy", "idle" };
+
+#ifdef TICKLESS
+    __cio_puts( "\nClock (tickless):" );
+#else
+    __cio_puts( "\nClock (periodic):" );
+#endif
+
+    for( int i = 0; i < 2; ++i ) {
+        uint32_t rate = _ticks[i] ?
+            (uint32_t) __udiv64( (uint64_t) _irqs[i] * CLOCK_FREQUENCY,
+                                 _ticks[i] ) : 0;
+        __cio_printf( "  %s %d IRQs/%d ms = %d/sec", what[i],
+                      _irqs[i], _ticks[i], rate );
+        _irqs[i] = _ticks[i] = 0;
+    }
+
+    __cio_putchar( '\n' );
+}
+
 /**
 ** Name:  _clk_init
 **
@@ -188,15 +408,35 @@ void _clk_init( void ) {
     // return to the dawn of time
     _system_time = 0;
 
+    // the TSC rate isn't known until a second has passed
+    _tsc_per_tick = 0;
+    _tsc_mark = 0;
+    _tsc_mark_time = 0;
+
+    // create the sleep wheel (linked through the PCBs, so that
+    // putting a process to sleep or waking it up takes constant time
+    // no matter how many sleepers there are)
+    _sleeping = _wheel_create( PCB_WAKE, _system_time );
+    assert( _sleeping != NULL );
+    _lock_init( &_sleep_lock, "sleep", LOCK_SPIN );
+
     // configure the clock
-    uint32_t divisor = TIMER_FREQUENCY / CLOCK_FREQUENCY;
+#ifdef TICKLESS
+    // the first one-shot is armed by the first call to _clk_rearm();
+    // until then, fire after one tick
+    _partial = 0;
+    __outb( TIMER_CONTROL_PORT, TIMER_0_SELECT | TIMER_0_LOAD |
+                                TIMER_MODE_0 );
+    __outb( TIMER_0_PORT, CYCLES_PER_TICK & 0xff );
+    __outb( TIMER_0_PORT, (CYCLES_PER_TICK >> 8) & 0xff );
+    _armed = CYCLES_PER_TICK;
+    __cio_puts( " tickless" );
+#else
+    uint32_t divisor = CYCLES_PER_TICK;
     __outb( TIMER_CONTROL_PORT, TIMER_0_LOAD | TIMER_0_SQUARE );
     __outb( TIMER_0_PORT, divisor & 0xff );        // LSB of divisor
     __outb( TIMER_0_PORT, (divisor >> 8) & 0xff ); // MSB of divisor
-
-    // create the sleep queue
-    _sleeping = _queue_create( _cmp_wakeup );
-    assert( _sleeping != NULL );
+#endif
 
     // register the second-stage ISR
     __install_isr( INT_VEC_TIMER, _clk_isr );
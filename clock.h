@@ -11,6 +11,8 @@
 
 #include "common.h"
 #include "queues.h"
+#include "wheel.h"
+#include "lock.h"
 
 /*
 ** General (C and/or assembly) definitions
@@ -50,8 +52,13 @@
 // current system time
 extern time_t _system_time;
 
-// we own the sleep queue
-extern queue_t _sleeping;
+// we own the sleep wheel, and the lock that protects it
+extern wheel_t _sleeping;
+extern lock_t _sleep_lock;
+
+// TSC cycles per clock tick, as measured over the last second
+// (zero until the first second has passed)
+extern uint32_t _tsc_per_tick;
 
 /*
 ** Prototypes
@@ -65,6 +72,36 @@ extern queue_t _sleeping;
 */
 void _clk_init( void );
 
+/**
+** Name:  _clk_slice
+**
+** Charge elapsed ticks to the current process on this CPU, and
+** switch processes if its time slice is over or something should
+** preempt it
+**
+** @param n     Number of ticks that have elapsed
+*/
+void _clk_slice( uint32_t n );
+
+/**
+** Name:  _clk_rearm
+**
+** In tickless mode, catch up with any time that has passed and
+** reprogram the timer.  Must be called whenever something happens
+** that might move the next timer event earlier (e.g., a process
+** goes to sleep or becomes ready).  Does nothing in periodic mode,
+** or on any CPU but the bootstrap CPU.
+*/
+void _clk_rearm( void );
+
+/**
+** Name:  _clk_dump
+**
+** Report the timer interrupt rate, with the idle process running
+** and with other processes running, since the last report
+*/
+void _clk_dump( void );
+
 #endif
 /* SP_ASM_SRC */
 
@@ -37,9 +37,10 @@
 #define CHAN_CIO    0
 #define CHAN_SIO    1
 
-// maximum number of processes in the system
+// maximum number of processes in the system (the process table
+// grows as needed, up to this size)
 
-#define N_PROCS     25
+#define N_PROCS     16384
 
 #ifndef SP_ASM_SRC
 
@@ -106,11 +107,15 @@ enum state_e {
 typedef uint8_t state_t;
 
 // Process priorities (visible to user code)
+//
+// There are N_PRIOS priority levels, from 0 (highest) to N_PRIOS-1
+// (lowest); the named priorities are landmarks within that range.
+// N_PRIOS may be 32 or 64.
+
+#define N_PRIOS     32
 
 enum prio_e {
-    System = 0, User, Deferred,
-    // sentinel
-    N_PRIOS
+    System = 0, User = N_PRIOS / 2, Deferred = N_PRIOS - 1
 };
 
 #define PRIO_HIGH   System
@@ -119,12 +124,109 @@ enum prio_e {
 
 typedef uint8_t prio_t;
 
+// Scheduling policies (visible to user code)
+//
+// These govern how processes at the time-sharing (User) levels
+// are treated; System and Deferred processes are unaffected.
+
+enum policy_e {
+    SchedMLQ = 0,       // fixed priorities and quantum
+    SchedMLFQ,          // multilevel feedback queue
+    // sentinel - value equals the number of policies
+    N_POLICIES
+};
+
+// Fork modes (visible to user code)
+//
+// These govern how fork() gives the child a copy of the parent's
+// data segment; the stack is always copied.
+
+enum forkmode_e {
+    ForkCopy = 0,       // copy every page when the child is created
+    ForkCOW,            // share pages until one side writes to them
+    // sentinel - value equals the number of modes
+    N_FORKMODES
+};
+
+// Fair scheduling class weights (visible to user code)
+//
+// A process in the fair class gets CPU time in proportion to its
+// weight relative to the other runnable fair class processes.
+
+#define WEIGHT_DEFAULT  1024
+#define WEIGHT_MAX      65535
+
+// Earliest-deadline-first real-time class (visible to user code)
+//
+// A process in the EDF class needs 'runtime' ticks of CPU time in
+// every 'period' ticks, each within 'deadline' ticks of its release.
+// Each value must fit in 16 bits.
+
+#define EDF_PARAM_MAX   65535
+
+typedef struct edfstat_s {
+    uint32_t runtime;           // CPU ticks per job
+    uint32_t period;            // ticks between job releases
+    uint32_t deadline;          // relative deadline of each job
+    uint32_t jobs;              // jobs completed
+    uint32_t misses;            // jobs that missed their deadline
+} edfstat_t;
+
 // System time type
 typedef uint32_t time_t;
 
 // status return type
 typedef int status_t;
 
+// Per-process CPU accounting (visible to user code)
+
+typedef struct pstat_s {
+    pid_t pid;
+    pid_t ppid;
+    state_t state;
+    prio_t priority;
+    uint8_t sclass;             // scheduling class
+    uint8_t pad;
+    uint32_t utime;             // ticks spent in user code
+    uint32_t stime;             // ticks spent in ISRs and syscalls
+    uint32_t nvcsw;             // context switches:  gave up the CPU
+    uint32_t nivcsw;            // context switches:  had it taken away
+    uint64_t runtime;           // TSC cycles spent on the CPU
+} pstat_t;
+
+// Memory allocator statistics (visible to user code)
+
+// number of free block histogram buckets; bucket i counts
+// free blocks of 2^i pages
+#define KM_HIST_ORDERS  11
+
+typedef struct kmstat_s {
+    // page allocator
+    uint32_t page_allocs;       // successful page allocations
+    uint32_t page_frees;        // page deallocations
+    uint32_t page_fails;        // failed page allocations
+    uint32_t pages_total;       // pages under management
+    uint32_t pages_used;        // pages currently allocated
+    uint32_t pages_peak;        // high-water mark of pages_used
+    uint32_t largest_run;       // longest run of contiguous free pages
+    // slice allocator
+    uint32_t slice_allocs;      // slice allocations
+    uint32_t slice_frees;       // slice deallocations
+    uint32_t slices_free;       // slices currently on the free list
+    uint32_t slice_pages;       // pages currently carved into slices
+    uint32_t slice_reclaims;    // carved pages given back when emptied
+    // slab caches
+    uint32_t slab_pages;        // pages currently held by slabs
+    uint32_t slab_empty;        // of those, pages in empty (reserve) slabs
+    uint32_t slab_reclaims;     // emptied slabs given back to kmem
+    // zeroed page pool
+    uint32_t zero_pool;         // pages currently in the pool
+    uint32_t zero_hits;         // zeroed requests served from the pool
+    uint32_t zero_misses;       // zeroed requests that had to be cleared
+    // free block histogram
+    uint32_t free_blocks[KM_HIST_ORDERS];
+} kmstat_t;
+
 // Error return values (e.g., from system calls)
 
 // success!
@@ -145,6 +247,7 @@ typedef int status_t;
 #define E_NOT_FOUND     (-8)
 #define E_NO_CHILDREN   (-9)
 #define E_KILLED        (-10)
+#define E_OVERLOAD      (-11)
 
 /*
 ** Additional OS-only or user-only things
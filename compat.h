@@ -52,8 +52,8 @@
 ** terms of the names used in the rest of the baseline.
 */
 
-// invoke the queue creation function
-#define QCREATE(q)      do { q = _queue_create( NULL ); } while(0)
+// invoke the queue creation function (for queues of PCBs)
+#define QCREATE(q)      do { q = _queue_create_linked( NULL, PCB_LINK ); } while(0)
 
 // invoke the queue "length" function
 #define QLENGTH(q)    _queue_length( q )
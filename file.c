@@ -8,12 +8,11 @@
 #include "file.h"
 #include "common.h"
 #include "kmem.h"
+#include "slab.h"
 #include "cio.h"
 #include "kdefs.h"
 #include "filesys.h"
 
-#define MEMSPACE 2	// pages to allocate for file data
-#define MEMMAX 4	// maximum pages allowed
 #define BLOCKSPACE 248	// space reserved for file data inside of a datablock;
 
 /*
@@ -40,11 +39,12 @@ typedef struct f_node{
 	struct f_node *prev; //64
 }f_info;
 
-//list of pointers to free file nodes 
-static file_t fNodeList;
+// cache of file nodes
+static kmem_cache_t fNodeCache;
 
 //declared here for use
 static void free_fnode(file_t fn);
+void delete_contents(fdata_t f);
 
 
 /*
@@ -60,8 +60,8 @@ typedef struct f_space{
 }datablock;
 
 
-// list of free data blocks
-static fdata_t dataBlocks;
+// cache of data blocks
+static kmem_cache_t dataBlockCache;
 
 
 // buffer for reading in data for files
@@ -77,16 +77,13 @@ char *fileBuffer;
 */
 static int alloc_file_buffer( void ){
 
-	//allocate a slice for the buffer
-	fileBuffer = (char*) _km_slice_alloc();
+	//allocate cleared space for the buffer
+	fileBuffer = (char*) _kzalloc(SZ_SLICE);
         
 	// if buffer cannot be allocated exit
 	if (fileBuffer == NULL) {
                 return 0;
         }
-
-        //clear allocated space
-        __memclr (fileBuffer, SZ_SLICE);
  
  	return 1;
 }
@@ -102,40 +99,11 @@ static int alloc_file_buffer( void ){
 static void free_dblock(fdata_t t){
 	assert(t != NULL);
 
-	//add new datablock to top of stack
-        t->next = dataBlocks;
-        dataBlocks = t;
+	//give the datablock back to its cache
+	_kmem_cache_free(dataBlockCache, t);
 }
 
 
-/**
-** Name:        alloc_mem_space
-**
-** Desc:        Allocates pages of memory based on MEMSPACE or MEMMAX 
-**
-** @return      number of data blocks allocated
-*/
-static int alloc_mem_space( void ){ 
-
-	// number of blocks cannot exceed MEMMAX
-	int blocks = (MEMSPACE < MEMMAX) ? MEMSPACE : MEMMAX;
-	fdata_t data = (fdata_t) _km_page_alloc( blocks );
-	if (data == NULL){
-		return 0;
-	}
-
-	// clear out memory for page
-	__memclr (data, SZ_PAGE);
-
-	// create data blocks from page
-	for (int i = 0; i < (SZ_SLICE / sizeof(datablock)); ++i){
-                //free blocks one at a time
-		free_dblock(&data[i]);
-        }
-        return (SZ_PAGE / sizeof(datablock));
-
-}
-
 /**
 ** Name:        create_file_block
 **
@@ -150,28 +118,22 @@ static int alloc_mem_space( void ){
 fdata_t create_file_block( char *contents, int size ){
 	fdata_t new, tmp, first;
 
-        //is memory allocated
-        if (dataBlocks == NULL) {
-
-                //allocate if memory can be allocated
-                if (!alloc_mem_space()){
-                        //memory cannot be allocated return null
-                        return(NULL);
-                }
-        }
-	
-
 	int blockCount = (size / BLOCKSPACE);
 
 	for (int i = 0; i <= blockCount; ++i){
 		
-		//get allocated fileBlock from top of stack
-		new = dataBlocks;
+		//get a fileBlock from the cache
+		new = (fdata_t) _kmem_cache_alloc(dataBlockCache);
 
-		//set stack to current top
-	        dataBlocks = new->next;
+		//memory cannot be allocated; release what we have
+		if (new == NULL) {
+			if (i > 0) {
+				delete_contents(first);
+			}
+			return(NULL);
+		}
 
-		//remove pointer to stack
+		//not linked to anything yet
         	new->next = NULL;
 
 		//only want to access next 248 bytes
@@ -220,31 +182,6 @@ fdata_t link_file( file_t f ){
 }
 
 
-/**
-** Name:        alloc_new_fnode
-**
-** Desc:        allocates space for file nodes from a slice 
-**
-** @param f	fnode to link to file
-**
-** @return      pointer to first linked file block 
-*/
-static int alloc_new_fnode( void ){
-	file_t new = (file_t) _km_slice_alloc();
-	if (new == NULL) {
-		return 0;
-	}
-
-	//clear allocated space
-	__memclr (new, SZ_SLICE);
-
-	for (int i = 0; i < (SZ_SLICE / sizeof(f_info)); ++i){
-		free_fnode(&new[i]);
-	}
-	return (SZ_SLICE / sizeof(f_info));
-}
-
-
 /**
 ** Name:        create_fnode
 **
@@ -258,20 +195,13 @@ static int alloc_new_fnode( void ){
 file_t create_fnode(char name[16], int wData){
 	file_t new;
 
-	//is memory allocated
-	if (fNodeList == NULL) {
-		
-		//allocate if memory can be allocated
-		if (!alloc_new_fnode()){
-			//memory cannot be allocated return null
-			return(NULL);
-		}
+	//get an fnode from the cache
+	new = (file_t) _kmem_cache_alloc(fNodeCache);
+	if (new == NULL) {
+		//memory cannot be allocated return null
+		return(NULL);
 	}
 
-	//remove fnode from stack
-	new = fNodeList;
-	fNodeList = new->next;
-
 	//populate fnode with data
 	new->next = new->subFiles = new->prev = new->parent = NULL;
 	new->depth = 0;
@@ -301,8 +231,7 @@ file_t create_fnode(char name[16], int wData){
 static void free_fnode(file_t f){
 	assert(f != NULL);
 
-	f->next = fNodeList;
-	fNodeList = f;
+	_kmem_cache_free(fNodeCache, f);
 }
 
 
@@ -376,16 +305,21 @@ file_t add_to_dir(file_t f, char name[16], int wData){
 /**
 ** Name:        delete_contents
 **
-** Desc:        deletes a file block and frees its memory
+** Desc:        deletes a chain of file blocks and frees their memory
 **
-** @param f     fblock to be deleted
+** @param f     first fblock to be deleted
 **
 */
 
 void delete_contents(fdata_t f){
-	__memset(f->data, BLOCKSPACE, '\0');
+	while (f != NULL) {
+		fdata_t next = f->next;
 
-	free_dblock(f);
+		__memset(f->data, BLOCKSPACE, '\0');
+		free_dblock(f);
+
+		f = next;
+	}
 }
 
 /**
@@ -649,15 +583,12 @@ void _file_init(int run) {
 
 	__cio_puts("\nDavX File System:");
 
-	// allocate space for file sys
-	fNodeList = NULL;
-	if (alloc_new_fnode() < 1){
-		__cio_puts("FILE INIT FAIL");
-	}
-
-	// allocate memory blocks
-	dataBlocks = NULL;
-	if (alloc_mem_space() < 1){
+	// create caches for file nodes and data blocks
+	fNodeCache = _kmem_cache_create("fnode", sizeof(f_info),
+					KM_CACHE_LINE, NULL);
+	dataBlockCache = _kmem_cache_create("datablock", sizeof(datablock),
+					KM_CACHE_LINE, NULL);
+	if (fNodeCache == NULL || dataBlockCache == NULL){
 		__cio_puts("FILE INIT FAIL");
 	}
 
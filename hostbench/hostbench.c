@@ -0,0 +1,770 @@
+/*
+** @file hostbench.c
+**
+** @author CSCI-452 class of 20215
+**
+** Host-side correctness tests and microbenchmarks for the page
+** allocator, the slab caches, the queue module, and the timing wheel.
+** The queue tests are run against each kind of queue:  qnode lists,
+** array heaps, and intrusive (linked) queues.
+**
+** Each workload performs a long random sequence of operations,
+** checking every result against a simple model of what the data
+** structure should contain, and times each operation with the TSC.
+** At the end of a workload we report the operation rate (based only
+** on the time spent in the operations themselves, not the checks)
+** and the 50th/90th/99th percentile and maximum latencies (in cycles).
+**
+** Any failed check panics, which makes the harness exit with a
+** non-zero status.  Run it with "make hostbench".
+*/
+
+#include "common.h"
+#include "lib.h"
+
+#include "cio.h"
+#include "kmem.h"
+#include "slab.h"
+#include "queues.h"
+#include "wheel.h"
+
+#include "shim.h"
+
+/*
+** PRIVATE DEFINITIONS
+*/
+
+// pages of "physical" memory in the fake memory map (64MB)
+
+#define HB_PAGES    16384
+
+// operations per workload
+
+#define HB_OPS      200000
+
+// number of allocation slots for the allocator workloads
+
+#define HB_SLOTS    512
+
+// number of items for the queue workloads
+
+#define HB_ITEMS    1024
+
+// number of items in the ordered queue workload
+
+#define HB_ORDERED  256
+
+// insertions timed at each depth in the ordered queue depth test
+
+#define HB_DEPTH_OPS    20000
+
+// number of items in the timing wheel workload
+
+#define HB_TIMERS   512
+
+// sleeper populations and simulated ticks for the sleep comparison
+
+#define HB_SLEEPERS 5000
+#define HB_TICKS    20000
+
+// kinds of queue
+
+#define QK_LIST     0       // _queue_create()
+#define QK_HEAP     1       // _queue_create_heap()
+#define QK_LINKED   2       // _queue_create_linked()
+#define N_KINDS     3
+
+// is time 'a' before time 'b'?  (the same test the wheel uses)
+
+#define TBEFORE(a,b)    ((int32_t) ((a) - (b)) < 0)
+
+// a check that must never fail
+
+#define CHECK(x,msg)    if( !(x) ) { _kpanic( msg ); }
+
+/*
+** PRIVATE DATA TYPES
+*/
+
+// an allocation made by one of the allocator workloads
+
+typedef struct slot_s {
+    uint8_t *ptr;       // the block, or NULL
+    uint32_t size;      // pages or bytes, depending on the workload
+} slot_t;
+
+// an entry in the queue workloads
+
+typedef struct item_s {
+    qlink_t link;       // for intrusive queues
+    wlink_t wake;       // for timing wheels
+    key_t key;          // ordering key
+    uint32_t seq;       // insertion sequence number
+    bool_t queued;      // currently in the queue?
+} item_t;
+
+// a simulated sleeping process
+
+typedef struct sleeper_s {
+    qlink_t link;       // for the sleep queue
+    wlink_t wake;       // for the sleep wheel
+} sleeper_t;
+
+/*
+** PRIVATE GLOBAL VARIABLES
+*/
+
+static uint32_t _samples[HB_OPS];
+static uint32_t _nsamples;
+static uint64_t _cycles;
+
+static slot_t _slots[HB_SLOTS];
+
+static item_t _items[HB_ITEMS];
+
+static sleeper_t _sleepers[HB_SLEEPERS];
+
+// FIFO model:  a ring of item indices
+static uint32_t _ring[HB_ITEMS];
+
+static const char *_kinds[N_KINDS] = { "list", "heap", "linked" };
+
+/*
+** PRIVATE FUNCTIONS
+*/
+
+/**
+** _start() - begin timing one operation
+*/
+static uint64_t _start( void ) {
+    return( __get_tsc() );
+}
+
+/**
+** _record() - record the time taken by one operation
+*/
+static void _record( uint32_t t ) {
+    _samples[_nsamples++] = t;
+    _cycles += t;
+}
+
+/**
+** _stop() - finish timing one operation and record it
+*/
+static void _stop( uint64_t t0 ) {
+    _record( (uint32_t) (__get_tsc() - t0) );
+}
+
+/**
+** _report() - print the results of one workload
+**
+** @param name   Name of the workload
+*/
+static void _report( const char *name ) {
+    uint32_t n = _nsamples;
+
+    if( n == 0 ) {
+        return;
+    }
+
+    _hb_sort( _samples, n );
+
+    uint64_t usecs = _cycles / _hb_tsc_mhz();
+    uint32_t rate = usecs ? (uint32_t) (((uint64_t) n * 1000000) / usecs) : 0;
+
+    __cio_printf( "%-16s %7d ops %10d ops/s  p50 %5d p90 %5d p99 %6d"
+                  " max %8d cyc\n", (char *) name, n, rate,
+                  _samples[n / 2], _samples[(n * 9) / 10],
+                  _samples[(n * 99) / 100], _samples[n - 1] );
+
+    _nsamples = 0;
+    _cycles = 0;
+}
+
+/**
+** _fill() / _verify() - stamp a block with a pattern and check it
+*/
+static void _fill( uint8_t *ptr, uint32_t len, uint32_t tag ) {
+    ptr[0] = ptr[len / 2] = ptr[len - 1] = tag;
+}
+
+static bool_t _verify( uint8_t *ptr, uint32_t len, uint32_t tag ) {
+    return( ptr[0] == (uint8_t) tag && ptr[len / 2] == (uint8_t) tag &&
+            ptr[len - 1] == (uint8_t) tag );
+}
+
+/**
+** _used() - number of pages currently allocated
+*/
+static uint32_t _used( void ) {
+    kmstat_t st;
+
+    _km_stats( &st );
+    return( st.pages_used );
+}
+
+/**
+** _bench_pages() - random page allocations and deallocations
+*/
+static void _bench_pages( void ) {
+    uint32_t before = _used();
+
+    for( int i = 0; i < HB_OPS; ++i ) {
+        uint32_t n = _hb_random() % HB_SLOTS;
+        slot_t *s = &_slots[n];
+        uint64_t t;
+
+        if( s->ptr != NULL ) {
+            for( uint32_t k = 0; k < s->size; ++k ) {
+                CHECK( _verify(s->ptr + k * SZ_PAGE, SZ_PAGE, n + k),
+                       "page contents" );
+            }
+            t = _start();
+            _km_page_free( s->ptr );
+            _stop( t );
+            s->ptr = NULL;
+        } else {
+            // mostly small requests, with the occasional large one
+            uint32_t r = _hb_random();
+            s->size = 1 + ((r & 7) == 0 ? (r >> 8) % 32 : (r >> 8) % 4);
+            t = _start();
+            s->ptr = _km_page_alloc( s->size );
+            _stop( t );
+            CHECK( s->ptr != NULL, "page allocation failed" );
+            CHECK( ((uint32_t) s->ptr & (SZ_PAGE - 1)) == 0,
+                   "page alignment" );
+            for( uint32_t k = 0; k < s->size; ++k ) {
+                _fill( s->ptr + k * SZ_PAGE, SZ_PAGE, n + k );
+            }
+        }
+    }
+
+    _report( "kmem pages" );
+
+    for( int i = 0; i < HB_SLOTS; ++i ) {
+        if( _slots[i].ptr != NULL ) {
+            _km_page_free( _slots[i].ptr );
+            _slots[i].ptr = NULL;
+        }
+    }
+
+    CHECK( _used() == before, "pages leaked" );
+}
+
+/**
+** _bench_kmalloc() - random variable-sized allocations
+*/
+static void _bench_kmalloc( void ) {
+    uint32_t before = _used();
+
+    for( int i = 0; i < HB_OPS; ++i ) {
+        uint32_t n = _hb_random() % HB_SLOTS;
+        slot_t *s = &_slots[n];
+        uint64_t t;
+
+        if( s->ptr != NULL ) {
+            CHECK( _verify(s->ptr, s->size, n), "kmalloc contents" );
+            t = _start();
+            _kfree( s->ptr );
+            _stop( t );
+            s->ptr = NULL;
+        } else {
+            // mostly small objects, with the occasional large one
+            uint32_t r = _hb_random();
+            s->size = 1 + ((r & 15) == 0 ? (r >> 8) % 6000 : (r >> 8) % 256);
+            t = _start();
+            s->ptr = _kmalloc( s->size );
+            _stop( t );
+            CHECK( s->ptr != NULL, "kmalloc failed" );
+            CHECK( ((uint32_t) s->ptr & (sizeof(int) - 1)) == 0,
+                   "kmalloc alignment" );
+            _fill( s->ptr, s->size, n );
+        }
+    }
+
+    _report( "kmalloc/kfree" );
+
+    for( int i = 0; i < HB_SLOTS; ++i ) {
+        if( _slots[i].ptr != NULL ) {
+            CHECK( _verify(_slots[i].ptr, _slots[i].size, i),
+                   "kmalloc contents" );
+            _kfree( _slots[i].ptr );
+            _slots[i].ptr = NULL;
+        }
+    }
+
+    // each cache may keep one empty slab around
+    CHECK( _used() <= before + N_CACHES * 8, "kmalloc leaked pages" );
+}
+
+/**
+** _make_queue() - create a queue of the specified kind
+**
+** @param kind   The kind of queue (QK_*)
+** @param order  The ordering function, or NULL
+*/
+static queue_t _make_queue( int kind,
+                            int (*order)(const key_t, const key_t) ) {
+    queue_t q;
+
+    switch( kind ) {
+    case QK_HEAP:
+        q = _queue_create_heap( order );
+        break;
+    case QK_LINKED:
+        q = _queue_create_linked( order, QLINK_OFFSET(item_t,link) );
+        break;
+    default:
+        q = _queue_create( order );
+    }
+
+    CHECK( q != NULL, "queue creation failed" );
+
+    for( int i = 0; i < HB_ITEMS; ++i ) {
+        _items[i].queued = 0;
+    }
+
+    return( q );
+}
+
+/**
+** _bench_fifo() - random additions to and removals from a FIFO queue
+**
+** @param kind  The kind of queue (QK_LIST or QK_LINKED)
+*/
+static void _bench_fifo( int kind ) {
+    queue_t q = _make_queue( kind, NULL );
+    uint32_t head = 0, tail = 0, count = 0;
+    char name[24];
+
+    for( int i = 0; i < HB_OPS; ++i ) {
+        uint32_t r = _hb_random();
+        uint64_t t;
+
+        // keep the queue from running dry or overflowing
+        if( count > 0 && (count == HB_ITEMS || (r & 1)) ) {
+            void *data;
+            t = _start();
+            status_t stat = _queue_remove( q, &data );
+            _stop( t );
+            CHECK( stat == E_SUCCESS, "FIFO remove failed" );
+            CHECK( data == &_items[_ring[head]], "FIFO order" );
+            _items[_ring[head]].queued = 0;
+            head = (head + 1) % HB_ITEMS;
+            --count;
+        } else {
+            // an item may only be on an intrusive queue once
+            uint32_t n = (r >> 1) % HB_ITEMS;
+            while( _items[n].queued ) {
+                n = (n + 1) % HB_ITEMS;
+            }
+            _items[n].queued = 1;
+            t = _start();
+            status_t stat = _queue_add( q, &_items[n], 0 );
+            _stop( t );
+            CHECK( stat == E_SUCCESS, "FIFO add failed" );
+            _ring[tail] = n;
+            tail = (tail + 1) % HB_ITEMS;
+            ++count;
+        }
+        CHECK( _queue_length(q) == count, "FIFO length" );
+    }
+
+    __sprint( name, "%s FIFO", _kinds[kind] );
+    _report( name );
+
+    while( count-- > 0 ) {
+        void *data;
+        CHECK( _queue_remove(q, &data) == E_SUCCESS, "FIFO drain" );
+    }
+    CHECK( _queue_length(q) == 0, "FIFO drain" );
+
+    _queue_delete( q );
+}
+
+/**
+** _cmp() - ordering function for the ordered queue workload
+*/
+static int _cmp( const key_t a, const key_t b ) {
+    return( a < b ? -1 : (a > b ? 1 : 0) );
+}
+
+/**
+** _model_min() - which queued item should be at the front?
+**
+** Smallest key first; among equal keys, the earliest inserted.
+*/
+static item_t *_model_min( void ) {
+    item_t *min = NULL;
+
+    for( int i = 0; i < HB_ORDERED; ++i ) {
+        item_t *it = &_items[i];
+        if( !it->queued ) {
+            continue;
+        }
+        if( min == NULL || it->key < min->key ||
+                (it->key == min->key && it->seq < min->seq) ) {
+            min = it;
+        }
+    }
+
+    return( min );
+}
+
+/**
+** _bench_ordered() - random operations on an ordered queue
+**
+** About half the removals are of a randomly-chosen entry (as
+** _sys_kill does with the sleep queue) rather than the first one.
+**
+** @param kind  The kind of queue
+*/
+static void _bench_ordered( int kind ) {
+    queue_t q = _make_queue( kind, _cmp );
+    uint32_t count = 0, seq = 0;
+    char name[24];
+
+    for( int i = 0; i < HB_OPS; ++i ) {
+        uint32_t r = _hb_random();
+        item_t *it = &_items[(r >> 2) % HB_ORDERED];
+        uint64_t t;
+
+        if( it->queued && (r & 1) ) {
+            t = _start();
+            void *data = _queue_remove_specific( q, it );
+            _stop( t );
+            CHECK( data == it, "ordered remove_specific" );
+            it->queued = 0;
+            --count;
+        } else if( count > 0 && (r & 2) ) {
+            item_t *min = _model_min();
+            void *data;
+            key_t key;
+            CHECK( _queue_peek(q) == min, "ordered peek" );
+            CHECK( _queue_kpeek(q, &key) == E_SUCCESS && key == min->key,
+                   "ordered kpeek" );
+            t = _start();
+            status_t stat = _queue_remove( q, &data );
+            _stop( t );
+            CHECK( stat == E_SUCCESS && data == min, "ordered remove" );
+            min->queued = 0;
+            --count;
+        } else if( !it->queued ) {
+            it->key = _hb_random() % 1000;
+            it->seq = seq++;
+            t = _start();
+            status_t stat = _queue_add( q, it, it->key );
+            _stop( t );
+            CHECK( stat == E_SUCCESS, "ordered add failed" );
+            it->queued = 1;
+            ++count;
+        }
+        CHECK( _queue_length(q) == count, "ordered length" );
+    }
+
+    if( count == 0 ) {
+        key_t key;
+        CHECK( _queue_kpeek(q, &key) == E_EMPTY, "ordered kpeek empty" );
+    }
+
+    __sprint( name, "%s ordered", _kinds[kind] );
+    _report( name );
+
+    while( count > 0 ) {
+        void *data;
+        item_t *min = _model_min();
+        CHECK( _queue_remove(q, &data) == E_SUCCESS && data == min,
+               "ordered drain" );
+        min->queued = 0;
+        --count;
+    }
+
+    _queue_delete( q );
+}
+
+/**
+** _bench_depth() - cost of insertion into an ordered queue
+**
+** Fills a queue to the specified depth with random keys, then times
+** insertions while holding the depth steady by removing the first
+** entry after each one (as the clock ISR does with the sleep queue).
+**
+** @param kind   The kind of queue
+** @param depth  Number of entries to keep in the queue
+*/
+static void _bench_depth( int kind, uint32_t depth ) {
+    queue_t q = _make_queue( kind, _cmp );
+    void *spare = &_items[depth];
+    char name[24];
+    void *data;
+
+    CHECK( depth < HB_ITEMS, "depth too large" );
+
+    for( uint32_t i = 0; i < depth; ++i ) {
+        CHECK( _queue_add(q, &_items[i], _hb_random() % 100000) == E_SUCCESS,
+               "depth fill" );
+    }
+
+    for( int i = 0; i < HB_DEPTH_OPS; ++i ) {
+        // keys trend upward, like wakeup times
+        key_t key;
+        CHECK( _queue_kpeek(q, &key) == E_SUCCESS, "depth kpeek" );
+        key += _hb_random() % 100000;
+        uint64_t t = _start();
+        status_t stat = _queue_add( q, spare, key );
+        _stop( t );
+        CHECK( stat == E_SUCCESS, "depth add" );
+        CHECK( _queue_remove(q, &spare) == E_SUCCESS, "depth remove" );
+    }
+
+    __sprint( name, "%s add @%d", _kinds[kind], depth );
+    _report( name );
+
+    while( _queue_remove(q, &data) == E_SUCCESS ) {
+        ;
+    }
+    _queue_delete( q );
+}
+
+/**
+** _wheel_delay() - a random timer duration
+**
+** Mostly short, with some that land in each of the outer wheels and
+** a few beyond the range of the outermost one.
+*/
+static time_t _wheel_delay( void ) {
+    uint32_t r = _hb_random();
+
+    switch( r & 15 ) {
+    case 0:
+        return( 0 );
+    case 1: case 2:
+        return( (r >> 4) % (1U << 16) );
+    case 3:
+        return( (r >> 4) % (1U << 28) );
+    default:
+        return( (r >> 4) % 600 );
+    }
+}
+
+/**
+** _bench_wheel() - random operations on a timing wheel
+**
+** Timers are added, cancelled, and expired as time advances by
+** single ticks, short steps, and long jumps.  Each expired object
+** must be due, must not have been held past its time, and must come
+** out in order of expiration time.
+** The clock starts just short of wrapping around.
+*/
+static void _bench_wheel( void ) {
+    time_t now = 0xfffff000;
+    wheel_t w = _wheel_create( WLINK_OFFSET(item_t,wake), now + 1 );
+    uint32_t count = 0, seq = 0;
+
+    CHECK( w != NULL, "wheel creation failed" );
+
+    for( int i = 0; i < HB_TIMERS; ++i ) {
+        _items[i].queued = 0;
+    }
+
+    for( int i = 0; i < HB_OPS; ++i ) {
+        uint32_t r = _hb_random();
+        item_t *it = &_items[(r >> 3) % HB_TIMERS];
+        uint64_t t;
+
+        if( (r & 7) < 3 ) {
+            time_t step = (r & 7) == 0 ? (r >> 12) % 100000 :
+                                         (r & 7) == 1 ? (r >> 12) % 50 : 1;
+            time_t prev = now;
+            item_t *last = NULL;
+            uint64_t spent = 0;
+            void *data;
+
+            // one advance of the clock is one operation
+            now += step;
+            for( ;; ) {
+                t = _start();
+                data = _wheel_expire( w, now );
+                spent += __get_tsc() - t;
+                if( data == NULL ) {
+                    break;
+                }
+                item_t *e = data;
+                CHECK( e->queued, "wheel expired an idle item" );
+                CHECK( !TBEFORE(now,e->key), "wheel expired an item early" );
+                // anything due before the last advance was already
+                // expired then, unless it was added after that
+                if( TBEFORE(prev,e->key) ) {
+                    CHECK( last == NULL || !TBEFORE(e->key,last->key),
+                           "wheel expiration order" );
+                    last = e;
+                }
+                e->queued = 0;
+                --count;
+            }
+            _record( (uint32_t) spent );
+            for( int k = 0; k < HB_TIMERS; ++k ) {
+                CHECK( !_items[k].queued || TBEFORE(now,_items[k].key),
+                       "wheel held an item too long" );
+            }
+        } else if( it->queued && (r & 8) ) {
+            t = _start();
+            void *data = _wheel_cancel( w, it );
+            _stop( t );
+            CHECK( data == it, "wheel cancel" );
+            it->queued = 0;
+            --count;
+        } else if( !it->queued ) {
+            it->key = now + _wheel_delay();
+            it->seq = seq++;
+            t = _start();
+            _wheel_add( w, it, it->key );
+            _stop( t );
+            it->queued = 1;
+            ++count;
+        } else {
+            // cancelling something that isn't there is harmless
+            item_t *idle = &_items[HB_TIMERS];
+            CHECK( _wheel_cancel(w, idle) == NULL, "wheel cancel idle" );
+        }
+        CHECK( _wheel_length(w) == count, "wheel length" );
+
+        time_t when;
+        if( count == 0 ) {
+            CHECK( _wheel_next(w, &when) == E_EMPTY, "wheel next empty" );
+        } else {
+            CHECK( _wheel_next(w, &when) == E_SUCCESS, "wheel next" );
+        }
+    }
+
+    _report( "wheel timers" );
+
+    for( int i = 0; i < HB_TIMERS; ++i ) {
+        if( _items[i].queued ) {
+            CHECK( _wheel_cancel(w, &_items[i]) == &_items[i],
+                   "wheel drain" );
+            _items[i].queued = 0;
+        }
+    }
+    CHECK( _wheel_length(w) == 0, "wheel drain" );
+
+    _wheel_delete( w );
+}
+
+/**
+** _bench_sleep() - per-tick cost of waking sleepers
+**
+** Simulates the clock ISR with a population of processes that each
+** go back to sleep for a random time as soon as they are awakened,
+** timing all the work done in each tick.  This is run against the
+** sleep wheel and against an intrusive ordered queue.
+**
+** @param n      Number of sleepers
+** @param wheel  Use a wheel (true) or a queue (false)
+*/
+static void _bench_sleep( uint32_t n, bool_t wheel ) {
+    wheel_t w = NULL;
+    queue_t q = NULL;
+    time_t now = 0;
+    char name[24];
+
+    CHECK( n <= HB_SLEEPERS, "too many sleepers" );
+
+    if( wheel ) {
+        w = _wheel_create( WLINK_OFFSET(sleeper_t,wake), now );
+        CHECK( w != NULL, "wheel creation failed" );
+    } else {
+        q = _queue_create_linked( _cmp, QLINK_OFFSET(sleeper_t,link) );
+        CHECK( q != NULL, "queue creation failed" );
+    }
+
+    for( uint32_t i = 0; i < n; ++i ) {
+        time_t delay = 1 + _hb_random() % 1000;
+        if( wheel ) {
+            _wheel_add( w, &_sleepers[i], now + delay );
+        } else {
+            CHECK( _queue_add(q, &_sleepers[i], now + delay) == E_SUCCESS,
+                   "sleep queue add" );
+        }
+    }
+
+    for( int i = 0; i < HB_TICKS; ++i ) {
+        sleeper_t *s;
+        void *data;
+        key_t key;
+
+        ++now;
+        uint64_t t = _start();
+        if( wheel ) {
+            while( (s = _wheel_expire(w, now)) != NULL ) {
+                _wheel_add( w, s, now + 1 + _hb_random() % 1000 );
+            }
+        } else {
+            while( _queue_kpeek(q, &key) == E_SUCCESS && key <= now ) {
+                _queue_remove( q, &data );
+                _queue_add( q, data, now + 1 + _hb_random() % 1000 );
+            }
+        }
+        _stop( t );
+    }
+
+    __sprint( name, "%s sleep @%d", wheel ? "wheel" : "linked", n );
+    _report( name );
+
+    if( wheel ) {
+        CHECK( _wheel_length(w) == n, "sleep wheel length" );
+        for( uint32_t i = 0; i < n; ++i ) {
+            _wheel_cancel( w, &_sleepers[i] );
+        }
+        _wheel_delete( w );
+    } else {
+        CHECK( _queue_length(q) == n, "sleep queue length" );
+        for( uint32_t i = 0; i < n; ++i ) {
+            _queue_remove_specific( q, &_sleepers[i] );
+        }
+        _queue_delete( q );
+    }
+}
+
+/*
+** PUBLIC FUNCTIONS
+*/
+
+int main( void ) {
+
+    if( _hb_setup(HB_PAGES) < 0 ) {
+        return( 1 );
+    }
+
+    // same order as _kinit()
+    _km_init();
+    _kmem_cache_init();
+    _queue_init();
+    __cio_puts( "\n\n" );
+
+    _bench_pages();
+    _bench_kmalloc();
+    _bench_fifo( QK_LIST );
+    _bench_fifo( QK_LINKED );
+    for( int kind = 0; kind < N_KINDS; ++kind ) {
+        _bench_ordered( kind );
+    }
+
+    __cio_puts( "\n" );
+    for( uint32_t depth = 10; depth <= 1000; depth *= 10 ) {
+        for( int kind = 0; kind < N_KINDS; ++kind ) {
+            _bench_depth( kind, depth );
+        }
+    }
+
+    __cio_puts( "\n" );
+    _bench_wheel();
+    for( uint32_t n = 10; n <= HB_SLEEPERS; n *= (n < 1000 ? 10 : 5) ) {
+        _bench_sleep( n, false );
+        _bench_sleep( n, true );
+    }
+
+    __cio_puts( "\nall checks passed\n" );
+
+    return( 0 );
+}
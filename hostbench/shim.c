@@ -0,0 +1,262 @@
+/*
+** @file shim.c
+**
+** @author CSCI-452 class of 20215
+**
+** Host-side stand-ins for the OS routines used by kmem.c, slab.c
+** queues.c, wheel.c and lock.c.  See shim.h for details.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "shim.h"
+
+/*
+** PRIVATE DEFINITIONS
+*/
+
+#define HB_PAGE     4096
+
+// BIOS memory map region types
+
+#define HB_USABLE   1
+#define HB_RESERVED 2
+
+/*
+** PRIVATE DATA TYPES
+*/
+
+// one BIOS memory map entry, as left behind by the bootstrap
+
+typedef struct __attribute__((packed)) hb_region_s {
+    uint64_t base;
+    uint64_t length;
+    uint32_t type;
+    uint32_t acpi;
+} hb_region_t;
+
+/*
+** PRIVATE GLOBAL VARIABLES
+*/
+
+// the memory map lives in our BSS, which is below _end, so
+// _km_init() excludes it just as it does on the real system
+
+static uint8_t _hb_mmap[HB_PAGE] __attribute__((aligned(HB_PAGE)));
+
+static uint32_t _hb_cpu_mhz;
+
+static uint32_t _hb_seed = 0x2545f491;
+
+/*
+** PUBLIC GLOBAL VARIABLES
+*/
+
+// where kmem.c finds the memory map
+uint32_t _hb_mmap_address;
+
+// assertion message buffer
+char b512[512];
+
+/*
+** PRIVATE FUNCTIONS
+*/
+
+uint64_t __get_tsc( void );
+
+static int _hb_compare( const void *a, const void *b ) {
+    uint32_t x = *(const uint32_t *) a;
+    uint32_t y = *(const uint32_t *) b;
+
+    return( x < y ? -1 : x > y );
+}
+
+/*
+** PUBLIC FUNCTIONS
+*/
+
+/*
+** Harness services
+*/
+
+int _hb_setup( unsigned int pages ) {
+    uint8_t *arena;
+    uintptr_t base;
+    uint32_t hole;
+    hb_region_t *map;
+
+    // the allocator keeps addresses in 32 bits
+    arena = mmap( NULL, (size_t) (pages + 1) * HB_PAGE,
+                  PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0 );
+    if( arena == MAP_FAILED ) {
+        perror( "hostbench: mmap" );
+        return( -1 );
+    }
+
+    base = ((uintptr_t) arena + HB_PAGE - 1) & ~((uintptr_t) HB_PAGE - 1);
+
+    // split the arena around a reserved hole, with ragged edges on
+    // the usable regions so that _km_init() must round them
+    hole = pages / 2;
+
+    _hb_mmap_address = (uint32_t) (uintptr_t) _hb_mmap;
+    *(int32_t *) _hb_mmap = 3;
+    map = (hb_region_t *) (_hb_mmap + 4);
+
+    map[0].base = base;
+    map[0].length = (uint64_t) hole * HB_PAGE + 100;
+    map[0].type = HB_USABLE;
+    map[0].acpi = 1;
+
+    map[1].base = base + (uint64_t) hole * HB_PAGE;
+    map[1].length = 16 * HB_PAGE;
+    map[1].type = HB_RESERVED;
+    map[1].acpi = 1;
+
+    map[2].base = base + (uint64_t) (hole + 16) * HB_PAGE - 20;
+    map[2].length = (uint64_t) (pages - hole - 16) * HB_PAGE + 20;
+    map[2].type = HB_USABLE;
+    map[2].acpi = 1;
+
+    return( 0 );
+}
+
+unsigned int _hb_tsc_mhz( void ) {
+    struct timespec t0, t1;
+    uint64_t c0, c1, ns;
+
+    if( _hb_cpu_mhz != 0 ) {
+        return( _hb_cpu_mhz );
+    }
+
+    // count TSC ticks across 20ms of wall-clock time
+    clock_gettime( CLOCK_MONOTONIC, &t0 );
+    c0 = __get_tsc();
+    do {
+        clock_gettime( CLOCK_MONOTONIC, &t1 );
+        ns = (t1.tv_sec - t0.tv_sec) * 1000000000ULL +
+             t1.tv_nsec - t0.tv_nsec;
+    } while( ns < 20000000 );
+    c1 = __get_tsc();
+
+    _hb_cpu_mhz = (uint32_t) (((c1 - c0) * 1000) / ns);
+    if( _hb_cpu_mhz == 0 ) {
+        _hb_cpu_mhz = 1;
+    }
+
+    return( _hb_cpu_mhz );
+}
+
+unsigned int _hb_random( void ) {
+
+    // xorshift32
+    _hb_seed ^= _hb_seed << 13;
+    _hb_seed ^= _hb_seed >> 17;
+    _hb_seed ^= _hb_seed << 5;
+
+    return( _hb_seed );
+}
+
+void _hb_sort( unsigned int *samples, unsigned int n ) {
+    qsort( samples, n, sizeof(*samples), _hb_compare );
+}
+
+void _hb_exit( int status ) {
+    fflush( stdout );
+    exit( status );
+}
+
+/*
+** OS routines
+*/
+
+void __cio_putchar( unsigned int c ) {
+    putchar( c );
+}
+
+void __cio_puts( char *str ) {
+    fputs( str, stdout );
+}
+
+void __cio_printf( char *fmt, ... ) {
+    va_list ap;
+
+    va_start( ap, fmt );
+    vprintf( fmt, ap );
+    va_end( ap );
+}
+
+void __sprint( char *dst, char *fmt, ... ) {
+    va_list ap;
+
+    va_start( ap, fmt );
+    vsprintf( dst, fmt, ap );
+    va_end( ap );
+}
+
+void __memclr( void *buf, register unsigned int len ) {
+    memset( buf, 0, len );
+}
+
+void __memcpy( void *dst, register const void *src,
+               register unsigned int len ) {
+    memcpy( dst, src, len );
+}
+
+uint32_t __bsf( uint32_t w ) {
+    return( __builtin_ctz(w) );
+}
+
+uint32_t __bsr( uint32_t w ) {
+    return( 31 - __builtin_clz(w) );
+}
+
+uint64_t __udiv64( uint64_t n, uint32_t d ) {
+    return( n / d );
+}
+
+uint64_t __get_tsc( void ) {
+    uint32_t lo, hi;
+
+    __asm__ __volatile__( "rdtsc" : "=a" (lo), "=d" (hi) );
+
+    return( ((uint64_t) hi << 32) | lo );
+}
+
+// the harness is single-threaded, and runs with "interrupts" off
+
+unsigned int __get_flags( void ) {
+    return( 0 );
+}
+
+void __cli( void ) {
+}
+
+void __sti( void ) {
+}
+
+uint32_t __xchg( volatile uint32_t *p, uint32_t v ) {
+    return( __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST) );
+}
+
+uint32_t __xadd( volatile uint32_t *p, uint32_t v ) {
+    return( __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST) );
+}
+
+void __cpu_relax( void ) {
+    __asm__ __volatile__( "pause" );
+}
+
+void _kpanic( char *msg ) {
+    fprintf( stderr, "\nhostbench: PANIC: %s\n", msg );
+    _hb_exit( 1 );
+}
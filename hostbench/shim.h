@@ -0,0 +1,62 @@
+/*
+** @file shim.h
+**
+** @author CSCI-452 class of 20215
+**
+** Host-side support for the allocator and queue test harness
+**
+** The harness compiles kmem.c, slab.c, queues.c, wheel.c and lock.c as
+** ordinary host code.  shim.c stands in for the pieces of the OS they
+** depend on (console output, __memclr, the TSC, atomics, panics, and
+** the BIOS memory map) and supplies a few host services (time, random numbers,
+** sorting) to the benchmark itself.
+**
+** shim.c is compiled against the host C library and the benchmark
+** against the OS headers, so this header uses only types that mean
+** the same thing in both environments.
+*/
+
+#ifndef SHIM_H_
+#define SHIM_H_
+
+/**
+** _hb_setup() - build a fake BIOS memory map
+**
+** Maps an arena of host memory below the 4GB line and describes it
+** (with a hole and a reserved region in the middle) in a memory map
+** laid out the way the bootstrap leaves it.
+**
+** @param pages  Number of pages of "physical" memory to provide
+**
+** @return 0 on success, else -1
+*/
+int _hb_setup( unsigned int pages );
+
+/**
+** _hb_tsc_mhz() - TSC ticks per microsecond
+**
+** Calibrated against the host clock the first time it is called.
+*/
+unsigned int _hb_tsc_mhz( void );
+
+/**
+** _hb_random() - next value from a fixed-seed pseudo-random sequence
+*/
+unsigned int _hb_random( void );
+
+/**
+** _hb_sort() - sort an array of latency samples into ascending order
+**
+** @param samples  The array
+** @param n        Number of entries in the array
+*/
+void _hb_sort( unsigned int *samples, unsigned int n );
+
+/**
+** _hb_exit() - terminate the harness
+**
+** @param status  Exit status for the host
+*/
+void _hb_exit( int status );
+
+#endif
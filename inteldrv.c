@@ -10,6 +10,7 @@
 #include "inteldrv.h"
 #include "pciscan.h"
 #include "kmem.h"
+#include "slab.h"
 #include "cio.h"
 #include "lib.h"
 #include "x86arch.h"
@@ -221,11 +222,11 @@ static void nic_isr_install(int vector, int code) {
  * @param num_cb command block quantity
  */
 static void cbl_ring_init(struct nic_data* nic, uint32_t num_cb) {
-	struct cb* first = (struct cb*) _km_page_alloc(1);
+	struct cb* first = (struct cb*) _km_page_alloc_zero(1);
 	struct cb* curr = first;
 	curr->status = 0;
 	for(uint32_t i = 0; i < num_cb; i++) {
-		curr->link = (uint32_t) _km_page_alloc(1);
+		curr->link = (uint32_t) _km_page_alloc_zero(1);
 		curr = (struct cb*) curr->link;
 		curr->status = 0;
 	}
@@ -243,17 +244,15 @@ static void cbl_ring_init(struct nic_data* nic, uint32_t num_cb) {
  * @param num_rfd receive frame descriptors quantity
  */
 static void rfa_nic_init(struct nic_data* nic, uint32_t num_rfd) {
-	rfd_t* curr = (rfd_t*) _km_page_alloc(1);
+	rfd_t* curr = (rfd_t*) _km_page_alloc_zero(1); // zeroed RFD header
 	nic->rfa.head = curr;
 	nic->rfa.next = curr;
 	for(uint32_t i = 0; i < num_rfd; i++) {
-		__memset(curr, 0, 16); // zero out the RFD header
 		curr->size = INTEL_RFD_SIZE;
 		curr->command = 1 << 3; // simplified mode
-		curr->link = (uint32_t) _km_page_alloc(1);
+		curr->link = (uint32_t) _km_page_alloc_zero(1);
 		curr = (rfd_t*) curr->link;
 	}
-	__memset(curr, 0, 16); // zero out the RFD header
 	curr->size = INTEL_RFD_SIZE;
 	curr->command = 0x8000 | (1 << 3); // last in the list and simplified
 	nic->rfa.tail = curr;
@@ -278,8 +277,7 @@ static void cb_release() {
  * @return tail of RFA list
  */
 static rfd_t* set_rfa_tail() {
-	rfd_t* curr = (rfd_t*) _km_page_alloc(1);
-	__memset(curr, 0, 16); 
+	rfd_t* curr = (rfd_t*) _km_page_alloc_zero(1); // zeroed RFD header
 	curr->size = INTEL_RFD_SIZE;
 	curr->command = 0x8000 | (1 << 3);
 	return curr;
@@ -651,8 +649,8 @@ void intel_nic_init() {
 	__cio_printf("NIC: Initializing RFA\n");
 	rfa_nic_init(&_nic, RFD_COUNT);
 	__cio_printf("NIC: Initializing ARP cache\n");
-	_arp_cache = (arp_data_t*) _km_page_alloc(1);
-	__memset(_arp_cache, 0, 4096);
+	_arp_cache = (arp_data_t*) _kmalloc(ARP_CACHE_SIZE * sizeof(arp_data_t));
+	__memclr(_arp_cache, ARP_CACHE_SIZE * sizeof(arp_data_t));
 
 	__cio_printf("NIC: Initial configuration\n");
 	struct cb* init_config_cb = get_next_cb();
@@ -110,6 +110,7 @@
 #define TRACE_SIO_WR    0x20
 #define TRACE_SYSCALLS  0x40
 #define TRACE_CONSOLE   0x80
+#define TRACE_STATE     0x100
 
 // expressions for testing trace options
 #define TRACING_PCB         ((TRACE & TRACE_PCB) != 0)
@@ -120,6 +121,7 @@
 #define TRACING_SIO_WR      ((TRACE & TRACE_SIO_WR) != 0)
 #define TRACING_SYSCALLS    ((TRACE & TRACE_SYSCALLS) != 0)
 #define TRACING_CONSOLE     ((TRACE & TRACE_CONSOLE) != 0)
+#define TRACING_STATE       ((TRACE & TRACE_STATE) != 0)
 
 #else
 
@@ -131,6 +133,7 @@
 #define TRACING_SIO_WR      0
 #define TRACING_SYSCALLS    0
 #define TRACING_CONSOLE     0
+#define TRACING_STATE       0
 
 #endif
 
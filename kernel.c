@@ -12,6 +12,7 @@
 
 #include "kernel.h"
 #include "kmem.h"
+#include "slab.h"
 #include "queues.h"
 #include "clock.h"
 #include "process.h"
@@ -23,6 +24,8 @@
 #include "support.h"
 #include "file.h"
 #include "vga.h"
+#include "smp.h"
+#include "lock.h"
 
 
 // need addresses of some user functions
@@ -154,16 +157,22 @@ void _kinit( void ) {
 
     __cio_puts( "Modules:" );
 
+    // this CPU's own data must be in place before anything
+    // refers to the current process
+    _smp_init();
+
     // call the module initialization functions, being
     // careful to follow any module precedence requirements
     //
-    // classic order:  kmem; queue; everything else
+    // classic order:  kmem; slab; queue; everything else
 
     _km_init();     // MUST BE FIRST
+    _kmem_cache_init();
     // other module initialization calls here
-    _queue_init();  // MUST BE SECOND
+    _queue_init();  // MUST BE THIRD
     _pcb_init();
     _stk_init();
+    _vm_init();     // must precede process creation
     _sys_init();
     _sched_init();
     _clk_init();
@@ -174,6 +183,11 @@ void _kinit( void ) {
     select_font(2);
     intel_nic_init();	// initialize network adapter
 #endif
+    // start the other CPUs; they wait for the kernel lock, which
+    // we hold until we return into the first user process
+    _smp_start();
+    // must follow anything that reads the ACPI tables
+    _km_reclaim_acpi();
     __cio_puts( "\nModule initialization complete.\n" );
     __cio_puts( "-------------------------------\n" );
     __delay( 500 );  // about 12.5 seconds
@@ -191,11 +205,14 @@ void _kinit( void ) {
     new->stack = _stk_alloc();
     assert( new->stack != NULL );
 
+    status_t status = _vm_create( new );
+    assert( status == E_SUCCESS );
+
     // fill in the necessary fields
     new->pid = new->ppid = PID_INIT;
-    new->state = New;
+    _pcb_set_state( new, New );
     new->quantum = Q_DEFAULT;
-    new->priority = System;
+    new->priority = new->base = System;
 
     // command-line arguments
     char *args[2] = { "init", NULL };
@@ -203,9 +220,9 @@ void _kinit( void ) {
     // set up the stack
     new->context = _stk_setup( new->stack, (uint32_t) init, args );
 
-    // add to the process table
-    _processes[0] = new;
-    _n_procs = 1;
+    // add to the process table (after the CPUs' idle processes)
+    status = _ptable_add( new );
+    assert( status == E_SUCCESS );
 
     // add it to the ready queue and then give it the CPU
     _schedule( new );
@@ -219,6 +236,9 @@ void _kinit( void ) {
 
     __cio_puts( "System initialization complete.\n" );
     __cio_puts( "-------------------------------\n" );
+
+    // the other CPUs are let in when __isr_restore releases the
+    // kernel lock, once it has switched to init's address space
 }
 
 #ifdef CONSOLE_SHELL
@@ -247,11 +267,37 @@ void _kshell( int ch ) {
 
     case 'q':  // dump the queues
         // code to dump out any/all queues
-        _queue_dump( "Sleep queue", _sleeping );
+        _wheel_dump( "Sleep wheel", _sleeping );
         _queue_dump( "Read queue", _reading );
-        _queue_dump( "Ready queue[System]", _ready[System] );
-        _queue_dump( "Ready queue[User]", _ready[User] );
-        _queue_dump( "Ready queue[Deferred]", _ready[Deferred] );
+        for( uint32_t i = 0; i < _n_cpus; ++i ) {
+            __cio_printf( "CPU %d:\n", i );
+            // (every level, since MLFQ demotes processes below User)
+            for( int level = 0; level < N_PRIOS; ++level ) {
+                if( _queue_length(_cpus[i].ready[level]) > 0 ) {
+                    char name[24];
+                    __sprint( name, "Ready queue[%d]", level );
+                    _queue_dump( name, _cpus[i].ready[level] );
+                }
+            }
+        }
+        _queue_dump( "Fair queue", _fair );
+        _queue_dump( "EDF queue", _edf );
+        break;
+
+    case 'o':  // toggle the once-a-second "top" display
+        _top_live = !_top_live;
+        if( _top_live ) {
+            _ptable_top();
+        }
+        break;
+
+    case 'e':  // EDF tasks and deadline misses
+        __cio_putchar( '\n' );
+        _sched_edf_dump();
+        break;
+
+    case 't':  // timer interrupt rates since the last report
+        _clk_dump();
         break;
 
     case 'a':  // dump the active table
@@ -262,19 +308,39 @@ void _kshell( int ch ) {
         _ptable_dump( "\nActive processes", true );
         break;
 
+    case 'l':  // wakeup latency histograms since the last report
+        __cio_putchar( '\n' );
+        _sched_lat_dump( true );
+        break;
+
+    case 'u':  // per-CPU information
+        __cio_putchar( '\n' );
+        _smp_dump();
+        break;
+
+    case 'k':  // lock statistics since the last report
+        __cio_putchar( '\n' );
+        _lock_dump( true );
+        break;
+
+    case 'm':  // dump memory allocator information
+        __cio_puts( "\nMemory allocators:\n" );
+        _km_dump();
+        _kmem_cache_dump();
+        _vm_dump();
+        break;
+
     case 'c':  // dump context info for all active PCBs
         _context_dump_all( "\nContext dump" );
         break;
 
     case 's':  // dump stack info for all active PCBS
         __cio_puts( "\nActive stacks (w/5-sec. delays):\n" );
-        for( int i = 0; i < N_PROCS; ++i ) {
-            pcb_t *pcb = _processes[i];
-            if( pcb != NULL && pcb->state != Free ) {
-                __cio_printf( "pid %5d: ", pcb->pid );
-                __cio_printf( "EIP %08x, ", pcb->context->eip );
-                _stk_dump( NULL, pcb->stack, 12 );
-            }
+        for( uint32_t i = 0; i < _n_procs; ++i ) {
+            pcb_t *pcb = PTABLE( i );
+            __cio_printf( "pid %5d: ", pcb->pid );
+            __cio_printf( "EIP %08x, ", REG(pcb,eip) );
+            _stk_dump( NULL, pcb->stack, 12 );
         }
         break;
  
@@ -286,10 +352,17 @@ void _kshell( int ch ) {
         __cio_puts( "\nCommands:\n" );
         __cio_puts( "   a  -- dump the active table\n" );
         __cio_puts( "   c  -- dump contexts for active processes\n" );
+        __cio_puts( "   e  -- dump EDF tasks and deadline misses\n" );
         __cio_puts( "   h  -- this message\n" );
+        __cio_puts( "   k  -- dump lock statistics (and reset them)\n" );
+        __cio_puts( "   l  -- report wakeup latencies (and reset them)\n" );
+        __cio_puts( "   m  -- dump memory allocator statistics\n" );
+        __cio_puts( "   o  -- toggle the per-second CPU usage display\n" );
         __cio_puts( "   p  -- dump the active table and all PCBs\n" );
         __cio_puts( "   q  -- dump the queues\n" );
         __cio_puts( "   s  -- dump stacks for active processes\n" );
+        __cio_puts( "   t  -- report timer interrupt rates\n" );
+        __cio_puts( "   u  -- dump per-CPU information\n" );
         __cio_puts( "   x  -- exit\n" );
         break;
     }
@@ -12,25 +12,25 @@
 ** This allocator functions as a simple "slab" allocator; it allows
 ** allocation of either 4096-byte ("page") or 1024-byte ("slice")
 ** chunks of memory from the free pool.  The free pool is initialized
-** using the memory map provided by the BIOS during the boot sequence,
-** and contains a series of blocks which are multiples of 4K bytes and
-** which are aligned at 4K boundaries; they are held in the free list
-** in order by base address.
-**
-** The "page" allocator allows allocation of one or more 4K blocks
-** at a time.  Requests are made for a specific number of 4K pages;
-** the allocator locates the first free list entry that contains at
-** least the requested amount of space.  If that entry is the exact
-** size requested, it is unlinked and returned; otherwise, the entry
-** is split into a chunk of the requested size and the remainder.
-** The chunk is returned, and the remainder replaces the original
-** block in the free list.  On deallocation, the block is inserted
-** at the appropriate place in the free list, and physically adjacent
-** blocks are coalesced into single, larger blocks.  If a multi-page
-** block is allocated, it should be deallocated one page at a time,
-** because there is no record of the size of the original allocation -
-** all we know is that it is N*4K bytes in length, so it's up to the
-** requesting code to figure this out.
+** using the memory map provided by the BIOS during the boot sequence.
+**
+** The "page" allocator is a binary buddy allocator.  Free memory is
+** kept as blocks of 2^k pages (k = 0 .. KM_MAX_ORDER), each aligned
+** on a 2^k-page boundary, with one free list per order.  A request for
+** N pages is rounded up to the next order; the first non-empty list at
+** or above that order supplies a block, which is split in half until
+** it is the right size (the unused halves go back on the lower-order
+** lists).  Any pages beyond the N that were requested are immediately
+** returned to the free pool, so a request never consumes more than N
+** pages.  On deallocation, each freed block is merged with its "buddy"
+** (the other half of the next-larger block) for as long as the buddy
+** is also free.  Both operations take O(log n) time.
+**
+** Per-page bookkeeping lives in a table of Pageinfo descriptors (one per
+** page frame, from the lowest to the highest usable page), which is
+** carved out of free memory during initialization.  The descriptor for
+** the first page of an allocated block records its length, so a multi-
+** page block is freed with a single call.
 **
 ** The "slice" allocator operates by taking blocks from the "page"
 ** allocator and splitting them into four 1K slices, which it then
@@ -38,9 +38,16 @@
 ** list contains an available slice, it is unlinked and returned;
 ** otherwise, a page is requested from the page allocator, split into
 ** slices, and the slices are added to the free list, after which the
-** first one is returned.  The slice free list is a simple linked list
+** first one is returned.  The slice free list is a doubly-linked list
 ** of these 1K blocks; because they are all the same size, no ordering
-** is done on the free list, and no coalescing is performed.
+** is done on the free list.  The descriptor for each carved page keeps
+** a mask of which of its slices are free; when all four are free again
+** (and other free slices remain), the page is returned to the page
+** allocator.
+**
+** Nothing in the kernel allocates slices any more; the PCB, queue and
+** file allocators that used them now use slab caches (see slab.c),
+** which give empty slabs back to the page allocator themselves.
 **
 */
 
@@ -54,6 +61,8 @@
 #include "cio.h"
 
 #include "kmem.h"
+#include "lock.h"
+#include "vm.h"
 
 /*
 ** PRIVATE DEFINITIONS
@@ -73,31 +82,101 @@
 #define P2B(x)   ((x) << LOG2_OF_PAGE_SIZE)
 #define B2P(x)   ((x) >> LOG2_OF_PAGE_SIZE)
 
-/*
-** Name:    adjacent
-**
-** Arguments:   addresses of two blocks
-**
-** Description: Determines whether the second block immediately
-**      follows the first one.
-*/
-#define adjacent(first,second)  \
-    ( (void *) (first) + P2B((first)->pages) == (void *) (second) )
+// converters:  addresses to page frame numbers, and vice versa
+
+#define A2PFN(a)    (((uint32_t) (a)) >> LOG2_OF_PAGE_SIZE)
+#define PFN2A(n)    ((void *) P2B((uint32_t) (n)))
+
+// number of pages in a block of a given order
+
+#define ORDER_PAGES(o)  (1 << (o))
+
+// descriptor for a specific page frame (which must be in range!)
+
+#define PGINFO(pfn)     (&_page_info[(pfn) - _first_pfn])
+
+// is this page frame covered by the descriptor table?
+
+#define IN_RANGE(pfn)   ((pfn) >= _first_pfn && (pfn) < _last_pfn)
+
+// maximum number of usable regions we will track during initialization
+
+#define N_RANGES    32
+
+// location of the BIOS memory map data; the host-side test harness
+// (see hostbench/) builds its own map elsewhere
+
+#ifdef HOSTBENCH
+extern uint32_t _hb_mmap_address;
+#define KM_MMAP_ADDRESS     _hb_mmap_address
+#else
+#define KM_MMAP_ADDRESS     MMAP_ADDRESS
+#endif
+
+// bytes to pages, rounded up
+
+#define B2P_UP(x)   B2P((x) + SZ_PAGE - 1)
+
+// page descriptor flag bits
+
+#define PG_RESERVED 0x01    // not managed by the allocator
+#define PG_FREE     0x02    // first page of a free block
+#define PG_ALLOC    0x04    // first page of an allocated block
+
+// number of slices in a page, and the slice mask for a whole page
+
+#define SLICES_PER_PAGE (SZ_PAGE / SZ_SLICE)
+#define ALL_SLICES      ((1 << SLICES_PER_PAGE) - 1)
+
+// which slice of its page a slice is
+
+#define SLICE_INDEX(a)  ((((uint32_t) (a)) & (SZ_PAGE - 1)) / SZ_SLICE)
+
+// number of allocations made and allocate/free pairs timed
+// by the boot-time self-check
+
+#define N_TESTS     8
+#define N_TIMED     64
 
 /*
 ** PRIVATE DATA TYPES
 */
 
 /*
-** This structure keeps track of a single block of memory.  All blocks
-** are multiples of the base size (currently, 4KB).
+** This structure keeps track of a single free block of memory.  It
+** lives in the first bytes of the block itself.  All blocks are
+** multiples of the base size (currently, 4KB); slices reuse this
+** structure, but only use the 'next' and 'prev' links.
 */
 
 typedef struct blkinfo_s {
     uint32_t pages;           // length of this block, in pages
     struct   blkinfo_s *next; // pointer to the next free block
+    struct   blkinfo_s *prev; // pointer to the previous free block
 } Blockinfo;
 
+/*
+** Per-page descriptor.  There is one of these for every page frame
+** between the lowest and highest usable pages in the system.
+*/
+
+typedef struct pginfo_s {
+    uint8_t  flags;     // PG_* bits
+    uint8_t  order;     // order of the free block starting here, or
+                        // free slice mask for a page carved into slices
+    uint16_t count;     // length (pages) of the allocation starting here
+    void     *owner;    // subsystem-private tag (e.g., owning slab)
+} Pageinfo;
+
+/*
+** A simple usable range of memory, in page frame numbers
+*/
+
+typedef struct range_s {
+    uint32_t first;     // first page frame in the range
+    uint32_t last;      // first page frame beyond the range
+} Range;
+
 /*
 ** Memory region information returned by the BIOS
 **
@@ -156,12 +235,52 @@ typedef struct memregion_s {
 */
 
 // freespace pools
-static Blockinfo *_free_pages;
+static Blockinfo *_free_pages[KM_ORDERS];
 static Blockinfo *_free_slices;
 
+// number of blocks on each page free list
+static uint32_t _free_blocks[KM_ORDERS];
+
+// page descriptor table, and the range of page frames it covers
+static Pageinfo *_page_info;
+static uint32_t _first_pfn;
+static uint32_t _last_pfn;
+
+// page allocator counters
+static uint32_t _pages_total;       // pages under management
+static uint32_t _pages_free;        // pages currently in the free pool
+static uint32_t _pages_peak;        // most pages ever allocated at once
+static uint32_t _page_allocs;       // successful allocations
+static uint32_t _page_frees;        // deallocations
+static uint32_t _page_fails;        // failed allocations
+static uint64_t _alloc_cycles;      // total TSC cycles spent allocating
+static uint64_t _free_cycles;       // total TSC cycles spent freeing
+
+// pool of pre-zeroed pages, linked through their Blockinfo next fields
+static Blockinfo *_zero_pages;
+static uint32_t _zero_count;        // pages in the pool
+static uint32_t _zero_hits;         // zeroed requests served from the pool
+static uint32_t _zero_misses;       // zeroed requests we had to clear
+
+// slice allocator counters
+static uint32_t _slice_allocs;
+static uint32_t _slice_frees;
+static uint32_t _slices_free;
+static uint32_t _slice_pages;       // pages currently carved into slices
+static uint32_t _slice_reclaims;    // pages given back to the page pool
+
+// ACPI reclaimable regions, held back until _km_reclaim_acpi()
+static Range _acpi_ranges[N_RANGES];
+static int _n_acpi;
+
 // initialization status
 static int _km_initialized = 0;
 
+// the page pools (and their counters), and the slice free list;
+// _slice_lock may be held while taking _page_lock, never the reverse
+static lock_t _page_lock;
+static lock_t _slice_lock;
+
 /*
 ** IMPORTED GLOBAL VARIABLES
 */
@@ -173,82 +292,330 @@ extern int _end;    // end of the BSS section - provided by the linker
 */
 
 /*
-** FREE LIST MANAGEMENT
+** BUDDY SYSTEM SUPPORT
 */
 
 /**
-** Name:    _add_block
+** Name:    _order_of
+**
+** Determine the smallest block order that holds a given number of pages
 **
-** Add a block to the free list
+** @param count  Number of pages (must be at least 1)
 **
-** @param base   Base address of the block
-** @param length Block length, in bytes
+** @return the order, or KM_ORDERS if the request is too large
 */
-static void _add_block( uint32_t base, uint32_t length ) {
-    Blockinfo *block;
+static uint32_t _order_of( uint32_t count ) {
+    uint32_t order = 0;
 
-    // don't add it if it isn't at least 4K
-    if( length < SZ_PAGE ) {
-        return;
+    while( order < KM_ORDERS && ORDER_PAGES(order) < count ) {
+        ++order;
     }
 
-    // only want to add multiples of 4K; check the lower bits
-    if( (length & 0xfff) != 0 ) {
-        // round it down to 4K
-        length &= 0xfffff000;
+    return( order );
+}
+
+/**
+** Name:    _list_add
+**
+** Put a block at the front of the free list for its order
+**
+** @param pfn    First page frame of the block
+** @param order  Order of the block
+*/
+static void _list_add( uint32_t pfn, uint32_t order ) {
+    Blockinfo *block = (Blockinfo *) PFN2A( pfn );
+    Pageinfo *info = PGINFO( pfn );
+
+    block->pages = ORDER_PAGES( order );
+    block->prev = NULL;
+    block->next = _free_pages[order];
+    if( block->next != NULL ) {
+        block->next->prev = block;
     }
+    _free_pages[order] = block;
+    _free_blocks[order] += 1;
 
-    // create the "block"
+    info->flags = PG_FREE;
+    info->order = order;
+    info->count = 0;
+}
 
-    block = (Blockinfo *) base;
-    block->pages = B2P(length);
-    block->next = NULL;
+/**
+** Name:    _list_remove
+**
+** Unlink a block from the free list for its order
+**
+** @param pfn    First page frame of the block
+** @param order  Order of the block
+*/
+static void _list_remove( uint32_t pfn, uint32_t order ) {
+    Blockinfo *block = (Blockinfo *) PFN2A( pfn );
 
-    /*
-    ** We maintain the free list in order by address, to simplify
-    ** coalescing adjacent free blocks.
-    **
-    ** Handle the easiest case first.
-    */
+    if( block->prev == NULL ) {
+        _free_pages[order] = block->next;
+    } else {
+        block->prev->next = block->next;
+    }
+    if( block->next != NULL ) {
+        block->next->prev = block->prev;
+    }
+    _free_blocks[order] -= 1;
 
-    if( _free_pages == NULL ) {
-        _free_pages = block;
-        return;
+    PGINFO( pfn )->flags = 0;
+}
+
+/**
+** Name:    _buddy_free
+**
+** Return a properly-aligned block to the free pool, merging it with
+** its buddy for as long as the buddy is also free.
+**
+** @param pfn    First page frame of the block
+** @param order  Order of the block
+*/
+static void _buddy_free( uint32_t pfn, uint32_t order ) {
+
+    while( order < KM_MAX_ORDER ) {
+        uint32_t buddy = pfn ^ ORDER_PAGES( order );
+
+        // the buddy must exist, and be a free block of the same size
+        if( !IN_RANGE(buddy) ) {
+            break;
+        }
+
+        Pageinfo *info = PGINFO( buddy );
+        if( (info->flags & PG_FREE) == 0 || info->order != order ) {
+            break;
+        }
+
+        // merge them; the combined block starts at the lower address
+        _list_remove( buddy, order );
+        if( buddy < pfn ) {
+            pfn = buddy;
+        }
+        ++order;
     }
 
-    /*
-    ** Unfortunately, it's not always that easy....
-    **
-    ** Find the correct insertion spot.
-    */
+    _list_add( pfn, order );
+}
+
+/**
+** Name:    _free_range
+**
+** Return an arbitrary run of pages to the free pool by breaking it
+** into the largest naturally-aligned power-of-two blocks possible.
+**
+** @param pfn    First page frame in the run
+** @param count  Number of pages in the run
+*/
+static void _free_range( uint32_t pfn, uint32_t count ) {
 
-    Blockinfo *prev, *curr;
+    _pages_free += count;
 
-    prev = NULL;
-    curr = _free_pages;
+    while( count > 0 ) {
+        uint32_t order = 0;
 
-    while( curr && curr < block ) {
-        prev = curr;
-        curr = curr->next;
+        // grow the block while it stays aligned and within the run
+        while( order < KM_MAX_ORDER &&
+               (pfn & (ORDER_PAGES(order + 1) - 1)) == 0 &&
+               ORDER_PAGES(order + 1) <= count ) {
+            ++order;
+        }
+
+        _buddy_free( pfn, order );
+
+        pfn += ORDER_PAGES( order );
+        count -= ORDER_PAGES( order );
     }
+}
 
-    // the new block always points to its successor
-    block->next = curr;
+/*
+** INITIALIZATION
+*/
 
-    /*
-    ** If prev is NULL, we're adding at the front; otherwise,
-    ** we're adding after some other entry (middle or end).
-    */
+/**
+** Name:    _add_range
+**
+** Add a memory region to a range list being built by _km_init().
+** Only whole pages within the region are kept.
+**
+** @param ranges  The range list
+** @param n       Number of entries currently in the list
+** @param base    Base address of the region
+** @param length  Region length, in bytes
+**
+** @return the new number of entries in the list
+*/
+static int _add_range( Range *ranges, int n, uint32_t base, uint32_t length ) {
 
-    if( prev == NULL ) {
-        // sanity check - both pointers can't be NULL
-        assert( curr );
-        // add at the beginning
-        _free_pages = block;
-    } else {
-        // inserting in the middle or at the end
-        prev->next = block;
+    // round the base up and the end down to page boundaries
+    uint32_t first = B2P( base + SZ_PAGE - 1 );
+    uint32_t last = B2P( base + length );
+
+    // don't add it if there isn't at least one full page
+    if( base + SZ_PAGE - 1 < base || last <= first ) {
+        return( n );
+    }
+
+    if( n >= N_RANGES ) {
+        WARNING( "too many memory regions" );
+        return( n );
+    }
+
+    ranges[n].first = first;
+    ranges[n].last = last;
+
+    return( n + 1 );
+}
+
+/**
+** Name:    _exclude
+**
+** Remove a span of addresses from every range in a range list,
+** splitting ranges as needed.  Any page that the span touches
+** is removed.
+**
+** @param ranges  The range list
+** @param n       Number of entries currently in the list
+** @param start   First address to be excluded
+** @param end     First address beyond the excluded span
+**
+** @return the new number of entries in the list
+*/
+static int _exclude( Range *ranges, int n, uint32_t start, uint32_t end ) {
+    uint32_t first = B2P( start );
+    uint32_t last = B2P( end + SZ_PAGE - 1 );
+
+    // only look at the entries we started with
+    int count = n;
+
+    for( int i = 0; i < count; ++i ) {
+        Range *r = &ranges[i];
+
+        // no overlap?
+        if( r->last <= first || r->first >= last ) {
+            continue;
+        }
+
+        if( r->first < first && r->last > last ) {
+            // the span is in the middle; keep the upper part separately
+            if( n < N_RANGES ) {
+                ranges[n].first = last;
+                ranges[n].last = r->last;
+                ++n;
+            } else {
+                WARNING( "too many memory regions" );
+            }
+            r->last = first;
+        } else if( r->first < first ) {
+            // it overlaps the end of the range
+            r->last = first;
+        } else if( r->last > last ) {
+            // it overlaps the beginning of the range
+            r->first = last;
+        } else {
+            // the whole range is covered; leave it empty
+            r->last = r->first;
+        }
+    }
+
+    return( n );
+}
+
+/**
+** Name:    _exclude_all
+**
+** Remove the areas that must never be allocated from a range list.
+** See Memory.txt for the layout of the first 64KB.
+**
+** @param ranges  The range list
+** @param n       Number of entries currently in the list
+** @param mmap_end  First address beyond the BIOS memory map data
+**
+** @return the new number of entries in the list
+*/
+static int _exclude_all( Range *ranges, int n, uint32_t mmap_end ) {
+
+    // interrupt vectors, BIOS data, GDT, IDT, and the memory map
+    n = _exclude( ranges, n, 0, mmap_end );
+
+    // the AP startup code, bootstrap code, the bootstrap stack,
+    // and the OS stack
+    n = _exclude( ranges, n, AP_TRAMPOLINE_ADDRESS, TARGET_STACK );
+
+    // the OS itself
+    n = _exclude( ranges, n, TARGET_ADDRESS, (uint32_t) &_end );
+
+    // the user window, which is mapped differently in every process
+    n = _exclude( ranges, n, VM_WINDOW, VM_WINDOW_END );
+
+    return( n );
+}
+
+/**
+** Name:    _km_selftest
+**
+** Boot-time check of the buddy allocator.  Allocates and frees a
+** collection of blocks, verifying alignment and that everything is
+** completely coalesced afterward; also times a run of single-page
+** allocate/free pairs.
+*/
+static void _km_selftest( void ) {
+    static const uint32_t sizes[N_TESTS] = { 1, 2, 3, 4, 7, 16, 5, 1 };
+    uint32_t before[KM_ORDERS];
+    uint8_t *blocks[N_TESTS];
+    uint32_t free_before = _pages_free;
+    uint32_t used = 0;
+
+    for( int i = 0; i < KM_ORDERS; ++i ) {
+        before[i] = _free_blocks[i];
+    }
+
+    // allocate a mix of sizes, checking the alignment of each
+    for( int i = 0; i < N_TESTS; ++i ) {
+        blocks[i] = (uint8_t *) _km_page_alloc( sizes[i] );
+        if( blocks[i] == NULL ) {
+            // not enough memory to run the test; undo and leave
+            while( --i >= 0 ) {
+                _km_page_free( blocks[i] );
+            }
+            return;
+        }
+        uint32_t mask = ORDER_PAGES( _order_of(sizes[i]) ) - 1;
+        assert( (A2PFN(blocks[i]) & mask) == 0 );
+        // scribble on the first and last pages
+        *(uint32_t *) blocks[i] = i;
+        *(uint32_t *) (blocks[i] + P2B(sizes[i] - 1)) = i;
+        used += sizes[i];
+    }
+
+    assert( _pages_free == free_before - used );
+
+    // release them in a different order than we got them
+    for( int i = 0; i < N_TESTS; i += 2 ) {
+        assert( *(uint32_t *) blocks[i] == i );
+        _km_page_free( blocks[i] );
+    }
+    for( int i = 1; i < N_TESTS; i += 2 ) {
+        assert( *(uint32_t *) (blocks[i] + P2B(sizes[i] - 1)) == i );
+        _km_page_free( blocks[i] );
+    }
+
+    // everything should have merged back to where we started
+    assert( _pages_free == free_before );
+    for( int i = 0; i < KM_ORDERS; ++i ) {
+        assert( _free_blocks[i] == before[i] );
     }
+
+    // time some single-page operations
+    uint64_t start = __get_tsc();
+    for( int i = 0; i < N_TIMED; ++i ) {
+        _km_page_free( _km_page_alloc(1) );
+    }
+    uint32_t cycles = (uint32_t) (__get_tsc() - start);
+
+    __cio_printf( " %d pages free, %d cyc/op", _pages_free,
+                  cycles / (2 * N_TIMED) );
 }
 
 /**
@@ -264,41 +631,45 @@ static void _add_block( uint32_t base, uint32_t length ) {
 void _km_init( void ) {
     int32_t entries;
     Region *region;
-    uint64_t cutoff;
+    Range ranges[N_RANGES];
+    int nranges = 0;
+
+    // memory map totals, in KB, for the boot summary
+    uint32_t usable_kb = 0;
+    uint32_t reserved_kb = 0;
+    uint32_t acpi_kb = 0;
 
     // announce that we're starting initialization
     __cio_puts( " Kmem:" );
 
+    _lock_init( &_page_lock, "kpages", LOCK_SPIN );
+    _lock_init( &_slice_lock, "kslices", LOCK_SPIN );
+
     // initially, nothing in the free lists
     _free_slices = NULL;
-    _free_pages = NULL;
-
-    /*
-    ** We ignore all memory below the end of our OS.  In theory,
-    ** we should be able to re-use much of that space; in practice,
-    ** this is safer.
-    */
-
-    // set our cutoff point as the end of the BSS section
-    cutoff = (uint32_t) &_end;
-
-    // round it up to the next multiple of 4K (0x1000)
-    if( cutoff & 0xfffLL ) {
-        cutoff &= 0xfffff000LL;
-    cutoff += 0x1000LL;
+    for( int i = 0; i < KM_ORDERS; ++i ) {
+        _free_pages[i] = NULL;
+        _free_blocks[i] = 0;
     }
+    _pages_free = 0;
+    _zero_pages = NULL;
+    _zero_count = _zero_hits = _zero_misses = 0;
+    _slice_allocs = _slice_frees = _slices_free = 0;
+    _slice_pages = _slice_reclaims = 0;
+    _pages_total = _pages_peak = 0;
+    _n_acpi = 0;
 
     // get the list length
-    entries = *((int32_t *) MMAP_ADDRESS);
+    entries = *((int32_t *) KM_MMAP_ADDRESS);
 
     // if there are no entries, we have nothing to do!
     if( entries < 1 ) {  // note: entries == -1 could occur!
         return;
     }
 
-    // iterate through the entries, adding things to the freelist
+    // iterate through the entries, collecting the usable regions
 
-    region = ((Region *) (MMAP_ADDRESS + 4));
+    region = ((Region *) (KM_MMAP_ADDRESS + 4));
 
     for( int i = 0; i < entries; ++i, ++region ) {
 
@@ -309,118 +680,345 @@ void _km_init( void ) {
         **
         **  ACPI indicates it should be ignored
         **  ACPI indicates it's non-volatile memory
-        **  Region type isn't "usable"
+        **  Region type isn't "usable" or "ACPI reclaimable"
         **  Region is above the 4GB address limit
         **
-        ** Currently, only "normal" (type 1) regions are considered
-        ** "usable" for our purposes.  We could potentially expand
-        ** this to include ACPI "reclaimable" memory.
+        ** "Normal" (type 1) regions are usable immediately; ACPI
+        ** "reclaimable" (type 3) regions are remembered, and are
+        ** added by _km_reclaim_acpi() once the ACPI tables they
+        ** hold are no longer needed.
         */
 
-        // first, check the ACPI one-bit flags
-
-        if( ((region->acpi) & REGION_IGNORE) == 0 ) {
+        // ignore it if it's above 4GB
+        if( region->base.HIGH != 0 ) {
             continue;
         }
 
-        if( ((region->acpi) & REGION_NONVOL) != 0 ) {
-            continue;  // we'll ignore this, too
+        // grab the two 64-bit values to simplify things
+        uint64_t base   = region->base.all;
+        uint64_t length = region->length.all;
+
+        // see if it extends beyond the 4GB boundary
+
+        if( (base + length) > ADDR_32_MAX ) {
+
+            // OK, it extends beyond the 32-bit limit; figure out
+            // how far over it goes, and lop off that portion
+
+            uint64_t loss = (base + length) - ADDR_64_FIRST;
+            length -= loss;
         }
 
-        // next, the region type
+        uint32_t b32 = base   & ADDR_LOW_HALF;
+        uint32_t l32 = length & ADDR_LOW_HALF;
 
-        if( (region->type) != REGION_USABLE ) {
-            continue;  // we won't attempt to reclaim ACPI memory (yet)
+        // check the ACPI one-bit flags
+
+        if( ((region->acpi) & REGION_IGNORE) == 0 ||
+                ((region->acpi) & REGION_NONVOL) != 0 ) {
+            reserved_kb += l32 >> 10;
+            continue;
         }
 
-        // OK, we have a "normal" memory region - verify that it's usable
+        // next, the region type
 
-        // ignore it if it's above 4GB
-        if( region->base.HIGH != 0 ) {
+        if( (region->type) == REGION_ACPI_RECL ) {
+            acpi_kb += l32 >> 10;
+            _n_acpi = _add_range( _acpi_ranges, _n_acpi, b32, l32 );
             continue;
         }
 
-        // grab the two 64-bit values to simplify things
-        uint64_t base   = region->base.all;
-        uint64_t length = region->length.all;
+        if( (region->type) != REGION_USABLE ) {
+            reserved_kb += l32 >> 10;
+            continue;
+        }
 
-        // see if it's below our arbitrary cutoff point
-        if( base < cutoff ) {
+        // we survived the gauntlet - remember the region
 
-            // is the whole thing too low, or just part?
-            if( (base + length) < cutoff ) {
-                // it's all below the cutoff!
-                continue;
-            }
+        usable_kb += l32 >> 10;
+        nranges = _add_range( ranges, nranges, b32, l32 );
+    }
 
-            // recalculate the length, starting at our cutoff point
-            uint64_t loss = cutoff - base;
+    /*
+    ** Carve out the parts of memory that are already in use.
+    */
 
-            // reset the length and the base address
-            length -= loss;
-            base = cutoff;
-        }
+    uint32_t mmap_end = KM_MMAP_ADDRESS + 4 + entries * sizeof(Region);
 
-        // see if it extends beyond the 4GB boundary
+    nranges = _exclude_all( ranges, nranges, mmap_end );
+    _n_acpi = _exclude_all( _acpi_ranges, _n_acpi, mmap_end );
 
-        if( (base + length) > ADDR_32_MAX ) {
+    /*
+    ** Determine the span of page frames we must describe (including
+    ** the ACPI regions we will add later), and find a home for the
+    ** descriptor table in the first region that is large enough
+    ** to hold it.
+    */
 
-            // OK, it extends beyond the 32-bit limit; figure out
-            // how far over it goes, and lop off that portion
+    _first_pfn = 0xffffffff;
+    _last_pfn = 0;
+    for( int i = 0; i < nranges + _n_acpi; ++i ) {
+        Range *r = i < nranges ? &ranges[i] : &_acpi_ranges[i - nranges];
+        if( r->first >= r->last ) {
+            continue;
+        }
+        if( r->first < _first_pfn ) {
+            _first_pfn = r->first;
+        }
+        if( r->last > _last_pfn ) {
+            _last_pfn = r->last;
+        }
+    }
 
-            uint64_t loss = (base + length) - ADDR_64_FIRST;
-            length -= loss;
+    if( _last_pfn <= _first_pfn ) {
+        return;
+    }
+
+    uint32_t npages = _last_pfn - _first_pfn;
+    uint32_t tpages = B2P_UP( npages * sizeof(Pageinfo) );
+
+    _page_info = NULL;
+    for( int i = 0; i < nranges; ++i ) {
+        if( ranges[i].last - ranges[i].first > tpages ) {
+            _page_info = (Pageinfo *) PFN2A( ranges[i].first );
+            ranges[i].first += tpages;
+            break;
         }
+    }
 
-        // we survived the gauntlet - add the new block
+    // if we can't describe memory, we can't manage it
+    assert( _page_info != NULL );
 
-        uint32_t b32 = base   & ADDR_LOW_HALF;
-        uint32_t l32 = length & ADDR_LOW_HALF;
+    // everything starts out reserved ...
+    for( uint32_t i = 0; i < npages; ++i ) {
+        _page_info[i].flags = PG_RESERVED;
+        _page_info[i].order = 0;
+        _page_info[i].count = 0;
+        _page_info[i].owner = NULL;
+    }
 
-        _add_block( b32, l32 );
+    // ... until we hand the usable regions to the buddy system
+    for( int i = 0; i < nranges; ++i ) {
+        for( uint32_t pfn = ranges[i].first; pfn < ranges[i].last; ++pfn ) {
+            PGINFO( pfn )->flags = 0;
+        }
+        if( ranges[i].last > ranges[i].first ) {
+            _free_range( ranges[i].first, ranges[i].last - ranges[i].first );
+        }
     }
 
+    // everything we have is free at this point
+    _pages_total = _pages_free;
+
+    // boot summary:  what we manage, what the OS and the descriptor
+    // table took out of the usable memory, and what the BIOS reserved
+    uint32_t managed_kb = P2B( _pages_total ) >> 10;
+    uint32_t table_kb = P2B( tpages ) >> 10;
+    __cio_printf( " %dK usable: %dK managed, %dK table, %dK OS/boot;"
+                  " %dK reserved, %dK ACPI (deferred);",
+                  usable_kb, managed_kb, table_kb,
+                  usable_kb - managed_kb - table_kb, reserved_kb, acpi_kb );
+
     // record the initialization
     _km_initialized = 1;
 
+    // make sure everything works
+    _km_selftest();
+
     // announce that we have completed initialization
     __cio_puts( " done" );
 }
 
+/**
+** Name:    _km_reclaim_acpi
+**
+** Add the ACPI reclaimable memory regions to the free pool.
+**
+** Dependencies:
+**    Must not be called until everything that reads the ACPI
+**    tables has finished with them
+*/
+void _km_reclaim_acpi( void ) {
+    uint32_t pages = 0;
+
+    assert( _km_initialized );
+
+    for( int i = 0; i < _n_acpi; ++i ) {
+        Range *r = &_acpi_ranges[i];
+
+        if( r->first >= r->last ) {
+            continue;
+        }
+
+        for( uint32_t pfn = r->first; pfn < r->last; ++pfn ) {
+            PGINFO( pfn )->flags = 0;
+        }
+        _free_range( r->first, r->last - r->first );
+        pages += r->last - r->first;
+    }
+
+    // only do this once
+    _n_acpi = 0;
+
+    _pages_total += pages;
+
+    __cio_printf( " ACPI: %dK reclaimed", P2B(pages) >> 10 );
+}
+
+/**
+** Name:    _largest_run
+**
+** Find the longest run of contiguous free pages.  Adjacent free
+** blocks that aren't buddies are counted together.
+**
+** @return the length of the run, in pages
+*/
+static uint32_t _largest_run( void ) {
+    uint32_t best = 0;
+    uint32_t run = 0;
+    uint32_t pfn = _first_pfn;
+
+    // step over whole blocks at a time wherever we can
+    while( pfn < _last_pfn ) {
+        Pageinfo *info = PGINFO( pfn );
+
+        if( info->flags & PG_FREE ) {
+            run += ORDER_PAGES( info->order );
+            pfn += ORDER_PAGES( info->order );
+            continue;
+        }
+
+        if( run > best ) {
+            best = run;
+        }
+        run = 0;
+
+        if( (info->flags & PG_ALLOC) && info->count > 0 ) {
+            pfn += info->count;
+        } else {
+            ++pfn;
+        }
+    }
+
+    return( run > best ? run : best );
+}
+
+/**
+** Name:    _km_stats
+**
+** Take a snapshot of the allocator statistics
+**
+** @param st  The structure to be filled in
+*/
+void _km_stats( kmstat_t *st ) {
+
+    st->page_allocs  = _page_allocs;
+    st->page_frees   = _page_frees;
+    st->page_fails   = _page_fails;
+    st->pages_total  = _pages_total;
+    st->pages_used   = _pages_total - _pages_free;
+    st->pages_peak   = _pages_peak;
+    st->largest_run  = _km_initialized ? _largest_run() : 0;
+
+    st->slice_allocs = _slice_allocs;
+    st->slice_frees  = _slice_frees;
+    st->slices_free  = _slices_free;
+    st->slice_pages  = _slice_pages;
+    st->slice_reclaims = _slice_reclaims;
+
+    st->zero_pool    = _zero_count;
+    st->zero_hits    = _zero_hits;
+    st->zero_misses  = _zero_misses;
+
+    for( int i = 0; i < KM_ORDERS; ++i ) {
+        st->free_blocks[i] = _free_blocks[i];
+    }
+}
+
 /**
 ** Name:    _km_dump
 **
-** Dump the current contents of the free list to the console
+** Dump the allocator statistics and the free block histogram
+** to the console
 */
 void _km_dump( void ) {
-    Blockinfo *block;
+    kmstat_t st;
+
+    _km_stats( &st );
+
+    __cio_printf( "pages: %d total, %d used (peak %d), largest free run %d\n",
+                  st.pages_total, st.pages_used, st.pages_peak,
+                  st.largest_run );
+    __cio_printf( "page allocs %d (%d failed), frees %d",
+                  st.page_allocs, st.page_fails, st.page_frees );
+    if( _page_allocs > 0 ) {
+        __cio_printf( "; avg cycles: alloc %d",
+                      (uint32_t) __udiv64(_alloc_cycles,_page_allocs) );
+    }
+    if( _page_frees > 0 ) {
+        __cio_printf( " free %d",
+                      (uint32_t) __udiv64(_free_cycles,_page_frees) );
+    }
+    __cio_putchar( '\n' );
 
-    __cio_printf( "&_free_pages=%08x\n", &_free_pages );
+    __cio_printf( "slices: %d allocs, %d frees, %d free, %d pages"
+                  " (%d reclaimed)\n", st.slice_allocs, st.slice_frees,
+                  st.slices_free, st.slice_pages, st.slice_reclaims );
 
-    for( block = _free_pages; block != NULL; block = block->next ) {
-        __cio_printf(
-            "block @ 0x%08x 0x%08x pages (ends at 0x%08x) next @ 0x%08x\n",
-                block, block->pages, P2B(block->pages) + (uint32_t) block,
-                block->next );
-    }
+    uint32_t zreq = st.zero_hits + st.zero_misses;
+    __cio_printf( "zero pool: %d/%d pages, %d hits, %d misses (%d per 100)\n",
+                  st.zero_pool, KM_ZERO_POOL, st.zero_hits, st.zero_misses,
+                  zreq > 0 ? (100 * st.zero_hits) / zreq : 0 );
 
+    __cio_puts( "free blocks by size (pages):" );
+    for( int i = 0; i < KM_ORDERS; ++i ) {
+        __cio_printf( " %d:%d", ORDER_PAGES(i), st.free_blocks[i] );
+    }
+    __cio_putchar( '\n' );
 }
 
 /*
 ** PAGE MANAGEMENT
+**
+** _page_alloc() and _page_free() do the real work, and must be
+** called with _page_lock held; the public versions take it.
 */
 
+static void _page_free( void *block );
+
 /**
-** Name:    _km_page_alloc
+** Name:    _zero_drain
+**
+** Give every page in the zeroed page pool back to the free pool
+**
+** @return the number of pages released
+*/
+static uint32_t _zero_drain( void ) {
+    uint32_t n = _zero_count;
+
+    while( _zero_pages != NULL ) {
+        Blockinfo *page = _zero_pages;
+        _zero_pages = page->next;
+        _page_free( page );
+    }
+    _zero_count = 0;
+
+    return( n );
+}
+
+/**
+** Name:    _page_alloc
 **
-** Allocate a page of memory from the free list.
+** Allocate a block of contiguous pages from the free pool.
+** The caller must hold _page_lock.
 **
 ** @param count  Number of contiguous pages desired
 **
 ** @return a pointer to the beginning of the first allocated page,
 **         or NULL if no memory is available
 */
-void *_km_page_alloc( uint32_t count ) {
+static void *_page_alloc( uint32_t count ) {
+    uint64_t start = __get_tsc();
 
     assert( _km_initialized );
 
@@ -429,78 +1027,78 @@ void *_km_page_alloc( uint32_t count ) {
         return( NULL );
     }
 
-    /*
-    ** Look for the first entry that is large enough.
-    */
+    // figure out what size block we need
+    uint32_t order = _order_of( count );
 
-    // pointer to the current block
-    Blockinfo *block = _free_pages;
+    // no block is that big, so draining the zero pool can't help
+    if( order >= KM_ORDERS ) {
+        ++_page_fails;
+        return( NULL );
+    }
 
-    // pointer to where the pointer to the current block is
-    Blockinfo **pointer = &_free_pages;
+    /*
+    ** Look for the smallest available block that is large enough.
+    */
 
-    while( block != NULL && block->pages < count ){
-        pointer = &block->next;
-        block = *pointer;
+    uint32_t curr = order;
+    while( curr < KM_ORDERS && _free_pages[curr] == NULL ) {
+        ++curr;
     }
 
     // did we find a big enough block?
-    if( block == NULL ){
-        // nope!
+    if( curr >= KM_ORDERS ) {
+        // nope!  if we're hoarding zeroed pages, give them back and retry
+        if( _zero_count > 0 && _zero_drain() > 0 ) {
+            return( _page_alloc(count) );
+        }
+        ++_page_fails;
         return( NULL );
     }
 
-    // found one!  check the length
-
-    if( block->pages == count ) {
-
-        // exactly the right size - unlink it from the list
-
-        *pointer = block->next;
-
-    } else {
-
-        // bigger than we need - carve the amount we need off
-        // the beginning of this block
-
-        // remember where this chunk begins
-        Blockinfo *chunk = block;
-
-        // how much space will be left over?
-        int excess = block->pages - count;
+    // found one!  take it off its list
+    uint32_t pfn = A2PFN( _free_pages[curr] );
+    _list_remove( pfn, curr );
 
-        // find the start of the new fragment
-        Blockinfo *fragment = (Blockinfo *) ( (uint8_t *) block + P2B(count) );
+    // split it until it's the right size, freeing the upper halves
+    while( curr > order ) {
+        --curr;
+        _list_add( pfn + ORDER_PAGES(curr), curr );
+    }
 
-        // set the length and link for the new fragment
-        fragment->pages = excess;
-        fragment->next  = block->next;
+    // give back anything beyond what was actually requested
+    _pages_free -= ORDER_PAGES( order );
+    if( count < ORDER_PAGES(order) ) {
+        _free_range( pfn + count, ORDER_PAGES(order) - count );
+    }
 
-        // replace this chunk with the fragment
-        *pointer = fragment;
+    // remember how big this allocation is, for _km_page_free()
+    Pageinfo *info = PGINFO( pfn );
+    info->flags = PG_ALLOC;
+    info->count = count;
 
-        // return this chunk
-        block = chunk;
+    if( _pages_total - _pages_free > _pages_peak ) {
+        _pages_peak = _pages_total - _pages_free;
     }
 
-    return( block );
+    ++_page_allocs;
+    _alloc_cycles += __get_tsc() - start;
+
+    return( PFN2A(pfn) );
 }
 
 /**
-** Name:    _km_page_free
+** Name:    _page_free
 **
-** Returns a memory block to the list of available blocks,
-** combining it with adjacent blocks if they're present.
+** Returns a memory block to the free pool, combining it with
+** its buddies if they're free.  The caller must hold _page_lock.
 **
-** CRITICAL ASSUMPTION:  multi-page blocks will be freed one page
-** at a time!
+** The entire block that was obtained from _km_page_alloc()
+** is released by this call.
 **
-** @param block   Pointer to the page to be returned to the free list
+** @param block   Pointer to the block to be returned to the free pool
 */
-void _km_page_free( void *block ){
-    Blockinfo *used;
-    Blockinfo *prev;
-    Blockinfo *curr;
+static void _page_free( void *block ){
+    uint64_t start = __get_tsc();
 
     assert( _km_initialized );
 
@@ -511,105 +1109,179 @@ void _km_page_free( void *block ){
         return;
     }
 
-    used = (Blockinfo *) block;
-
-    /*
-    ** CRITICAL ASSUMPTION
-    **
-    ** We assume that any multi-page block that is being freed will
-    ** be freed one page at a time.  We make this assumption because we
-    ** don't track allocation sizes.  We can't use the simple "allocate
-    ** four extra bytes before the returned pointer" scheme to do this
-    ** because we're managing pages, and the pointers we return must point
-    ** to page boundaries, so we would wind up allocating an extra page
-    ** for each allocation.
-    **
-    ** Alternatively, we could keep an array of addresses and block
-    ** sizes ourselves, but that feels clunky, and would risk running out
-    ** of table entries if there are lots of allocations (assuming we use
-    ** a 4KB page to hold the table, at eight bytes per entry we would have
-    ** 512 entries per page).
-    **
-    ** IF THIS ASSUMPTION CHANGES, THIS CODE MUST BE FIXED!!!
-    */
+    // the block must be the start of an allocation we made
+    uint32_t pfn = A2PFN( block );
+    assert1( ((uint32_t) block & (SZ_PAGE - 1)) == 0 );
+    assert1( IN_RANGE(pfn) );
 
-    used->pages = 1;
+    Pageinfo *info = PGINFO( pfn );
+    assert( info->flags == PG_ALLOC );
 
-    /*
-    ** Advance through the list until current and previous
-    ** straddle the place where the new block should be inserted.
-    */
-    prev = NULL;
-    curr = _free_pages;
+    uint32_t count = info->count;
+    info->flags = 0;
+    info->count = 0;
 
-    while( curr != NULL && curr < used ){
-        prev = curr;
-        curr = curr->next;
+    // forget any owner tags that were attached to these pages
+    for( uint32_t i = 0; i < count; ++i ) {
+        info[i].owner = NULL;
     }
 
-    /*
-    ** At this point, we have the following list structure:
-    **
-    **   ....    BLOCK       BLOCK      ....
-    **          (*prev)  ^  (*curr)
-    **                   |
-    **                "used" goes here
-    **
-    ** We may need to merge the inserted block with either its
-    ** predecessor or its successor (or both).
-    */
+    _free_range( pfn, count );
 
-    /*
-    ** If this is not the first block in the resulting list,
-    ** we may need to merge it with its predecessor.
-    */
-    if( prev != NULL ){
+    ++_page_frees;
+    _free_cycles += __get_tsc() - start;
+}
 
-        // There is a predecessor.  Check to see if we need to merge.
-        if( adjacent( prev, used ) ){
+/**
+** Name:    _km_page_alloc
+**
+** Allocate a block of contiguous pages from the free pool.
+**
+** @param count  Number of contiguous pages desired
+**
+** @return a pointer to the beginning of the first allocated page,
+**         or NULL if no memory is available
+*/
+void *_km_page_alloc( uint32_t count ) {
 
-            // yes - merge them
-            prev->pages += used->pages;
+    _lock_acquire( &_page_lock );
+    void *block = _page_alloc( count );
+    _lock_release( &_page_lock );
 
-            // the predecessor becomes the "newly inserted" block,
-            // because we still need to check to see if we should
-            // merge with the successor
-            used = prev;
+    return( block );
+}
 
-        } else {
+/**
+** Name:    _km_page_free
+**
+** Returns a memory block to the free pool.  The entire block that
+** was obtained from _km_page_alloc() is released by this call.
+**
+** @param block   Pointer to the block to be returned to the free pool
+*/
+void _km_page_free( void *block ){
 
-            // Not adjacent - just insert the new block
-            // between the predecessor and the successor.
-            used->next = prev->next;
-            prev->next = used;
+    _lock_acquire( &_page_lock );
+    _page_free( block );
+    _lock_release( &_page_lock );
+}
 
-        }
+/**
+** Name:    _km_page_alloc_zero
+**
+** Allocate a block of contiguous pages whose contents are all zero.
+** Single pages are taken from the pre-zeroed pool when possible.
+**
+** @param count  Number of contiguous pages desired
+**
+** @return a pointer to the beginning of the first allocated page,
+**         or NULL if no memory is available
+*/
+void *_km_page_alloc_zero( uint32_t count ) {
+
+    _lock_acquire( &_page_lock );
+
+    if( count == 1 && _zero_pages != NULL ) {
+        Blockinfo *page = _zero_pages;
+        _zero_pages = page->next;
+        --_zero_count;
+        ++_zero_hits;
+        _lock_release( &_page_lock );
+        // the free list link is the only thing that isn't zero
+        page->next = NULL;
+        return( (void *) page );
+    }
 
-    } else {
+    ++_zero_misses;
 
-        // Yes, it is first.  Update the list pointer to insert it.
-        used->next = _free_pages;
-        _free_pages = used;
+    void *block = _page_alloc( count );
+    _lock_release( &_page_lock );
 
+    // clear it without holding up everyone else
+    if( block != NULL ) {
+        __memclr( block, P2B(count) );
     }
 
-    /*
-    ** If this is not the last block in the resulting list,
-    ** we may (also) need to merge it with its successor.
-    */
-    if( curr != NULL ){
+    return( block );
+}
 
-        // No.  Check to see if it should be merged with the successor.
-        if( adjacent( used, curr ) ){
+/**
+** Name:    _km_zero_refill
+**
+** Add one cleared page to the zeroed page pool, if it isn't full.
+** Intended to be called when the CPU would otherwise be idle.
+**
+** @return true if a page was added, else false
+*/
+bool_t _km_zero_refill( void ) {
+    Blockinfo *page = NULL;
 
-            // Yes, combine them.
-            used->next = curr->next;
-            used->pages += curr->pages;
+    if( !_km_initialized ) {
+        return( false );
+    }
 
-        }
+    // don't take the last of the free memory just to zero it
+    _lock_acquire( &_page_lock );
+    if( _zero_count < KM_ZERO_POOL && _pages_free > KM_ZERO_POOL ) {
+        page = (Blockinfo *) _page_alloc( 1 );
+    }
+    _lock_release( &_page_lock );
+
+    if( page == NULL ) {
+        return( false );
+    }
+
+    __memclr( page, SZ_PAGE );
+
+    _lock_acquire( &_page_lock );
+    page->next = _zero_pages;
+    _zero_pages = page;
+    ++_zero_count;
+    _lock_release( &_page_lock );
+
+    return( true );
+}
+
+/**
+** Name:    _km_page_set_owner
+**
+** Attach an owner tag to each page of an allocated block, so that
+** any address within the block can later be mapped back to the
+** data structure that manages it.
+**
+** @param block  Pointer to the first page of the block
+** @param count  Number of pages to tag
+** @param owner  The tag to attach
+*/
+void _km_page_set_owner( void *block, uint32_t count, void *owner ) {
+    uint32_t pfn = A2PFN( block );
+
+    assert1( IN_RANGE(pfn) && IN_RANGE(pfn + count - 1) );
+
+    for( uint32_t i = 0; i < count; ++i ) {
+        PGINFO( pfn + i )->owner = owner;
     }
 }
 
+/**
+** Name:    _km_page_owner
+**
+** Retrieve the owner tag for the page containing an address
+**
+** @param addr  Any address within an allocated page
+**
+** @return the tag attached by _km_page_set_owner(), or NULL
+*/
+void *_km_page_owner( const void *addr ) {
+    uint32_t pfn = A2PFN( addr );
+
+    if( !IN_RANGE(pfn) ) {
+        return( NULL );
+    }
+
+    return( PGINFO(pfn)->owner );
+}
+
 /*
 ** SLICE MANAGEMENT
 */
@@ -620,6 +1292,50 @@ void _km_page_free( void *block ){
 ** of space (e.g., the QNode and Queue allocators).
 */
 
+/**
+** Name:        _slice_push
+**
+** Put a slice at the front of the slice free list
+**
+** @param block  Pointer to the slice
+*/
+static void _slice_push( void *block ) {
+    Blockinfo *slice = (Blockinfo *) block;
+
+    slice->pages = SZ_SLICE;
+    slice->prev = NULL;
+    slice->next = _free_slices;
+    if( slice->next != NULL ) {
+        slice->next->prev = slice;
+    }
+    _free_slices = slice;
+
+    PGINFO( A2PFN(slice) )->order |= 1 << SLICE_INDEX( slice );
+    ++_slices_free;
+}
+
+/**
+** Name:        _slice_unlink
+**
+** Remove a slice from the slice free list
+**
+** @param slice  Pointer to the slice
+*/
+static void _slice_unlink( Blockinfo *slice ) {
+
+    if( slice->prev == NULL ) {
+        _free_slices = slice->next;
+    } else {
+        slice->prev->next = slice->next;
+    }
+    if( slice->next != NULL ) {
+        slice->next->prev = slice->prev;
+    }
+
+    PGINFO( A2PFN(slice) )->order &= ~(1 << SLICE_INDEX( slice ));
+    --_slices_free;
+}
+
 /**
 ** Name:        _carve_slices
 **
@@ -629,16 +1345,21 @@ void _km_page_free( void *block ){
 static void _carve_slices( void ) {
     void *page;
 
-    // get a page
+    // get a page (slices aren't cleared, so there's no point in
+    // taking one from the zeroed pool)
     page = _km_page_alloc( 1 );
 
     // allocation failure is a show-stopping problem
     assert( page );
 
+    // no slices of this page are free yet
+    PGINFO( A2PFN(page) )->order = 0;
+    ++_slice_pages;
+
     // we have the page; create the four slices from it
     uint8_t *ptr = (uint8_t *) page;
-    for( int i = 0; i < 4; ++i ) {
-        _km_slice_free( (void *) ptr );
+    for( int i = 0; i < SLICES_PER_PAGE; ++i ) {
+        _slice_push( (void *) ptr );
         ptr += SZ_SLICE;
     }
 }
@@ -649,6 +1370,9 @@ static void _carve_slices( void ) {
 ** Dynamically allocates a slice (1/4 of a page).  If no
 ** memory is available, we panic.
 **
+** The contents of the slice are not cleared; callers that need
+** zeroed memory should use _kzalloc() or _km_page_alloc_zero().
+**
 ** @return a pointer to the allocated slice
 */
 void *_km_slice_alloc( void ) {
@@ -656,6 +1380,8 @@ void *_km_slice_alloc( void ) {
 
     assert( _km_initialized );
 
+    _lock_acquire( &_slice_lock );
+
     // if we are out of slices, create a few more
     if( _free_slices == NULL ) {
         _carve_slices();
@@ -666,10 +1392,11 @@ void *_km_slice_alloc( void ) {
     assert( slice);
 
     // unlink it
-    _free_slices = slice->next;
+    _slice_unlink( slice );
+
+    ++_slice_allocs;
 
-    // make it nice and shiny for the caller
-    __memclr( (void *) slice, SZ_SLICE );
+    _lock_release( &_slice_lock );
 
     return( slice );
 }
@@ -677,20 +1404,40 @@ void *_km_slice_alloc( void ) {
 /**
 ** Name:        _km_slice_free
 **
-** Returns a slice to the list of available slices.
-**
-** We make no attempt to merge slices, as they are independent
-** blocks of memory (unlike pages).
+** Returns a slice to the list of available slices.  If this
+** leaves all the slices of its page free, and there are other free
+** slices to satisfy future requests, the page is released.
 **
 ** @param block  Pointer to the slice (1/4 page) to be freed
 */
 void _km_slice_free( void *block ) {
-    Blockinfo *slice = (Blockinfo *) block;
 
     assert( _km_initialized );
 
-    // just add it to the front of the free list
-    slice->pages = SZ_SLICE;
-    slice->next = _free_slices;
-    _free_slices = slice;
+    _lock_acquire( &_slice_lock );
+
+    // add it to the front of the free list
+    _slice_push( block );
+
+    ++_slice_frees;
+
+    // can we give the whole page back?
+    uint32_t pfn = A2PFN( block );
+    if( PGINFO(pfn)->order != ALL_SLICES ||
+            _slices_free <= SLICES_PER_PAGE ) {
+        _lock_release( &_slice_lock );
+        return;
+    }
+
+    uint8_t *page = (uint8_t *) PFN2A( pfn );
+    for( int i = 0; i < SLICES_PER_PAGE; ++i ) {
+        _slice_unlink( (Blockinfo *) (page + i * SZ_SLICE) );
+    }
+
+    --_slice_pages;
+    ++_slice_reclaims;
+
+    _lock_release( &_slice_lock );
+
+    _km_page_free( page );
 }
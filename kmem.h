@@ -8,14 +8,13 @@
 ** Structures and functions to support dynamic memory
 ** allocation within the OS.
 **
-**      The list of free blocks is ordered by address to facilitate
-**      combining freed blocks with adjacent blocks that are already
-**      free.
+**      Pages are managed with a binary buddy system:  free blocks
+**      are kept on per-order lists, and a freed block is combined
+**      with its buddy whenever the buddy is also free.
 **
-**      All requests for memory are satisfied with blocks that are
-**      an integral number of 4-byte words.  More memory may be
-**      provided than was requested if the fragment left over after
-**      the allocation would not be large enough to be useable.
+**      Page requests are satisfied with exactly the number of pages
+**      requested; any excess from rounding up to a power of two is
+**      returned to the free pool immediately.
 */
 
 #ifndef KMEM_H_
@@ -38,6 +37,16 @@
 
 #define SZ_PAGE     SZ_SLAB
 
+// Largest buddy block order (blocks of 2^KM_MAX_ORDER pages), and
+// the number of distinct block orders
+
+#define KM_ORDERS       KM_HIST_ORDERS
+#define KM_MAX_ORDER    (KM_ORDERS - 1)
+
+// Number of pre-zeroed pages to keep on hand
+
+#define KM_ZERO_POOL    32
+
 #ifndef SP_ASM_SRC
 
 /*
@@ -68,13 +77,33 @@
 */
 void _km_init( void );
 
+/**
+** Name:    _km_reclaim_acpi
+**
+** Add the ACPI reclaimable memory regions to the free pool.
+**
+** Dependencies:
+**    Must not be called until everything that reads the ACPI
+**    tables has finished with them
+*/
+void _km_reclaim_acpi( void );
+
 /**
 ** Name:    _km_dump
 **
-** Dump the current contents of the freelist to the console
+** Dump the current contents of the free lists to the console
 */
 void _km_dump( void );
 
+/**
+** Name:    _km_stats
+**
+** Take a snapshot of the allocator statistics
+**
+** @param st  The structure to be filled in
+*/
+void _km_stats( kmstat_t *st );
+
 /*
 ** Functions that manipulate free memory blocks.
 */
@@ -82,9 +111,10 @@ void _km_dump( void );
 /**
 ** Name:    _km_page_alloc
 **
-** Allocate a page of memory from the free list.
+** Allocate a block of contiguous pages from the free pool.
 **
-** @param count  Number of contiguous pages desired
+** @param count  Number of contiguous pages desired (at most
+**               2^KM_MAX_ORDER)
 **
 ** @return a pointer to the beginning of the first allocated page,
 **         or NULL if no memory is available
@@ -94,22 +124,71 @@ void *_km_page_alloc( uint32_t count );
 /**
 ** Name:    _km_page_free
 **
-** Returns a memory block to the list of available blocks,
-** combining it with adjacent blocks if they're present.
+** Returns a memory block to the free pool, combining it with
+** its buddies if they're free.
 **
-** CRITICAL ASSUMPTION:  multi-page blocks will be freed one page
-** at a time!
+** The entire block that was obtained from _km_page_alloc()
+** is released by this call.
 **
-** @param block   Pointer to the page to be returned to the free list
+** @param block   Pointer to the block to be returned to the free pool
 */
 void _km_page_free( void *block );
 
+/**
+** Name:    _km_page_alloc_zero
+**
+** Allocate a block of contiguous pages whose contents are all zero.
+** Single pages are taken from the pre-zeroed pool when possible.
+**
+** @param count  Number of contiguous pages desired
+**
+** @return a pointer to the beginning of the first allocated page,
+**         or NULL if no memory is available
+*/
+void *_km_page_alloc_zero( uint32_t count );
+
+/**
+** Name:    _km_zero_refill
+**
+** Add one cleared page to the zeroed page pool, if it isn't full.
+** Intended to be called when the CPU would otherwise be idle.
+**
+** @return true if a page was added, else false
+*/
+bool_t _km_zero_refill( void );
+
+/**
+** Name:    _km_page_set_owner
+**
+** Attach an owner tag to each page of an allocated block, so that
+** any address within the block can later be mapped back to the
+** data structure that manages it.
+**
+** @param block  Pointer to the first page of the block
+** @param count  Number of pages to tag
+** @param owner  The tag to attach
+*/
+void _km_page_set_owner( void *block, uint32_t count, void *owner );
+
+/**
+** Name:    _km_page_owner
+**
+** Retrieve the owner tag for the page containing an address
+**
+** @param addr  Any address within an allocated page
+**
+** @return the tag attached by _km_page_set_owner(), or NULL
+*/
+void *_km_page_owner( const void *addr );
+
 /**
 ** Name:    _km_slice_alloc
 **
 ** Dynamically allocates a slice (1/4 of a page).  If no
 ** memory is available, we panic.
 **
+** The contents of the slice are not cleared.
+**
 ** @return a pointer to the allocated slice
 */
 void *_km_slice_alloc( void );
@@ -117,10 +196,9 @@ void *_km_slice_alloc( void );
 /**
 ** Name:    _km_slice_free
 **
-** Returns a slice to the list of available slices.
-**
-** We make no attempt to merge slices, as they are independent
-** blocks of memory (unlike pages).
+** Returns a slice to the list of available slices.  Once all
+** four slices of a page are free, the page may be given back to
+** the page allocator.
 **
 ** @param block  Pointer to the slice (1/4 page) to be freed
 */
@@ -300,6 +300,137 @@ void __pause( void );
 */
 uint32_t __get_ra( void );
 
+/**
+** Name:	__get_tsc
+**
+** Description:	Read the processor's time stamp counter
+**
+** @return The current 64-bit TSC value
+*/
+uint64_t __get_tsc( void );
+
+/**
+** Name:	__bsf
+**
+** Description:	Find the lowest-numbered set bit in a word
+**
+** @param word  The word to search (must not be zero)
+**
+** @return The bit number (0 through 31)
+*/
+uint32_t __bsf( uint32_t word );
+
+/**
+** Name:	__bsr
+**
+** Description:	Find the highest-numbered set bit in a word
+**
+** @param word  The word to search (must not be zero)
+**
+** @return The bit number (0 through 31)
+*/
+uint32_t __bsr( uint32_t word );
+
+/**
+** Name:	__udiv64
+**
+** Description:	Divide a 64-bit value by a 32-bit one (the compiler
+**		would otherwise call __udivdi3, which we don't have)
+**
+** @param n     The dividend
+** @param d     The divisor (must not be zero)
+**
+** @return The 64-bit quotient
+*/
+uint64_t __udiv64( uint64_t n, uint32_t d );
+
+/**
+** Name:	__xchg
+**
+** Description:	Atomically exchange a word in memory with a new value
+**
+** @param p     The word
+** @param v     Its new value
+**
+** @return The old value
+*/
+uint32_t __xchg( volatile uint32_t *p, uint32_t v );
+
+/**
+** Name:	__xadd
+**
+** Description:	Atomically add to a word in memory
+**
+** @param p     The word
+** @param v     The amount to add
+**
+** @return The old value
+*/
+uint32_t __xadd( volatile uint32_t *p, uint32_t v );
+
+/**
+** Name:	__cli
+**
+** Description:	Disable interrupts on this CPU
+*/
+void __cli( void );
+
+/**
+** Name:	__sti
+**
+** Description:	Enable interrupts on this CPU
+*/
+void __sti( void );
+
+/**
+** Name:	__cpu_relax
+**
+** Description:	Tell the CPU that we are in a spin-wait loop
+*/
+void __cpu_relax( void );
+
+/**
+** Name:	__get_cr0, __get_cr2, __get_cr3, __get_cr4
+**
+** Description:	Read a control register
+**
+** @return The register contents
+*/
+uint32_t __get_cr0( void );
+uint32_t __get_cr2( void );
+uint32_t __get_cr3( void );
+uint32_t __get_cr4( void );
+
+/**
+** Name:	__set_cr0, __set_cr3, __set_cr4
+**
+** Description:	Write a control register
+**
+** @param value  The new register contents
+*/
+void __set_cr0( uint32_t value );
+void __set_cr3( uint32_t value );
+void __set_cr4( uint32_t value );
+
+/**
+** Name:	__invlpg
+**
+** Description:	Remove one page's translation from this CPU's TLB
+**
+** @param addr  Any address in the page
+*/
+void __invlpg( const void *addr );
+
+/**
+** Name:	__cpuid
+**
+** Description:	Identify the processor
+**
+** @param leaf  The CPUID function number
+** @param regs  Where to put EAX, EBX, ECX, and EDX, in that order
+*/
+void __cpuid( uint32_t leaf, uint32_t regs[4] );
+
 /**
 ** _pcount - count the number of active processes in each state
 **
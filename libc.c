@@ -88,13 +88,33 @@ void __memset( void *buf, register uint32_t len,
 void __memclr( void *buf, register uint32_t len ) {
     register uint8_t *dest = buf;
 
-    /*
-    ** We could speed this up by unrolling it and clearing
-    ** words at a time (instead of bytes).
-    */
+    // clear bytes until we reach a word boundary
+    while( len > 0 && ((uint32_t) dest & 3) != 0 ) {
+        *dest++ = 0;
+        --len;
+    }
+
+    // then clear a word at a time, four words per iteration
+    register uint32_t *wdest = (uint32_t *) dest;
+
+    while( len >= 16 ) {
+        wdest[0] = 0;
+        wdest[1] = 0;
+        wdest[2] = 0;
+        wdest[3] = 0;
+        wdest += 4;
+        len -= 16;
+    }
+
+    while( len >= 4 ) {
+        *wdest++ = 0;
+        len -= 4;
+    }
 
+    // finally, any leftover bytes
+    dest = (uint8_t *) wdest;
     while( len-- ) {
-            *dest++ = 0;
+        *dest++ = 0;
     }
 
 }
@@ -544,15 +564,9 @@ int __cvtoct( char *buf, int value ){
 */
 int _pcount( register uint32_t *counts ) {
 
-    // clear all the counts
-    __memclr( (void *) counts, N_STATES * sizeof(uint32_t) );
-
-    // generate the frequency counts
-    for( register int i = 0; i < N_PROCS; ++i ) {
-        if( _processes[i] != NULL ) {
-            counts[_processes[i]->state] += 1;
-        }
-    }
+    // _pcb_set_state() keeps these up to date for us
+    __memcpy( (void *) counts, (void *) _pstates,
+              N_STATES * sizeof(uint32_t) );
 
     return( _n_procs );
 }
@@ -585,11 +599,11 @@ void _kpanic( char *msg ) {
 
 #if PANIC_DUMPS_QUEUES
     // dump the entire contents of the queues
-    // _queue_dump( "Sleep queue", _sleeping );
+    // _wheel_dump( "Sleep wheel", _sleeping );
     // etc.
 #else
     // just dump the queue sizes
-    // __cio_printf( "Queue sizes:  sleep %d", _queue_length(_sleeping) );
+    // __cio_printf( "Queue sizes:  sleep %d", _wheel_length(_sleeping) );
     // etc.
 #endif
 
@@ -0,0 +1,213 @@
+/**
+** @file lock.c
+**
+** @author CSCI-452 class of 20215
+**
+** Kernel lock implementation
+*/
+
+#define SP_KERNEL_SRC
+
+#include "common.h"
+
+#include "x86arch.h"
+#include "lock.h"
+
+/*
+** PRIVATE DEFINITIONS
+*/
+
+// the longest hold time _lock_dump() can show
+
+#define HOLD_MAX    0x7fffffff
+
+/*
+** PRIVATE DATA TYPES
+*/
+
+/*
+** PRIVATE GLOBAL VARIABLES
+*/
+
+// the registry, in order of initialization
+static lock_t *_locks;
+static lock_t *_locks_last;
+
+/*
+** PUBLIC GLOBAL VARIABLES
+*/
+
+/*
+** PRIVATE FUNCTIONS
+*/
+
+/*
+** PUBLIC FUNCTIONS
+*/
+
+/**
+** _lock_init() - initialize a lock, and add it to the registry
+**
+** @param lk    The lock
+** @param name  Name to report it under
+** @param kind  LOCK_SPIN or LOCK_TICKET
+*/
+void _lock_init( lock_t *lk, const char *name, uint8_t kind ) {
+
+    lk->word = lk->serving = 0;
+    lk->name = name;
+    lk->kind = kind;
+    lk->acquired = lk->contended = 0;
+    lk->since = lk->max_hold = 0;
+
+    // don't link it in twice
+    for( lock_t *p = _locks; p != NULL; p = p->next ) {
+        if( p == lk ) {
+            return;
+        }
+    }
+
+    lk->next = NULL;
+    if( _locks == NULL ) {
+        _locks = lk;
+    } else {
+        _locks_last->next = lk;
+    }
+    _locks_last = lk;
+}
+
+/**
+** _lock_acquire() - take a lock, waiting for it if necessary
+**
+** @param lk    The lock
+*/
+void _lock_acquire( lock_t *lk ) {
+    bool_t waited = false;
+
+    if( lk->kind == LOCK_TICKET ) {
+
+        // take a number, and wait for it to come up
+        uint32_t ticket = __xadd( &lk->word, 1 );
+        while( lk->serving != ticket ) {
+            waited = true;
+            __cpu_relax();
+        }
+
+    } else {
+
+        // wait without hammering the bus with locked cycles
+        while( __xchg(&lk->word,1) != 0 ) {
+            waited = true;
+            while( lk->word != 0 ) {
+                __cpu_relax();
+            }
+        }
+
+    }
+
+    // it's ours; nobody else touches the statistics until we let go
+    ++lk->acquired;
+    if( waited ) {
+        ++lk->contended;
+    }
+    lk->since = __get_tsc();
+}
+
+/**
+** _lock_release() - release a lock
+**
+** @param lk    The lock (must be held by this CPU)
+*/
+void _lock_release( lock_t *lk ) {
+
+    uint64_t held = __get_tsc() - lk->since;
+    if( held > lk->max_hold ) {
+        lk->max_hold = held;
+    }
+
+    // (the exchange orders everything we did before it)
+    if( lk->kind == LOCK_TICKET ) {
+        (void) __xchg( &lk->serving, lk->serving + 1 );
+    } else {
+        (void) __xchg( &lk->word, 0 );
+    }
+}
+
+/**
+** _lock_acquire_irq() - disable interrupts on this CPU, then take
+**                       a lock
+**
+** @param lk    The lock
+**
+** @return the EFLAGS contents to give to _lock_release_irq()
+*/
+uint32_t _lock_acquire_irq( lock_t *lk ) {
+    uint32_t flags = __get_flags();
+
+    __cli();
+    _lock_acquire( lk );
+
+    return( flags );
+}
+
+/**
+** _lock_release_irq() - release a lock, then restore the interrupt
+**                       state it was taken with
+**
+** @param lk     The lock (must be held by this CPU)
+** @param flags  What _lock_acquire_irq() returned
+*/
+void _lock_release_irq( lock_t *lk, uint32_t flags ) {
+
+    _lock_release( lk );
+
+    if( flags & EFLAGS_IF ) {
+        __sti();
+    }
+}
+
+/**
+** _lock_held() - is a lock held (by anyone)?
+**
+** @param lk    The lock
+*/
+bool_t _lock_held( lock_t *lk ) {
+
+    if( lk->kind == LOCK_TICKET ) {
+        return( lk->word != lk->serving );
+    }
+
+    return( lk->word != 0 );
+}
+
+/**
+** _lock_dump() - dump the registered locks' statistics to the console
+**
+** Per-CPU locks share a name, and appear in CPU order.
+**
+** @param reset  Clear the statistics afterward?
+*/
+void _lock_dump( bool_t reset ) {
+
+    __cio_puts( "Locks (max hold in TSC cycles):\n" );
+
+    for( lock_t *lk = _locks; lk != NULL; lk = lk->next ) {
+
+        // contention in tenths of a percent
+        uint32_t pct = lk->acquired == 0 ? 0 : (uint32_t)
+            __udiv64( (uint64_t) lk->contended * 1000, lk->acquired );
+        // (%d is signed, so longer holds are shown as "HOLD_MAX+")
+        uint32_t hold = lk->max_hold > HOLD_MAX ? HOLD_MAX :
+                        (uint32_t) lk->max_hold;
+
+        __cio_printf( " %-8s %s  acq %d  cont %d (%d.%d%%)  max %d%s\n",
+                      lk->name, lk->kind == LOCK_TICKET ? "tkt " : "spin",
+                      lk->acquired, lk->contended, pct / 10, pct % 10,
+                      hold, lk->max_hold > HOLD_MAX ? "+" : "" );
+
+        if( reset ) {
+            lk->acquired = lk->contended = 0;
+            lk->max_hold = 0;
+        }
+    }
+}
@@ -0,0 +1,139 @@
+/*
+** @file lock.h
+**
+** @author CSCI-452 class of 20215
+**
+** Kernel lock declarations
+**
+** Two kinds of lock are provided:  a test-and-set spinlock, which
+** is cheapest when uncontended, and a ticket lock, which hands the
+** lock out in the order it was requested.  Either kind may be taken
+** with _lock_acquire_irq(), which also disables interrupts on this
+** CPU until the matching _lock_release_irq(); use that for anything
+** an ISR also locks, when the caller may have interrupts enabled.
+**
+** Locks are not recursive:  a CPU that takes a lock it already
+** holds will spin forever.
+**
+** Every lock keeps statistics (acquisitions, acquisitions that had
+** to wait, and the longest time it was held), and is entered in a
+** registry when it is initialized, so that _lock_dump() can show
+** which structures are hot.
+*/
+
+#ifndef LOCK_H_
+#define LOCK_H_
+
+/*
+** General (C and/or assembly) definitions
+*/
+
+// lock kinds
+#define LOCK_SPIN       0       // test-and-set spinlock
+#define LOCK_TICKET     1       // FIFO ticket lock
+
+#ifndef SP_ASM_SRC
+
+/*
+** Start of C-only definitions
+*/
+
+#include "common.h"
+
+/*
+** Types
+*/
+
+// Locks are embedded in cpu_t, whose offsets.h entries are generated
+// with -mx32, where a uint64_t is 8-byte aligned (it is only 4-byte
+// aligned for the -m32 kernel).  So the 64-bit fields come first, and
+// the whole is padded to a multiple of 8 bytes, to give every field
+// the same offset for both.
+
+typedef struct lock_s {
+    // statistics; only the holder updates these
+    uint64_t since;             // TSC when it was last acquired
+    uint64_t max_hold;          // longest hold, in TSC cycles
+    uint32_t acquired;          // times acquired
+    uint32_t contended;         // times the acquirer had to wait
+
+    volatile uint32_t word;     // spinlock:  non-zero while held
+                                // ticket lock:  next ticket to hand out
+    volatile uint32_t serving;  // ticket lock:  ticket now being served
+    const char *name;           // for _lock_dump()
+    struct lock_s *next;        // next lock in the registry
+    uint8_t kind;               // LOCK_SPIN or LOCK_TICKET
+    uint8_t pad[7];
+} lock_t;
+
+/*
+** Prototypes
+*/
+
+/**
+** _lock_init() - initialize a lock, and add it to the registry
+**
+** Locks are registered in the order they are initialized; a lock
+** that is initialized again is reset, but only registered once.
+** The registry itself is not locked, so this should be called
+** during system initialization (or under another lock).
+**
+** @param lk    The lock
+** @param name  Name to report it under
+** @param kind  LOCK_SPIN or LOCK_TICKET
+*/
+void _lock_init( lock_t *lk, const char *name, uint8_t kind );
+
+/**
+** _lock_acquire() - take a lock, waiting for it if necessary
+**
+** @param lk    The lock
+*/
+void _lock_acquire( lock_t *lk );
+
+/**
+** _lock_release() - release a lock
+**
+** @param lk    The lock (must be held by this CPU)
+*/
+void _lock_release( lock_t *lk );
+
+/**
+** _lock_acquire_irq() - disable interrupts on this CPU, then take
+**                       a lock
+**
+** @param lk    The lock
+**
+** @return the EFLAGS contents to give to _lock_release_irq()
+*/
+uint32_t _lock_acquire_irq( lock_t *lk );
+
+/**
+** _lock_release_irq() - release a lock, then restore the interrupt
+**                       state it was taken with
+**
+** @param lk     The lock (must be held by this CPU)
+** @param flags  What _lock_acquire_irq() returned
+*/
+void _lock_release_irq( lock_t *lk, uint32_t flags );
+
+/**
+** _lock_held() - is a lock held (by anyone)?
+**
+** Intended for assertions.
+**
+** @param lk    The lock
+*/
+bool_t _lock_held( lock_t *lk );
+
+/**
+** _lock_dump() - dump the registered locks' statistics to the console
+**
+** @param reset  Clear the statistics afterward?
+*/
+void _lock_dump( bool_t reset );
+
+#endif
+/* SP_ASM_SRC */
+
+#endif
@@ -47,6 +47,7 @@
 // Offsets into context_t
 // Size: 72 bytes
 
+#define	CTX_SIZE               	72
 #define	CTX_ss                 	0
 #define	CTX_gs                 	4
 #define	CTX_fs                 	8
@@ -68,18 +69,57 @@
 
 
 // Offsets into pcb_t
-// Size: 32 bytes
+// Size: 192 bytes
 
+#define	PCB_SIZE               	192
 #define	PCB_context            	0
 #define	PCB_stack              	4
-#define	PCB_wakeup             	8
-#define	PCB_exit_status        	12
-#define	PCB_pid                	16
-#define	PCB_ppid               	20
-#define	PCB_state              	24
-#define	PCB_priority           	25
-#define	PCB_quantum            	26
-#define	PCB_ticks              	27
-#define	PCB_filler             	28
+#define	PCB_runtime            	8
+#define	PCB_systime            	16
+#define	PCB_readied            	24
+#define	PCB_top_runtime        	32
+#define	PCB_top_systime        	40
+#define	PCB_wake               	48
+#define	PCB_exit_status        	60
+#define	PCB_pid                	64
+#define	PCB_ppid               	68
+#define	PCB_link               	72
+#define	PCB_vruntime           	96
+#define	PCB_deadline           	100
+#define	PCB_jobs               	104
+#define	PCB_misses             	108
+#define	PCB_nvcsw              	112
+#define	PCB_nivcsw             	116
+#define	PCB_parent             	120
+#define	PCB_children           	124
+#define	PCB_zombies            	128
+#define	PCB_sibling            	132
+#define	PCB_prev_sibling       	136
+#define	PCB_hnext              	140
+#define	PCB_pgdir              	144
+#define	PCB_brk                	148
+#define	PCB_weight             	152
+#define	PCB_slot               	154
+#define	PCB_rt_runtime         	156
+#define	PCB_rt_period          	158
+#define	PCB_rt_deadline        	160
+#define	PCB_budget             	162
+#define	PCB_state              	164
+#define	PCB_priority           	165
+#define	PCB_base               	166
+#define	PCB_quantum            	167
+#define	PCB_ticks              	168
+#define	PCB_sclass             	169
+#define	PCB_cpu                	170
+#define	PCB_filler             	171
+
+
+// Offsets into cpu_t
+// Size: 392 bytes
+
+#define	CPU_SIZE               	392
+#define	CPU_self               	0
+#define	CPU_current            	4
+#define	CPU_system_esp         	8
 
 #endif
@@ -14,14 +14,34 @@
 #include "bootstrap.h"
 
 #include "process.h"
+#include "clock.h"
 #include "scheduler.h"
 #include "stacks.h"
+#include "slab.h"
 #include "cio.h"
+#include "kmem.h"
+#include "offsets.h"
 
 /*
 ** PRIVATE DEFINITIONS
 */
 
+// PID hash table size (must be a power of two)
+
+#define PID_HASH        1024
+#define PID_BUCKET(p)   ((uint32_t) (p) & (PID_HASH - 1))
+
+// the first PID handed out after wrapping around (init keeps PID 1)
+
+#define PID_FIRST       2
+
+// the ISR code reaches into these structures using offsets.h, which
+// is generated by a program built with -mx32; make sure it agrees with
+// the kernel about their layout (this won't compile if it doesn't)
+
+typedef char _ctx_layout_check[ sizeof(context_t) == CTX_SIZE ? 1 : -1 ];
+typedef char _pcb_layout_check[ sizeof(pcb_t) == PCB_SIZE ? 1 : -1 ];
+
 /*
 ** PRIVATE DATA TYPES
 */
@@ -31,7 +51,16 @@
 */
 
 // PCB management
-static pcb_t *_pcb_list;
+static kmem_cache_t _pcb_cache;
+
+// active processes, by PID, chained through their hnext fields
+static pcb_t *_pid_hash[PID_HASH];
+
+// process table chunks currently allocated
+static uint32_t _pt_chunks;
+
+// "top" display state
+static uint64_t _top_stamp;     // TSC at the last display
 
 /*
 ** PUBLIC GLOBAL VARIABLES
@@ -43,43 +72,134 @@ pid_t _next_pid;
 // active process count
 uint32_t _n_procs;
 
-// table of active processes
-pcb_t *_processes[N_PROCS];
+// number of processes in each state (but Free), kept by _pcb_set_state()
+uint32_t _pstates[N_STATES];
+
+// table of active processes (use PTABLE() to index it)
+pcb_t **_processes[PT_CHUNKS];
+
+// protects _processes[], _n_procs and _next_pid
+lock_t _ptable_lock;
+
+// refresh the "top" display every second?
+bool_t _top_live;
 
 /*
 ** PRIVATE FUNCTIONS
 */
 
 /**
-** _pcb_add() - allocate a slice and carve it into PCBs
+** _permille() - one value as a fraction of another, in tenths of
+**               a percent
 **
-** @param critical  Should we panic on allocation failure?
+** @param part   The smaller value
+** @param whole  The larger one
+*/
+static uint32_t _permille( uint64_t part, uint64_t whole ) {
+
+    // keep the divisor within 32 bits
+    while( (whole >> 32) != 0 ) {
+        part >>= 1;
+        whole >>= 1;
+    }
+
+    if( whole == 0 ) {
+        return( 0 );
+    }
+
+    return( (uint32_t) __udiv64(part * 1000, (uint32_t) whole) );
+}
+
+/**
+** _pcb_ctor() - initialize a newly-allocated PCB
 **
-** @return the number of PCBs added to the pool
+** @param obj  The PCB
+*/
+static void _pcb_ctor( void *obj ) {
+
+    // start with a clean slate
+    __memclr( obj, sizeof(pcb_t) );
+}
+
+/*
+** The rest of these must be called with _ptable_lock held.
 */
-static int _pcb_add( void ) {
 
-    // start by carving off a slice of memory
-    pcb_t *new = (pcb_t *) _km_slice_alloc();
+/**
+** _sib_link() - add a process to the front of one of its parent's
+**               lists
+**
+** @param list  The list (the parent's children or zombies)
+** @param pcb   The process
+*/
+static void _sib_link( pcb_t **list, pcb_t *pcb ) {
 
-    // NULL slice is a problem
-    if( new == NULL ) {
-        return( false );
+    pcb->prev_sibling = NULL;
+    pcb->sibling = *list;
+    if( *list != NULL ) {
+        (*list)->prev_sibling = pcb;
     }
+    *list = pcb;
+}
 
-    // clear out the allocated space
-    __memclr( new, SZ_SLICE );
+/**
+** _sib_unlink() - take a process off whichever of its parent's
+**                 lists it is on
+**
+** @param pcb   The process (which must have a parent)
+*/
+static void _sib_unlink( pcb_t *pcb ) {
+    pcb_t *parent = pcb->parent;
+
+    if( pcb->prev_sibling != NULL ) {
+        pcb->prev_sibling->sibling = pcb->sibling;
+    } else if( parent->children == pcb ) {
+        parent->children = pcb->sibling;
+    } else {
+        assert1( parent->zombies == pcb );
+        parent->zombies = pcb->sibling;
+    }
+    if( pcb->sibling != NULL ) {
+        pcb->sibling->prev_sibling = pcb->prev_sibling;
+    }
 
-    for( int i = 0; i < (SZ_SLICE / sizeof(pcb_t)); ++i ) {
-        _pcb_free( &new[i] );
+    pcb->sibling = pcb->prev_sibling = NULL;
+}
+
+/**
+** _hash_find() - look a PID up in the PID hash table
+**
+** @param pid   The PID
+**
+** @return the PCB, or NULL
+*/
+static pcb_t *_hash_find( pid_t pid ) {
+    pcb_t *pcb;
+
+    for( pcb = _pid_hash[PID_BUCKET(pid)]; pcb != NULL; pcb = pcb->hnext ) {
+        if( pcb->pid == pid ) {
+            break;
+        }
     }
 
-#if TRACING_PCB
-    __cio_printf( "** _pcb_add() added %d PCBs\n", SZ_SLICE / sizeof(pcb_t) );
-#endif
+    return( pcb );
+}
 
-    // all done!
-    return( SZ_SLICE / sizeof(pcb_t) );
+/**
+** _hash_remove() - take a process out of the PID hash table
+**
+** @param pcb   The process
+*/
+static void _hash_remove( pcb_t *pcb ) {
+    pcb_t **pp = &_pid_hash[PID_BUCKET(pcb->pid)];
+
+    while( *pp != NULL && *pp != pcb ) {
+        pp = &(*pp)->hnext;
+    }
+    if( *pp != NULL ) {
+        *pp = pcb->hnext;
+    }
+    pcb->hnext = NULL;
 }
 
 /*
@@ -93,7 +213,7 @@ static int _pcb_add( void ) {
 /**
 ** _pcb_init() - initialize the process module
 **
-** Allocates an initial set of PCBs, does whatever else is
+** Creates the PCB cache, does whatever else is
 ** needed to make it possible to create processes
 **
 ** Dependencies:
@@ -104,20 +224,31 @@ void _pcb_init( void ) {
 
     __cio_puts( " Process:" );
 
-    // allocate an initial slice of PCBs
-    _pcb_list = NULL;
-    assert( _pcb_add() );   // returns 0 on failure
+    // create the PCB cache
+    _pcb_cache = _kmem_cache_create( "pcb", sizeof(pcb_t),
+                                     KM_CACHE_LINE, _pcb_ctor );
+    assert( _pcb_cache != NULL );
 
     // reset the "active" variables
+    _lock_init( &_ptable_lock, "ptable", LOCK_SPIN );
     _n_procs = 0;
-    for( int i = 0; i < N_PROCS; ++i ) {
+    for( int i = 0; i < N_STATES; ++i ) {
+        _pstates[i] = 0;
+    }
+    _top_live = false;
+    for( int i = 0; i < PT_CHUNKS; ++i ) {
         _processes[i] = NULL;
     }
+    _pt_chunks = 0;
+    for( int i = 0; i < PID_HASH; ++i ) {
+        _pid_hash[i] = NULL;
+    }
 
     // first process is init, PID 1; it's created by system initialization
 
-    // second process is idle, PID 2; it's spawned by init()
-    _next_pid = 2;
+    // the rest start at PID 2:  each CPU's own idle process (see
+    // smp.c), then init's idle process and everything else
+    _next_pid = PID_FIRST;
 
     // all done!
     __cio_puts( " done" );
@@ -135,29 +266,9 @@ void _pcb_init( void ) {
 ** @return a pointer to the allocated PCB, or NULL
 */
 pcb_t *_pcb_alloc( void ) {
-    pcb_t *new;
-
-    // see if there is an available PCB
-    if( _pcb_list == NULL ) {
-
-        // no - see if we can create some
-        if( !_pcb_add() ) {
-            // no!  let's just leave quietly
-            return( NULL );
-        }
-    }
-
-    // OK, we know that there is at least one free PCB;
-    // just take the first one from the list
-
-    new = _pcb_list;
-    _pcb_list = (pcb_t *) new->context;
 
-    // clear out the fields in this one just to be safe
-    __memclr( new, sizeof(pcb_t) );
-
-    // pass it back to the caller
-    return( new );
+    // the cache clears it out for us
+    return( (pcb_t *) _kmem_cache_alloc(_pcb_cache) );
 }
 
 /**
@@ -175,12 +286,177 @@ void _pcb_free( pcb_t *pcb ) {
     }
 
     // mark it as unused and unknown (just in case)
-    pcb->state = Free;
+    _pcb_set_state( pcb, Free );
     pcb->pid = pcb->ppid = 0;
 
-    // stick it at the front of the list
-    pcb->context = (context_t *) _pcb_list;
-    _pcb_list = pcb;
+    // give it back to the cache
+    _kmem_cache_free( _pcb_cache, pcb );
+}
+
+/**
+** _pcb_set_state(pcb,state) - change the state of a process
+**
+** All state changes must be made through this, so that the
+** per-state counts stay correct.  Free PCBs aren't counted.
+**
+** @param pcb    The process
+** @param state  Its new state
+*/
+void _pcb_set_state( pcb_t *pcb, state_t state ) {
+
+#if TRACING_STATE
+    __cio_printf( "pid %d: %s -> %s\n", pcb->pid, _statestr[pcb->state],
+                  _statestr[state] );
+#endif
+
+    if( pcb->state != Free ) {
+        assert1( _pstates[pcb->state] > 0 );
+        --_pstates[pcb->state];
+    }
+    if( state != Free ) {
+        ++_pstates[state];
+    }
+
+    pcb->state = state;
+}
+
+/**
+** _ptable_add(pcb) - enter a process in the process table
+**
+** The process is also entered in the PID hash table, and (if it
+** has a parent) on its parent's list of children.
+**
+** @param pcb   The PCB to add
+**
+** @return E_SUCCESS, or E_NO_PROCS if the table is full
+*/
+status_t _ptable_add( pcb_t *pcb ) {
+
+    _lock_acquire( &_ptable_lock );
+
+    // grow the table if it's full
+    if( _n_procs >= _pt_chunks * PT_CHUNK ) {
+        pcb_t **chunk = NULL;
+        if( _pt_chunks < PT_CHUNKS ) {
+            chunk = (pcb_t **) _km_page_alloc( 1 );
+        }
+        if( chunk == NULL ) {
+            _lock_release( &_ptable_lock );
+            return( E_NO_PROCS );
+        }
+        _processes[_pt_chunks++] = chunk;
+    }
+
+    // the active processes are packed at the front of the table
+    uint32_t i = _n_procs++;
+    PTABLE( i ) = pcb;
+    pcb->slot = i;
+
+    uint32_t b = PID_BUCKET( pcb->pid );
+    pcb->hnext = _pid_hash[b];
+    _pid_hash[b] = pcb;
+
+    if( pcb->parent != NULL ) {
+        _sib_link( &pcb->parent->children, pcb );
+    }
+
+    _lock_release( &_ptable_lock );
+
+    return( E_SUCCESS );
+}
+
+/**
+** _pid_alloc() - choose a PID for a new process
+**
+** PIDs are handed out in increasing order, wrapping around after
+** PID_MAX; any that are still in use are skipped.
+**
+** @return the PID
+*/
+pid_t _pid_alloc( void ) {
+    pid_t pid;
+
+    _lock_acquire( &_ptable_lock );
+
+    // there are fewer processes than PIDs, so this will stop
+    do {
+        pid = _next_pid++;
+        if( _next_pid > PID_MAX ) {
+            _next_pid = PID_FIRST;
+        }
+    } while( _hash_find(pid) != NULL );
+
+    _lock_release( &_ptable_lock );
+
+    return( pid );
+}
+
+/**
+** _pcb_find(pid) - locate an active process by its PID
+**
+** @param pid   The PID to look for
+**
+** @return the PCB, or NULL if there is no such process
+*/
+pcb_t *_pcb_find( pid_t pid ) {
+
+    _lock_acquire( &_ptable_lock );
+    pcb_t *pcb = _hash_find( pid );
+    _lock_release( &_ptable_lock );
+
+    return( pcb );
+}
+
+/**
+** _pcb_zombie(pcb) - move an exited process from its parent's list
+**                    of children to its list of zombies
+**
+** @param pcb   The exited process
+*/
+void _pcb_zombie( pcb_t *pcb ) {
+
+    if( pcb->parent == NULL ) {
+        return;
+    }
+
+    _lock_acquire( &_ptable_lock );
+    _sib_unlink( pcb );
+    _sib_link( &pcb->parent->zombies, pcb );
+    _lock_release( &_ptable_lock );
+}
+
+/**
+** _pcb_reparent(pcb,parent) - give all of a process' children (live
+**                             and zombie) to another parent
+**
+** @param pcb     The process losing its children
+** @param parent  The process adopting them
+**
+** @return one of the zombies that was handed over, or NULL
+*/
+pcb_t *_pcb_reparent( pcb_t *pcb, pcb_t *parent ) {
+    pcb_t *zombie = pcb->zombies;
+    pcb_t *child;
+
+    _lock_acquire( &_ptable_lock );
+
+    while( (child = pcb->children) != NULL ) {
+        _sib_unlink( child );
+        child->parent = parent;
+        child->ppid = parent->pid;
+        _sib_link( &parent->children, child );
+    }
+
+    while( (child = pcb->zombies) != NULL ) {
+        _sib_unlink( child );
+        child->parent = parent;
+        child->ppid = parent->pid;
+        _sib_link( &parent->zombies, child );
+    }
+
+    _lock_release( &_ptable_lock );
+
+    return( zombie );
 }
 
 /**
@@ -196,22 +472,39 @@ void _pcb_cleanup( pcb_t *pcb ) {
         return;
     }
 
-    // clear the entry in the process table
-    for( int i = 0; i < N_PROCS; ++i ) {
-        if( _processes[i] == pcb ) {
-            _processes[i] = NULL;
-            --_n_procs;
-            break;
+    // clear its entries in the process and PID tables, and take
+    // it off its parent's list
+    _lock_acquire( &_ptable_lock );
+    if( pcb->slot < _n_procs && PTABLE(pcb->slot) == pcb ) {
+
+        // fill the hole with the last active process
+        --_n_procs;
+        pcb_t *last = PTABLE( _n_procs );
+        PTABLE( pcb->slot ) = last;
+        last->slot = pcb->slot;
+
+        _hash_remove( pcb );
+        if( pcb->parent != NULL ) {
+            _sib_unlink( pcb );
+        }
+
+        // give back the last chunk once we're well below it
+        if( _pt_chunks > 1 &&
+                _n_procs + PT_CHUNK / 2 < (_pt_chunks - 1) * PT_CHUNK ) {
+            _km_page_free( _processes[--_pt_chunks] );
+            _processes[_pt_chunks] = NULL;
         }
     }
+    _lock_release( &_ptable_lock );
 
-    // release the stack(en?)
+    // release its address space and stack(en?)
+    _vm_destroy( pcb );
     if( pcb->stack != NULL ) {
         _stk_free( pcb->stack );
     }
 
     // release the PCB
-    pcb->state = Free;  // just to be sure!
+    _pcb_set_state( pcb, Free );  // just to be sure!
     _pcb_free( pcb );
 }
 
@@ -244,11 +537,11 @@ void _pcb_dump( const char *msg, register pcb_t *p ) {
     }
 
     // now, the contents
-    __cio_printf( " pids %d/%d state %d prio %d",
-                  p->pid, p->ppid, p->state, p->priority );
+    __cio_printf( " pids %d/%d state %d prio %d/%d",
+                  p->pid, p->ppid, p->state, p->priority, p->base );
 
     __cio_printf( "\n ticks %d/%d xit %d wake %08x",
-                  p->ticks, p->quantum, p->exit_status, p->wakeup );
+                  p->ticks, p->quantum, p->exit_status, p->wake.expires );
 
     __cio_printf( "\n context %08x stack %08x",
                   (uint32_t) p->context, (uint32_t) p->stack );
@@ -316,14 +609,10 @@ void _context_dump_all( const char *msg ) {
         return;
     }
 
-    int n = 0;
-    for( int i = 0; i < N_PROCS; ++i ) {
-        pcb_t *pcb = _processes[i];
-        if( pcb != NULL && pcb->state != Free ) {
-            ++n;
-            __cio_printf( "%2d[%2d]: ", n, i );
-            _context_dump( NULL, pcb->context );
-        }
+    for( uint32_t i = 0; i < _n_procs; ++i ) {
+        pcb_t *pcb = PTABLE( i );
+        __cio_printf( "%2d[%2d]: ", i + 1, i );
+        _context_dump( NULL, CTX(pcb) );
     }
 }
 
@@ -341,49 +630,107 @@ void _ptable_dump( const char *msg, bool_t all ) {
         __cio_printf( "%s: ", msg );
     }
 
-    int used = 0;
-    int empty = 0;
+    __cio_printf( "%d of %d slots used\n", _n_procs,
+                  _pt_chunks * PT_CHUNK );
 
-    for( int i = 0; i < N_PROCS; ++i ) {
-        register pcb_t *pcb = _processes[i];
-        if( pcb == NULL ) {
+    // only the active slots need to be examined
+    for( uint32_t i = 0; i < _n_procs; ++i ) {
+        register pcb_t *pcb = PTABLE( i );
 
-            // an empty slot
-            ++empty;
+        // if not dumping everything, add commas if needed
+        if( !all && i > 0 ) {
+            __cio_putchar( ',' );
+        }
 
+        // things that are always printed
+        __cio_printf( " #%d: %d/%d", i, pcb->pid, pcb->ppid );
+        if( pcb->state < Free || pcb->state >= N_STATES ) {
+            __cio_printf( " UNKNOWN" );
         } else {
+            __cio_printf( " %s", _statestr[pcb->state] );
+        }
+        // do we want more info?
+        if( all ) {
+            __cio_printf( " stk %08x ESP %08x EIP %08x\n",
+                  (uint32_t) pcb->stack, REG(pcb,esp),
+                  REG(pcb,eip) );
+        }
 
-            // a non-empty slot
-            ++used;
-
-            // if not dumping everything, add commas if needed
-            if( !all && used ) {
-                __cio_putchar( ',' );
-            }
-
-            // things that are always printed
-            __cio_printf( " #%d: %d/%d", i, pcb->pid, pcb->ppid );
-            if( pcb->state < Free || pcb->state >= N_STATES ) {
-                __cio_printf( " UNKNOWN" );
-            } else {
-                __cio_printf( " %s", _statestr[pcb->state] );
-            }
-            // do we want more info?
-            if( all ) {
-                __cio_printf( " stk %08x ESP %08x EIP %08x\n",
-                      (uint32_t) pcb->stack, pcb->context->esp,
-                      pcb->context->eip );
-            }
+        // sanity check - make sure the process knows where it is
+        if( pcb->slot != i ) {
+            __cio_printf( " (thinks it is in slot %d!)", pcb->slot );
         }
     }
     // only need this if we're doing one-line output
     if( !all ) {
         __cio_putchar( '\n' );
     }
+}
 
-    // sanity check - make sure we saw the correct number of table slots
-    if( (used + empty) != N_PROCS ) {
-        __cio_printf( "Table size %d, used %d + empty %d = %d???\n",
-                      N_PROCS, used, empty, used + empty );
+/**
+** _pcb_stat(pcb,st)
+**
+** fill in the CPU accounting summary of a process
+**
+** @param pcb  The process
+** @param st   The summary
+*/
+void _pcb_stat( pcb_t *pcb, pstat_t *st ) {
+
+    st->pid = pcb->pid;
+    st->ppid = pcb->ppid;
+    st->state = pcb->state;
+    st->priority = pcb->priority;
+    st->sclass = pcb->sclass;
+    st->pad = 0;
+    st->nvcsw = pcb->nvcsw;
+    st->nivcsw = pcb->nivcsw;
+    st->runtime = pcb->runtime;
+
+    // times are kept in TSC cycles; convert them once we know
+    // how fast the TSC runs
+    if( _tsc_per_tick != 0 ) {
+        st->utime = (uint32_t) __udiv64( pcb->runtime - pcb->systime,
+                                         _tsc_per_tick );
+        st->stime = (uint32_t) __udiv64( pcb->systime, _tsc_per_tick );
+    } else {
+        st->utime = st->stime = 0;
+    }
+}
+
+/**
+** _ptable_top()
+**
+** dump a "top"-style summary of CPU usage by each active process:
+** its share of the CPU since the last summary, and its totals
+*/
+void _ptable_top( void ) {
+    uint64_t now = __get_tsc();
+    uint64_t elapsed = _top_stamp != 0 ? now - _top_stamp : 0;
+    pstat_t st;
+
+    _top_stamp = now;
+
+    __cio_printf( "\ntop: %d procs at %d, %d TSC cycles/tick\n",
+                  _n_procs, _system_time, _tsc_per_tick );
+    __cio_puts( "  PID  PPID ST PRI  %CPU  %SYS   UTIME   STIME"
+                "   VCSW  IVCSW\n" );
+
+    for( uint32_t i = 0; i < _n_procs; ++i ) {
+        pcb_t *pcb = PTABLE( i );
+
+        // (a newcomer's snapshot is zero, as it had no CPU time then)
+        uint32_t cpu = _permille( pcb->runtime - pcb->top_runtime,
+                                  elapsed );
+        uint32_t sys = _permille( pcb->systime - pcb->top_systime,
+                                  elapsed );
+        pcb->top_runtime = pcb->runtime;
+        pcb->top_systime = pcb->systime;
+
+        _pcb_stat( pcb, &st );
+        __cio_printf( "%5d %5d %2d %3d %3d.%d %3d.%d %7d %7d %6d %6d\n",
+                      st.pid, st.ppid, st.state, st.priority,
+                      cpu / 10, cpu % 10, sys / 10, sys % 10,
+                      st.utime, st.stime, st.nvcsw, st.nivcsw );
     }
 }
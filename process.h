@@ -27,13 +27,27 @@
 
 #include "common.h"
 
+#include "queues.h"
+#include "wheel.h"
+#include "lock.h"
+#include "vm.h"
+
+// CTX(pcb) -- the context save area of a process, as the kernel sees it
+//
+// the context pointer is a stack address, which only means something in
+// the process' own address space; this is the identity-mapped equivalent
+// (see vm.h), which can be used whichever process is current
+
+#define CTX(pcb)    ((context_t *) ((uint32_t) (pcb)->context - VM_STACK \
+                                    + (uint32_t) (pcb)->stack))
+
 // REG(pcb,x) -- access a specific register in a process context
 
-#define REG(pcb,x)  ((pcb)->context->x)
+#define REG(pcb,x)  (CTX(pcb)->x)
 
 // RET(pcb) -- access return value register in a process context
 
-#define RET(pcb)    ((pcb)->context->eax)
+#define RET(pcb)    (CTX(pcb)->eax)
 
 // ARG(pcb,n) -- access argument #n from the indicated process
 //
@@ -45,7 +59,7 @@
 // ASSUMES THE STANDARD 32-BIT ABI, WITH PARAMETERS PUSHED ONTO THE
 // STACK.  IF THE PARAMETER PASSING MECHANISM CHANGES, SO MUST THIS!
 
-#define ARG(pcb,n)  ( ( (uint32_t *) (((pcb)->context) + 1) ) [(n)] )
+#define ARG(pcb,n)  ( ( (uint32_t *) (CTX(pcb) + 1) ) [(n)] )
 
 /*
 ** Types
@@ -94,35 +108,106 @@ typedef struct context {
 //
 // fields are ordered by size to avoid padding
 //
-// ideally, its size should divide evenly into 1024 bytes;
-// currently, 32 bytes
+// currently, 192 bytes (a multiple of KM_CACHE_LINE, which the
+// PCB cache would round it up to anyway)
 
 typedef struct pcb_s {
     // four-byte values
 
     // Start with these eight bytes, for easy access in assembly
     context_t *context;     // pointer to context save area on stack
+                            // (a window address; see CTX())
     stack_t *stack;         // pointer to process stack
 
-    time_t wakeup;          // wakeup time for this process when sleeping
+    // eight-byte values
+    uint64_t runtime;       // TSC cycles spent on the CPU
+    uint64_t systime;       // part of that spent in ISRs and syscalls
+    uint64_t readied;       // TSC when it last woke up (0 if it hasn't
+                            // since it last ran)
+    uint64_t top_runtime;   // runtime and systime at the last "top"
+    uint64_t top_systime;   // display
+
+    // four-byte values again
+
+    wlink_t wake;           // sleep wheel link, and wakeup time
     int exit_status;        // termination status, for parent's use
 
     pid_t pid;              // unique PID for this process
     pid_t ppid;             // PID of the parent
 
+    // link for the ready and read queues (a process is on
+    // at most one of them at a time)
+    qlink_t link;
+
+    uint32_t vruntime;      // fair class:  weighted CPU time consumed
+
+    time_t deadline;        // EDF class:  absolute deadline of current job
+    uint32_t jobs;          // EDF class:  jobs completed
+    uint32_t misses;        // EDF class:  jobs that missed their deadline
+
+    uint32_t nvcsw;         // context switches:  gave up the CPU
+    uint32_t nivcsw;        // context switches:  had the CPU taken away
+
+    // family ties; a process is on exactly one of its parent's two
+    // lists, and processes created by the kernel have no parent
+    struct pcb_s *parent;   // the parent's PCB
+    struct pcb_s *children; // children that haven't exited
+    struct pcb_s *zombies;  // children that have exited, but not been
+                            // collected
+    struct pcb_s *sibling;  // next and previous on the parent's list
+    struct pcb_s *prev_sibling;
+
+    struct pcb_s *hnext;    // next in its PID hash chain
+
+    uint32_t *pgdir;        // page directory (see vm.h)
+    uint32_t brk;           // end of the data segment (see vm.h)
+
+    // two-byte values
+    uint16_t weight;        // fair class:  share of the CPU
+    uint16_t slot;          // index in the process table
+
+    uint16_t rt_runtime;    // EDF class:  CPU ticks needed per job
+    uint16_t rt_period;     // EDF class:  ticks between job releases
+    uint16_t rt_deadline;   // EDF class:  relative deadline of each job
+    uint16_t budget;        // EDF class:  ticks left for the current job
+
     // one-byte values
     state_t state;          // current state (see common.h)
     prio_t priority;        // process priority (MLQ queue level)
+    prio_t base;            // priority assigned at exec (MLFQ home level)
 
     uint8_t quantum;        // quantum for this process
     uint8_t ticks;          // ticks remaining in current slice
+    uint8_t sclass;         // scheduling class (see scheduler.h)
+    uint8_t cpu;            // CPU whose run queue it is on (or was last)
 
-    // filler, to round us up to 32 bytes
+    // filler, to round us up to 192 bytes
     // adjust this as fields are added/removed/changed
-    uint8_t filler[4];
+    uint8_t filler[21];
 
 } pcb_t;
 
+// offset of the queue link within a PCB, for _queue_create_linked()
+
+#define PCB_LINK    QLINK_OFFSET(pcb_t,link)
+
+// offset of the sleep wheel link within a PCB, for _wheel_create()
+
+#define PCB_WAKE    WLINK_OFFSET(pcb_t,wake)
+
+// the process table is a directory of chunks, each one page of PCB
+// pointers, allocated as the table grows; the active processes are
+// kept in slots 0 through _n_procs-1
+
+#define PT_CHUNK    1024
+#define PT_CHUNKS   (N_PROCS / PT_CHUNK)
+
+#define PTABLE(i)   (_processes[(i) / PT_CHUNK][(i) % PT_CHUNK])
+
+// largest PID handed out before wrapping around
+
+#define PID_MAX     32767
+
 /*
 ** Globals
 */
@@ -133,8 +218,17 @@ extern pid_t _next_pid;
 // active process count
 extern uint32_t _n_procs;
 
-// table of active processes
-extern pcb_t *_processes[N_PROCS];
+// number of processes in each state (but Free), kept by _pcb_set_state()
+extern uint32_t _pstates[N_STATES];
+
+// table of active processes (use PTABLE() to index it)
+extern pcb_t **_processes[PT_CHUNKS];
+
+// protects _processes[], _n_procs and _next_pid
+extern lock_t _ptable_lock;
+
+// refresh the "top" display every second?
+extern bool_t _top_live;
 
 /*
 ** Prototypes
@@ -147,7 +241,7 @@ extern pcb_t *_processes[N_PROCS];
 /**
 ** _pcb_init() - initialize the process module
 **
-** Allocates an initial set of PCBs, does whatever else is
+** Creates the PCB cache, does whatever else is
 ** needed to make it possible to create processes
 **
 ** Dependencies:
@@ -174,6 +268,67 @@ pcb_t *_pcb_alloc( void );
 */
 void _pcb_free( pcb_t *pcb );
 
+/**
+** _pcb_set_state(pcb,state) - change the state of a process
+**
+** All state changes must be made through this, so that the
+** per-state counts stay correct.
+**
+** @param pcb    The process
+** @param state  Its new state
+*/
+void _pcb_set_state( pcb_t *pcb, state_t state );
+
+/**
+** _ptable_add(pcb) - enter a process in the process table
+**
+** The process is also entered in the PID hash table, and (if it
+** has a parent) on its parent's list of children.
+**
+** @param pcb   The PCB to add
+**
+** @return E_SUCCESS, or E_NO_PROCS if the table is full
+*/
+status_t _ptable_add( pcb_t *pcb );
+
+/**
+** _pid_alloc() - choose a PID for a new process
+**
+** PIDs are handed out in increasing order, wrapping around after
+** PID_MAX; any that are still in use are skipped.
+**
+** @return the PID
+*/
+pid_t _pid_alloc( void );
+
+/**
+** _pcb_find(pid) - locate an active process by its PID
+**
+** @param pid   The PID to look for
+**
+** @return the PCB, or NULL if there is no such process
+*/
+pcb_t *_pcb_find( pid_t pid );
+
+/**
+** _pcb_zombie(pcb) - move an exited process from its parent's list
+**                    of children to its list of zombies
+**
+** @param pcb   The exited process
+*/
+void _pcb_zombie( pcb_t *pcb );
+
+/**
+** _pcb_reparent(pcb,parent) - give all of a process' children (live
+**                             and zombie) to another parent
+**
+** @param pcb     The process losing its children
+** @param parent  The process adopting them
+**
+** @return one of the zombies that was handed over, or NULL
+*/
+pcb_t *_pcb_reparent( pcb_t *pcb, pcb_t *parent );
+
 /*
 ** Debugging/tracing routines
 */
@@ -226,6 +381,24 @@ void _context_dump_all( const char *msg );
 */
 void _ptable_dump( const char *msg, bool_t all );
 
+/**
+** _pcb_stat(pcb,st)
+**
+** fill in the CPU accounting summary of a process
+**
+** @param pcb  The process
+** @param st   The summary
+*/
+void _pcb_stat( pcb_t *pcb, pstat_t *st );
+
+/**
+** _ptable_top()
+**
+** dump a "top"-style summary of CPU usage by each active process:
+** its share of the CPU since the last summary, and its totals
+*/
+void _ptable_top( void );
+
 #endif
 /* SP_ASM_SRC */
 
@@ -11,6 +11,7 @@
 #include "common.h"
 
 #include "queues.h"
+#include "slab.h"
 
 /*
 ** PRIVATE DEFINITIONS
@@ -19,6 +20,19 @@
 // internal form of queue length call
 #define QLEN(q)    ((q)->count)
 
+// initial number of entries in a heap-backed queue (doubled as needed)
+#define Q_HEAP_INIT     16
+
+// is this a heap-backed queue?
+#define ISHEAP(q)  ((q)->heap != NULL)
+
+// is this an intrusive queue?
+#define ISLINKED(q) ((q)->offset >= 0)
+
+// converters:  object to its intrusive link, and vice versa
+#define LINK(q,d)  ((qlink_t *) (((uint8_t *) (d)) + (q)->offset))
+#define OBJ(q,l)   ((void *) (((uint8_t *) (l)) - (q)->offset))
+
 // alternate version that actually invokes the function
 // #define QLEN(q)    _queue_length(q)
 
@@ -41,7 +55,27 @@
 ** is always done at the end of the queue.  Otherwise, the insertion is
 ** ordered according to the results from the comparison function.
 **
-** Neither of these types are visible to the rest of the system.  The
+** Ordered insertion into a list takes O(n) time.  A queue created with
+** _queue_create_heap() instead keeps its entries in a binary min-heap
+** held in an array (entry i has children 2i+1 and 2i+2), giving
+** O(log n) insertion and removal of the first entry.  Each heap entry
+** carries an insertion sequence number which breaks ties between equal
+** keys, so entries with equal keys come out in FIFO order just as they
+** do from an ordered list.  Removal of a specific entry must search the
+** array, but that is a linear scan of contiguous memory rather than a
+** walk down a chain of qnodes.
+**
+** A queue created with _queue_create_linked() is "intrusive":  each
+** object placed on it contains a qlink_t, and the queue is built from
+** those links, so no qnodes are ever allocated or freed.  FIFO
+** intrusive queues are doubly-linked lists (first/last); ordered ones
+** are pairing heaps, giving O(1) insertion, O(log n) amortized removal
+** of the first entry, and O(log n) amortized removal of any entry.
+** In a pairing heap, each node's 'child' points to its first child,
+** 'next' to its next sibling, and 'prev' to its previous sibling (or,
+** for a first child, to its parent).
+**
+** None of these types are visible to the rest of the system.  The
 ** queue_t type is a pointer to the q_s struct.
 */
 
@@ -53,163 +87,371 @@ typedef struct qn_s {
     key_t key;          // key to whatever's in this entry
 } qnode_t;
 
+// heap entries
+typedef struct hn_s {
+    void *data;         // what's in this entry
+    key_t key;          // key to whatever's in this entry
+    uint32_t seq;       // insertion order, to break ties between keys
+} hnode_t;
+
 // the queue itself is a pointer to this structure
 typedef struct q_s {
     qnode_t *head;      // first element
     qnode_t *tail;      // last element
     uint_t count;       // current occupancy count
     int (*order)( const key_t, const key_t ); // how to compare entries
+    hnode_t *heap;      // entries of a heap-backed queue, else NULL
+    uint_t size;        // number of entries the heap array can hold
+    uint32_t seq;       // next heap insertion sequence number
+    qlink_t *first;     // intrusive list head or heap root
+    qlink_t *last;      // intrusive list tail
+    int offset;         // offset of qlink_t within objects, or -1
 } qinfo_t;
 
 /*
 ** PRIVATE GLOBAL VARIABLES
 */
 
+// object caches for qnodes and queues
+static kmem_cache_t _qnode_cache;
+static kmem_cache_t _queue_cache;
+
 /*
-** The list of free qnodes.
-**
-** Organized as a singly-linked list using the 'next' pointer
-** in the qnode structure.
+** PUBLIC GLOBAL VARIABLES
 */
-static qnode_t *_qnode_list;
 
 /*
-** The initial set of queues available in the system.
-**
-** If these are all allocated, _queue_alloc() will allocate
-** another slice of memory as needed.
+** PRIVATE FUNCTIONS
 */
-static qinfo_t _queues[N_QUEUES];
 
 /*
-** The list of free queues.
+** Qnode Functions
+*/
+
+/**
+** _qnode_ctor() - initialize a newly-allocated qnode
 **
-** Organized as a singly-linked list using the 'head' pointer
-** in the q_s structure.
+** @param obj  The qnode
 */
-static qinfo_t *_queue_list;
+static void _qnode_ctor( void *obj ) {
+    qnode_t *qn = (qnode_t *) obj;
 
-/*
-** PUBLIC GLOBAL VARIABLES
+    // clear out the fields in this one just to be safe
+    qn->prev = qn->next = qn->data = NULL;
+    qn->key = 0;
+}
+
+/**
+** _qnode_alloc() - allocate a qnode
+**
+** @return A pointer to the allocated node, or NULL
 */
+static qnode_t *_qnode_alloc( void ) {
 
-/*
-** PRIVATE FUNCTIONS
+    return( (qnode_t *) _kmem_cache_alloc(_qnode_cache) );
+}
+
+/**
+** _qnode_free() - return a qnode to its cache
+**
+** Deallocates the supplied qnode
+**
+** @param qn   The qnode to be freed
 */
+static void _qnode_free( qnode_t *qn ) {
+    assert( qn != NULL );
+
+    _kmem_cache_free( _qnode_cache, qn );
+}
 
 /*
-** Qnode Functions
+** Heap Functions
 */
 
-// forward declarations for some internal functions
-static void _qnode_free( qnode_t *qn );
-void _queue_delete( queue_t q );
-
 /**
-** _qnode_new() - allocate a slice and carve it into qnodes
+** _heap_before() - does heap entry 'a' belong in front of entry 'b'?
 **
-** @return the number of qnodes added to the free list
+** @param q   The queue
+** @param a   First entry
+** @param b   Second entry
 */
-static int _qnode_new( void ) {
+static bool_t _heap_before( queue_t q, hnode_t *a, hnode_t *b ) {
+    int cmp = q->order( a->key, b->key );
 
-    // start by carving off a slice of memory
-    qnode_t *new = (qnode_t *) _km_slice_alloc();
+    // equal keys are served in order of insertion
+    return( cmp < 0 || (cmp == 0 && (int32_t) (a->seq - b->seq) < 0) );
+}
 
-    // if we couldn't get one, we're done
-    if( new == NULL ) {
-        return( 0 );
+/**
+** _heap_up() - move an entry toward the root until it is in place
+**
+** @param q   The queue
+** @param i   Index of the entry
+*/
+static void _heap_up( queue_t q, uint_t i ) {
+    hnode_t tmp = q->heap[i];
+
+    while( i > 0 ) {
+        uint_t parent = (i - 1) / 2;
+        if( !_heap_before(q,&tmp,&q->heap[parent]) ) {
+            break;
+        }
+        q->heap[i] = q->heap[parent];
+        i = parent;
     }
 
-    // clear out the allocated space
-    __memclr( new, SZ_SLICE );
+    q->heap[i] = tmp;
+}
+
+/**
+** _heap_down() - move an entry away from the root until it is in place
+**
+** @param q   The queue
+** @param i   Index of the entry
+*/
+static void _heap_down( queue_t q, uint_t i ) {
+    hnode_t tmp = q->heap[i];
 
-    // free the qnodes!
-    for( int i = 0; i < (SZ_SLICE / sizeof(qnode_t)); ++i ) {
-        // N.B.: if the slice size is not an integral multiple of
-        // the qnode size, this will leave a small internal fragment
-        // at the end of the allocated block of memory
-        _qnode_free( &new[i] );
+    for(;;) {
+        uint_t child = 2 * i + 1;
+        if( child >= q->count ) {
+            break;
+        }
+        // pick the earlier of the two children
+        if( child + 1 < q->count &&
+                _heap_before(q,&q->heap[child+1],&q->heap[child]) ) {
+            ++child;
+        }
+        if( !_heap_before(q,&q->heap[child],&tmp) ) {
+            break;
+        }
+        q->heap[i] = q->heap[child];
+        i = child;
     }
 
-    // all done
-    return( SZ_SLICE / sizeof(qnode_t) );
+    q->heap[i] = tmp;
 }
 
 /**
-** _qnode_alloc() - allocate a qnode
-**
-** Removes the first qnode from the free list.
+** _heap_take() - remove an entry from a heap
 **
-** @return A pointer to the allocated node, or NULL
+** @param q   The queue
+** @param i   Index of the entry
 */
-static qnode_t *_qnode_alloc( void ) {
-    qnode_t *new;
+static void _heap_take( queue_t q, uint_t i ) {
 
-    // see if there is an available node
-    if( _qnode_list == NULL ) {
+    q->count -= 1;
 
-        // no - see if we can create some
-        if( !_qnode_new() ) {
-            // no!  let's just leave quietly
-            return( NULL );
+    // if that wasn't the last entry, move the last one into its place
+    if( i < q->count ) {
+        q->heap[i] = q->heap[q->count];
+        if( i > 0 && _heap_before(q,&q->heap[i],&q->heap[(i-1)/2]) ) {
+            _heap_up( q, i );
+        } else {
+            _heap_down( q, i );
         }
     }
+}
 
-    // OK, we know that there is at least one free qnode;
-    // just take the first one from the list
+/**
+** _heap_grow() - double the capacity of a heap
+**
+** @param q   The queue
+**
+** @return the status of the attempt
+*/
+static status_t _heap_grow( queue_t q ) {
+    hnode_t *new = (hnode_t *) _kmalloc( 2 * q->size * sizeof(hnode_t) );
 
-    new = _qnode_list;
-    _qnode_list = new->next;
+    if( new == NULL ) {
+        return( E_NO_MEM );
+    }
 
-    // clear out the fields in this one just to be safe
-    new->prev = new->next = new->data = NULL;
-    new->key = 0;
+    __memcpy( new, q->heap, q->count * sizeof(hnode_t) );
+    _kfree( q->heap );
 
-    // pass it back to the caller
-    return( new );
+    q->heap = new;
+    q->size *= 2;
+
+    return( E_SUCCESS );
 }
 
+/*
+** Intrusive Queue Functions
+*/
+
 /**
-** _qnode_free() - return a qnode to the free list
+** _link_before() - does link 'a' belong in front of link 'b'?
 **
-** Deallocates the supplied qnode
+** @param q   The queue
+** @param a   First link
+** @param b   Second link
+*/
+static bool_t _link_before( queue_t q, qlink_t *a, qlink_t *b ) {
+    int cmp = q->order( a->key, b->key );
+
+    // equal keys are served in order of insertion
+    return( cmp < 0 || (cmp == 0 && (int32_t) (a->seq - b->seq) < 0) );
+}
+
+/**
+** _pair_meld() - combine two pairing heaps
+**
+** @param q   The queue
+** @param a   Root of the first heap (no siblings)
+** @param b   Root of the second heap (no siblings)
 **
-** @param qn   The qnode to be put on the free list
+** @return the root of the combined heap
 */
-static void _qnode_free( qnode_t *qn ) {
-    assert( qn != NULL );
+static qlink_t *_pair_meld( queue_t q, qlink_t *a, qlink_t *b ) {
+
+    // the earlier root becomes the parent
+    if( _link_before(q,b,a) ) {
+        qlink_t *tmp = a;
+        a = b;
+        b = tmp;
+    }
 
-    // just stick this one at the front of the list
-    qn->next = _qnode_list;
-    _qnode_list = qn;
+    // b becomes the first child of a
+    b->prev = a;
+    b->next = a->child;
+    if( a->child != NULL ) {
+        a->child->prev = b;
+    }
+    a->child = b;
+
+    return( a );
 }
 
 /**
-** _queue_new() - allocate a slice and carve it into queues
+** _pair_combine() - combine a list of sibling heaps into one heap
+**
+** Uses the standard two-pass method:  meld the siblings in pairs
+** from left to right, then meld the results from right to left.
+**
+** @param q      The queue
+** @param first  The first sibling, or NULL
 **
-** @return number of queues added to the free list
+** @return the root of the combined heap, or NULL
 */
-static int _queue_new( void ) {
-    struct q_s *slice;
+static qlink_t *_pair_combine( queue_t q, qlink_t *first ) {
+    qlink_t *list = NULL;   // melded pairs, in reverse order
+    qlink_t *root = NULL;
+
+    // first pass:  left to right, in pairs
+    while( first != NULL ) {
+        qlink_t *a = first;
+        qlink_t *b = a->next;
+
+        a->prev = NULL;
+        if( b == NULL ) {
+            a->next = list;
+            list = a;
+            break;
+        }
 
-    // start by carving off a slice of memory
-    slice = (struct q_s *) _km_slice_alloc();
+        first = b->next;
+        a->next = b->prev = b->next = NULL;
+        a = _pair_meld( q, a, b );
+        a->next = list;
+        list = a;
+    }
 
-    // NULL slice is a problem
-    if( slice == NULL ) {
-        return( 0 );
+    // second pass:  right to left, into a single heap
+    while( list != NULL ) {
+        qlink_t *tmp = list->next;
+        list->next = NULL;
+        root = (root == NULL) ? list : _pair_meld( q, root, list );
+        list = tmp;
     }
 
-    // clear out the allocated space
-    __memclr( slice, SZ_SLICE );
+    return( root );
+}
 
-    // 
-    for( int i = 0; i < (SZ_SLICE / sizeof(struct q_s)); ++i ) {
-        _queue_delete( slice + i );
+/**
+** _link_add() - add an object to an intrusive queue
+**
+** @param q     The queue
+** @param data  The object
+** @param key   The key value to be used when ordering the queue
+*/
+static void _link_add( queue_t q, void *data, key_t key ) {
+    qlink_t *ql = LINK( q, data );
+
+    // an object can only be on one queue at a time
+    assert( ql->queue == NULL );
+
+    ql->queue = q;
+    ql->key = key;
+    ql->seq = q->seq++;
+    ql->prev = ql->next = ql->child = NULL;
+
+    if( q->order != NULL ) {
+        // ordered:  meld a one-entry heap into the existing heap
+        q->first = (q->first == NULL) ? ql : _pair_meld( q, q->first, ql );
+    } else if( q->first == NULL ) {
+        // FIFO, empty:  first, last, and only element
+        q->first = q->last = ql;
+    } else {
+        // FIFO:  add at the end
+        ql->prev = q->last;
+        q->last->next = ql;
+        q->last = ql;
     }
 
-    // all done!
-    return( SZ_SLICE / sizeof(struct q_s) );
+    q->count += 1;
+}
+
+/**
+** _link_take() - remove a link from an intrusive queue
+**
+** @param q    The queue
+** @param ql   The link (which must be on this queue)
+*/
+static void _link_take( queue_t q, qlink_t *ql ) {
+
+    if( q->order == NULL ) {
+
+        // FIFO:  unlink from both neighbors
+        if( ql->prev == NULL ) {
+            q->first = ql->next;
+        } else {
+            ql->prev->next = ql->next;
+        }
+        if( ql->next == NULL ) {
+            q->last = ql->prev;
+        } else {
+            ql->next->prev = ql->prev;
+        }
+
+    } else if( ql == q->first ) {
+
+        // heap root:  its children form the new heap
+        q->first = _pair_combine( q, ql->child );
+
+    } else {
+
+        // interior node:  detach it (and its subtree) from the heap
+        if( ql->prev->child == ql ) {
+            ql->prev->child = ql->next;
+        } else {
+            ql->prev->next = ql->next;
+        }
+        if( ql->next != NULL ) {
+            ql->next->prev = ql->prev;
+        }
+
+        // then meld its children back in
+        qlink_t *sub = _pair_combine( q, ql->child );
+        if( sub != NULL ) {
+            q->first = _pair_meld( q, q->first, sub );
+        }
+    }
+
+    ql->prev = ql->next = ql->child = NULL;
+    ql->queue = NULL;
+
+    q->count -= 1;
 }
 
 /*
@@ -228,40 +470,87 @@ static int _queue_new( void ) {
 queue_t _queue_create( int (*order)(const key_t,const key_t) ) {
     queue_t new;
 
-    // see if there is an available node
-    if( _queue_list == NULL ) {
-
-        // no - see if we can create some
-        if( !_queue_new() ) {
-            // no!  let's just leave quietly
-            return( NULL );
-        }
+    new = (queue_t) _kmem_cache_alloc( _queue_cache );
+    if( new == NULL ) {
+        // no!  let's just leave quietly
+        return( NULL );
     }
 
-    // OK, we know that there is at least one free qnode;
-    // just take the first one from the list
-
-    new = _queue_list;
-    _queue_list = (queue_t) new->head;
-
-    // sanity check!
-    assert1( new != NULL );
-
-    // clear out the fields in this one just to be safe
+    // fill in the fields
     new->head = new->tail = NULL;
     new->count = 0;
     new->order = order;
+    new->heap = NULL;
+    new->size = 0;
+    new->seq = 0;
+    new->first = new->last = NULL;
+    new->offset = -1;
 
     // pass it back to the caller
     return( new );
 }
 
 /**
-** _queue_delete() - return a queue to the free list
+** _queue_create_heap() - allocate a heap-backed ordered queue
+**
+** Allocates a queue whose entries are kept in a binary heap rather
+** than in an ordered list.
+**
+** @param order   The ordering function to be used (must not be NULL)
+**
+** @return a pointer to the allocated queue, or NULL
+*/
+queue_t _queue_create_heap( int (*order)(const key_t,const key_t) ) {
+    queue_t new;
+
+    assert1( order != NULL );
+
+    new = _queue_create( order );
+    if( new == NULL ) {
+        return( NULL );
+    }
+
+    new->heap = (hnode_t *) _kmalloc( Q_HEAP_INIT * sizeof(hnode_t) );
+    if( new->heap == NULL ) {
+        _queue_delete( new );
+        return( NULL );
+    }
+    new->size = Q_HEAP_INIT;
+
+    return( new );
+}
+
+/**
+** _queue_create_linked() - allocate an intrusive queue
+**
+** Allocates a queue which links objects through a qlink_t inside
+** each object rather than through qnodes.
+**
+** @param order   The ordering function to be used, or NULL
+** @param offset  Offset of the qlink_t within each object
+**
+** @return a pointer to the allocated queue, or NULL
+*/
+queue_t _queue_create_linked( int (*order)(const key_t,const key_t),
+                              uint32_t offset ) {
+    queue_t new;
+
+    new = _queue_create( order );
+    if( new == NULL ) {
+        return( NULL );
+    }
+
+    new->offset = (int) offset;
+
+    return( new );
+}
+
+/**
+** _queue_delete() - return a queue to its cache
 **
 ** Deallocates the supplied queue
 **
-** @param q   The queue to be put on the free list
+** @param q   The queue to be freed
 */
 void _queue_delete( queue_t q ) {
 
@@ -269,9 +558,11 @@ void _queue_delete( queue_t q ) {
     assert1( q != NULL );
     assert1( q->count == 0 );
 
-    // just stick this one at the front of the list
-    q->head = (qnode_t *) _queue_list;
-    _queue_list = q;
+    if( ISHEAP(q) ) {
+        _kfree( q->heap );
+    }
+
+    _kmem_cache_free( _queue_cache, q );
 }
 
 /**
@@ -302,6 +593,25 @@ status_t _queue_add( queue_t q, void *data, key_t key ) {
     // sanity check!
     assert1( q != NULL );
 
+    // intrusive queues never need to allocate anything
+    if( ISLINKED(q) ) {
+        _link_add( q, data, key );
+        return( E_SUCCESS );
+    }
+
+    // heap-backed queues add the entry at the bottom and move it up
+    if( ISHEAP(q) ) {
+        if( q->count == q->size && _heap_grow(q) != E_SUCCESS ) {
+            return( E_NO_MEM );
+        }
+        q->heap[q->count].data = data;
+        q->heap[q->count].key = key;
+        q->heap[q->count].seq = q->seq++;
+        q->count += 1;
+        _heap_up( q, q->count - 1 );
+        return( E_SUCCESS );
+    }
+
     // need to use a qnode
     qnode_t *qn = _qnode_alloc();
     if( qn == NULL ) {
@@ -410,6 +720,19 @@ status_t _queue_remove( queue_t q, void **data ) {
     }
 
     // OK, we have something to return; take it from the queue
+    if( ISLINKED(q) ) {
+        qlink_t *ql = q->first;
+        *data = OBJ( q, ql );
+        _link_take( q, ql );
+        return( E_SUCCESS );
+    }
+
+    if( ISHEAP(q) ) {
+        *data = q->heap[0].data;
+        _heap_take( q, 0 );
+        return( E_SUCCESS );
+    }
+
     qnode_t *qn = q->head;
 
     // save the data value
@@ -455,7 +778,27 @@ void *_queue_remove_specific( queue_t q, void *data ) {
         return( NULL );
     }
 
+    // an intrusive queue knows where the object is, if it's there
+    if( ISLINKED(q) ) {
+        qlink_t *ql = LINK( q, data );
+        if( ql->queue != q ) {
+            return( NULL );
+        }
+        _link_take( q, ql );
+        return( data );
+    }
+
     // search the queue looking for that specific value
+    if( ISHEAP(q) ) {
+        for( uint_t i = 0; i < q->count; ++i ) {
+            if( q->heap[i].data == data ) {
+                _heap_take( q, i );
+                return( data );
+            }
+        }
+        return( NULL );
+    }
+
     qnode_t *qn = q->head;
 
     while( qn != NULL && qn->data != data ) {
@@ -514,7 +857,10 @@ void *_queue_peek( queue_t q ) {
 
     // if there is a node, return its data pointer
     if( QLEN(q) > 0 ) {
-        return( q->head->data );
+        if( ISLINKED(q) ) {
+            return( OBJ(q,q->first) );
+        }
+        return( ISHEAP(q) ? q->heap[0].data : q->head->data );
     }
 
     // otherwise, return NULL
@@ -522,27 +868,31 @@ void *_queue_peek( queue_t q ) {
 }
 
 /**
-** _queue_kpeek() - peek at the first element in a queue
+** _queue_kpeek() - peek at the key from the first element in a queue
 **
-** @param q   The queue to be checked
+** @param q    The queue to be checked
+** @param key  (output) The key from the first node in the queue
 **
-** @return the key from the first node in the queue, or 0
-**         if the queue is empty (note: an empty queue is
-**         not distinguishable from one whose first entry
-**         has a key value of 0 using this function!).
+** @return E_SUCCESS, or E_EMPTY if the queue is empty
 */
-key_t _queue_kpeek( queue_t q ) {
+status_t _queue_kpeek( queue_t q, key_t *key ) {
 
     // sanity check!
     assert1( q != NULL );
+    assert1( key != NULL );
 
-    // if there is a node, return its key value
-    if( QLEN(q) > 0 ) {
-        return( q->head->key );
+    // can't peek into an empty queue
+    if( QLEN(q) == 0 ) {
+        return( E_EMPTY );
+    }
+
+    if( ISLINKED(q) ) {
+        *key = q->first->key;
+    } else {
+        *key = ISHEAP(q) ? q->heap[0].key : q->head->key;
     }
 
-    // otherwise, return 0
-    return( 0 );
+    return( E_SUCCESS );
 }
 
 /*
@@ -567,8 +917,16 @@ void _queue_dump( const char *msg, queue_t q ) {
     }
 
     // first, the basic data
-    __cio_printf( "head %08x tail %08x %d count",
-                  (uint32_t) q->head, (uint32_t) q->tail, q->count );
+    if( ISLINKED(q) ) {
+        __cio_printf( "first %08x last %08x %d count",
+                      (uint32_t) q->first, (uint32_t) q->last, q->count );
+    } else if( ISHEAP(q) ) {
+        __cio_printf( "heap %08x size %d %d count",
+                      (uint32_t) q->heap, q->size, q->count );
+    } else {
+        __cio_printf( "head %08x tail %08x %d count",
+                      (uint32_t) q->head, (uint32_t) q->tail, q->count );
+    }
 
     // next, how the queue is ordered
     if( q->order ) {
@@ -578,7 +936,36 @@ void _queue_dump( const char *msg, queue_t q ) {
     }
 
     // if there are members in the queue, dump the first nodes
-    if( q->count > 0 ) {
+    // (for a heap, the first entries of the array; for a pairing
+    // heap, the root and its first few children)
+    if( q->count > 0 && ISLINKED(q) ) {
+        __cio_puts( " data: " );
+        qlink_t *tmp = q->first;
+        int i = 0;
+        for( ; i < 5 && tmp != NULL; ++i ) {
+            __cio_printf( " [%x,%08x]", tmp->key, (uint32_t) OBJ(q,tmp) );
+            tmp = (i == 0 && q->order != NULL) ? tmp->child : tmp->next;
+        }
+
+        if( tmp != NULL ) {
+            __cio_puts( " ..." );
+        }
+
+        __cio_putchar( '\n' );
+    } else if( q->count > 0 && ISHEAP(q) ) {
+        __cio_puts( " data: " );
+        uint_t i;
+        for( i = 0; i < 5 && i < q->count; ++i ) {
+            __cio_printf( " [%x,%08x]", q->heap[i].key,
+                          (uint32_t) q->heap[i].data );
+        }
+
+        if( i < q->count ) {
+            __cio_puts( " ..." );
+        }
+
+        __cio_putchar( '\n' );
+    } else if( q->count > 0 ) {
         __cio_puts( " data: " );
         qnode_t *tmp;
         int i = 0;
@@ -601,7 +988,7 @@ void _queue_dump( const char *msg, queue_t q ) {
 /**
 ** _queue_init() - initialize the queue module
 **
-** Allocates the initial set of qnodes and set of queues.
+** Creates the qnode and queue caches.
 **
 ** Dependencies:
 **    Cannot be called before kmem is initialized
@@ -611,15 +998,12 @@ void _queue_init( void ) {
 
     __cio_puts( " Queue:" );
 
-    // first, "allocate" our static set of queues
-    for( int i = 0; i < N_QUEUES; ++i ) {
-        _queue_delete( &_queues[i] );
-    }
-
-    // next, the qnodes
-    _qnode_list = NULL;
-    if( _qnode_new() < 1 ) {
-        PANIC( 0, "_qnode_new failed" );
+    _queue_cache = _kmem_cache_create( "queue", sizeof(qinfo_t),
+                                       KM_CACHE_LINE, NULL );
+    _qnode_cache = _kmem_cache_create( "qnode", sizeof(qnode_t),
+                                       KM_CACHE_LINE, _qnode_ctor );
+    if( _queue_cache == NULL || _qnode_cache == NULL ) {
+        PANIC( 0, "queue cache creation failed" );
     }
 
     // all done!
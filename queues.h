@@ -16,9 +16,6 @@
 ** used in either C or assembly-language source code.
 */
 
-// initial number of queues to create
-#define N_QUEUES    5
-
 #ifndef SP_ASM_SRC
 
 /*
@@ -43,6 +40,29 @@ typedef struct q_s *queue_t;
 // Key type (for ordering queues)
 typedef uint32_t key_t;
 
+/*
+** Intrusive queue links
+**
+** An object that is kept on a queue created by _queue_create_linked()
+** carries its own qlink_t, so adding it to the queue never requires
+** allocating a qnode.  An object can be on only one such queue (per
+** link) at a time.  The contents are private to the queue module;
+** a link that is not on any queue must be all zeroes.
+*/
+
+typedef struct qlink_s {
+    struct qlink_s *prev;   // predecessor (or parent, in a heap)
+    struct qlink_s *next;   // successor (or next sibling, in a heap)
+    struct qlink_s *child;  // first child (heaps only)
+    struct q_s *queue;      // queue this object is on, or NULL
+    key_t key;              // ordering key
+    uint32_t seq;           // insertion order, to break ties between keys
+} qlink_t;
+
+// QLINK_OFFSET(type,member) -- offset of a qlink_t within a structure
+
+#define QLINK_OFFSET(type,member)   ((uint32_t) &(((type *) 0)->member))
+
 /*
 ** Globals
 */
@@ -62,6 +82,36 @@ typedef uint32_t key_t;
 */
 queue_t _queue_create( int (*order)(const key_t, const key_t) );
 
+/**
+** _queue_create_heap() - allocate a heap-backed ordered queue
+**
+** The queue behaves exactly like an ordered queue from _queue_create(),
+** but insertion and removal of the first entry take O(log n) time
+** instead of O(n).
+**
+** @param order   The ordering function to be used (must not be NULL)
+**
+** @return a pointer to the allocated queue, or NULL
+*/
+queue_t _queue_create_heap( int (*order)(const key_t, const key_t) );
+
+/**
+** _queue_create_linked() - allocate an intrusive queue
+**
+** The objects placed on the queue must each contain a qlink_t at the
+** specified offset; the queue links them through it rather than
+** through separately-allocated qnodes, so _queue_add() on this queue
+** cannot fail for lack of memory.  With an ordering function, the
+** entries are kept in a pairing heap.
+**
+** @param order   The ordering function to be used, or NULL
+** @param offset  Offset of the qlink_t within each object
+**
+** @return a pointer to the allocated queue, or NULL
+*/
+queue_t _queue_create_linked( int (*order)(const key_t, const key_t),
+                              uint32_t offset );
+
 /**
 ** _queue_delete() - return a queue to the free list
 **
@@ -124,14 +174,12 @@ void *_queue_peek( queue_t q );
 /**
 ** _queue_kpeek() - peek at the key from the first element in a queue
 **
-** @param q   The queue to be checked
+** @param q    The queue to be checked
+** @param key  (output) The key from the first node in the queue
 **
-** @return The key from the first node in the queue, or 0
-**         if the queue is empty (note: an empty queue is
-**         not distinguishable from one whose first entry
-**         has a key value of 0 using this function!).
+** @return E_SUCCESS, or E_EMPTY if the queue is empty
 */
-key_t _queue_kpeek( queue_t q );
+status_t _queue_kpeek( queue_t q, key_t *key );
 
 /*
 ** Debugging/tracing routines
@@ -154,7 +202,7 @@ void _queue_dump( const char *msg, queue_t q );
 /**
 ** _queue_init() - initialize the queue module
 **
-** Allocates the initial set of qnodes and set of queues.
+** Creates the qnode and queue caches.
 **
 ** Dependencies:
 **    Cannot be called before kmem is initialized
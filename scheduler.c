@@ -10,11 +10,27 @@
 
 #include "common.h"
 #include "syscalls.h"
+#include "clock.h"
+#include "scheduler.h"
+#include "smp.h"
 
 /*
 ** PRIVATE DEFINITIONS
 */
 
+// number of words in each ready-level bitmap
+
+#define PRIO_WORDS  ((N_PRIOS + 31) / 32)
+
+// bitmap manipulation for priority level n
+
+#define MAP_WORD(n) ((n) >> 5)
+#define MAP_BIT(n)  (1U << ((n) & 31))
+
+// is virtual runtime (or time) 'a' before 'b'?  (both may wrap around)
+
+#define VR_BEFORE(a,b)  ((int32_t) ((a) - (b)) < 0)
+
 /*
 ** PRIVATE DATA TYPES
 */
@@ -23,20 +39,284 @@
 ** PRIVATE GLOBAL VARIABLES
 */
 
+// fair class bookkeeping
+static uint32_t _fair_weight;   // total weight of processes on _fair
+static uint32_t _fair_min;      // virtual runtime floor for newcomers
+
+// EDF class bookkeeping
+static uint32_t _edf_util;      // total density of the admitted tasks
+static uint32_t _edf_misses;    // deadline misses by all tasks, ever
+
+// wakeup latency histograms (see scheduler.h)
+static uint32_t _lat_hist[LAT_LEVELS][LAT_BUCKETS];
+
+/*
+** Each CPU has its own MLQ ready queue, and its own CPU accounting
+** state, in its cpu_t.  Alongside each MLQ is a bitmap of ready
+** levels:  bit n is set whenever ready[n] may be non-empty.  A clear
+** bit guarantees an empty queue; a set bit can be stale if someone
+** other than _sched_take() (e.g., _sys_kill()) removed the last
+** process from that queue, so _sched_level() double-checks the queue
+** and clears stale bits as it finds them.  Both are protected by the
+** CPU's ready_lock, as other CPUs add to them and steal from them.
+**
+** The fair and EDF class run queues are shared by all the CPUs.
+*/
+
 /*
 ** PUBLIC GLOBAL VARIABLES
 */
 
-// the ready queue:  a MLQ with one level per priority value
-queue_t _ready[N_PRIOS];
+// the scheduling policy in effect
+int _sched_policy;
+
+// the fair class run queue, ordered by virtual runtime
+queue_t _fair;
 
-// the current user process
-pcb_t *_current;
+// the EDF class run queue, ordered by absolute deadline
+queue_t _edf;
 
 /*
 ** PRIVATE FUNCTIONS
 */
 
+/**
+** _sched_mlfq() - is a process subject to the MLFQ rules?
+**
+** Only User processes are, and only when MLFQ is in effect.
+*/
+static bool_t _sched_mlfq( pcb_t *pcb ) {
+    return( _sched_policy == SchedMLFQ && pcb->sclass == SCLASS_MLQ &&
+            pcb->base >= User && pcb->base < Deferred );
+}
+
+/**
+** _cmp_vruntime() - ordering function for the fair class run queue
+**
+** Also orders the EDF class run queue, as deadlines wrap around
+** the same way.
+*/
+static int _cmp_vruntime( const key_t v1, const key_t v2 ) {
+    return( VR_BEFORE(v1,v2) ? -1 : (v1 == v2 ? 0 : 1) );
+}
+
+/**
+** _edf_density() - the share of the CPU an EDF task may claim
+**
+** This is runtime/deadline (at least runtime/period, as the deadline
+** can't be longer than the period), in parts per EDF_UTIL_SCALE,
+** rounded up.  Keeping the total at or below 100% guarantees that
+** every job can meet its deadline.
+*/
+static uint32_t _edf_density( uint32_t runtime, uint32_t deadline ) {
+    return( (runtime * EDF_UTIL_SCALE + deadline - 1) / deadline );
+}
+
+/**
+** _edf_done() - account for the end of an EDF job
+**
+** It missed its deadline if it ended after that time.
+*/
+static void _edf_done( pcb_t *pcb ) {
+
+    ++pcb->jobs;
+    if( VR_BEFORE(pcb->deadline,_system_time) ) {
+        ++pcb->misses;
+        ++_edf_misses;
+    }
+}
+
+/**
+** _sched_quantum() - length of the time slice for a process
+**
+** Under MLFQ, this depends on the level the process is at.  In the
+** fair class, it is the process' share of the target latency.
+*/
+static uint8_t _sched_quantum( pcb_t *pcb ) {
+
+    // an EDF task runs until its budget is used up or someone
+    // with an earlier deadline comes along
+    if( pcb->sclass == SCLASS_EDF ) {
+        return( pcb->budget < 255 ? pcb->budget : 255 );
+    }
+
+    if( pcb->sclass == SCLASS_FAIR ) {
+        uint32_t slice = (FAIR_LATENCY * pcb->weight) /
+                         (_fair_weight + pcb->weight);
+        return( slice < FAIR_MIN_SLICE ? FAIR_MIN_SLICE : slice );
+    }
+
+    if( _sched_mlfq(pcb) && pcb->priority >= User &&
+            pcb->priority < User + MLFQ_LEVELS ) {
+        return( pcb->quantum << (pcb->priority - User) );
+    }
+
+    return( pcb->quantum );
+}
+
+/**
+** _sched_account() - charge the CPU time since the last accounting
+**                    point to the process that had a CPU
+**
+** @param cpu     The CPU
+** @param system  Was it spent in the kernel?
+*/
+static void _sched_account( cpu_t *cpu, bool_t system ) {
+    uint64_t now = __get_tsc();
+
+    if( cpu->acct_pcb != NULL ) {
+        cpu->acct_pcb->runtime += now - cpu->acct_stamp;
+        if( system ) {
+            cpu->acct_pcb->systime += now - cpu->acct_stamp;
+        }
+    }
+
+    cpu->acct_stamp = now;
+}
+
+/**
+** _sched_level() - find the highest-priority non-empty level of
+**                  a CPU's ready queue
+**
+** Uses the bitmap of non-empty levels, so the cost does not depend
+** on the number of priority levels.
+**
+** @param cpu   The CPU
+**
+** @return the priority level, or N_PRIOS if nothing is ready
+*/
+static int _sched_level( cpu_t *cpu ) {
+    int n = N_PRIOS;
+
+    _lock_acquire( &cpu->ready_lock );
+
+    for( int w = 0; w < PRIO_WORDS && n == N_PRIOS; ++w ) {
+        while( cpu->ready_map[w] != 0 ) {
+            int level = (w << 5) + __bsf( cpu->ready_map[w] );
+            if( _queue_length(cpu->ready[level]) > 0 ) {
+                n = level;
+                break;
+            }
+            // stale bit - the queue was emptied behind our back
+            cpu->ready_map[w] &= ~MAP_BIT(level);
+        }
+    }
+
+    _lock_release( &cpu->ready_lock );
+
+    return( n );
+}
+
+/**
+** _sched_take() - remove the first process from one level of
+**                 a CPU's ready queue
+**
+** @param cpu   The CPU
+** @param n     The level (must not be empty)
+**
+** @return the process
+*/
+static pcb_t *_sched_take( cpu_t *cpu, int n ) {
+    pcb_t *pcb;
+
+    _lock_acquire( &cpu->ready_lock );
+
+    status_t status = _queue_remove( cpu->ready[n], (void **) &pcb );
+
+    // failure to deque means something serious has gone wrong
+    assert( status == E_SUCCESS );
+
+    // if we emptied it, this level is no longer ready
+    if( _queue_length(cpu->ready[n]) == 0 ) {
+        cpu->ready_map[MAP_WORD(n)] &= ~MAP_BIT(n);
+    }
+
+    _lock_release( &cpu->ready_lock );
+
+    return( pcb );
+}
+
+/**
+** _sched_victim() - find a CPU to take work from
+**
+** Only work above the Deferred level is taken:  each CPU's own idle
+** process stays on its own Deferred queue.  The CPU with the most
+** urgent work wins; ties go to the next one after us, so that the
+** thieves don't all pick on the same CPU.
+**
+** @param cpu    The CPU looking for work
+** @param level  Where to put the level to take from
+**
+** @return the victim, or NULL if there is nothing to take
+*/
+static cpu_t *_sched_victim( cpu_t *cpu, int *level ) {
+    cpu_t *victim = NULL;
+    int best = Deferred;
+
+    for( uint32_t i = 1; i < _n_cpus; ++i ) {
+        cpu_t *other = &_cpus[(cpu->id + i) % _n_cpus];
+        int n = _sched_level( other );
+        if( n < best ) {
+            best = n;
+            victim = other;
+        }
+    }
+
+    if( victim != NULL ) {
+        *level = best;
+    }
+
+    return( victim );
+}
+
+/**
+** _sched_latency() - record the wakeup latency of a process that is
+**                    being dispatched
+**
+** @param pcb   The process
+*/
+static void _sched_latency( pcb_t *pcb ) {
+
+    if( pcb->readied == 0 ) {
+        // it was preempted, not woken up
+        return;
+    }
+
+    uint64_t cycles = __get_tsc() - pcb->readied;
+    pcb->readied = 0;
+
+    uint32_t b = LAT_BUCKETS - 1;
+    if( (cycles >> 32) == 0 ) {
+        b = cycles != 0 ? __bsr( (uint32_t) cycles ) : 0;
+    }
+
+    int level = pcb->sclass == SCLASS_EDF ? LAT_EDF :
+                pcb->sclass == SCLASS_FAIR ? LAT_FAIR : pcb->priority;
+
+    ++_lat_hist[level][b];
+}
+
+/**
+** _sched_move() - change the priority of a process
+**
+** If the process is on a ready queue, it is moved to the right one.
+*/
+static void _sched_move( pcb_t *pcb, prio_t prio ) {
+
+    if( pcb->priority == prio ) {
+        return;
+    }
+
+    if( pcb->state == Ready ) {
+        void *data = _sched_unready( pcb );
+        assert1( data == pcb );
+        pcb->priority = prio;
+        _schedule( pcb );
+    } else {
+        pcb->priority = prio;
+    }
+}
+
 /*
 ** PUBLIC FUNCTIONS
 */
@@ -54,19 +334,55 @@ void _sched_init( void ) {
 
     __cio_puts( " Sched:" );
     
-    // allocate the ready queues
-    for( int i = 0; i < N_PRIOS; ++i ) {
-        _ready[i] = _queue_create( NULL );
-        // at this point, allocation failure is terminal
-        assert( _ready[i] != NULL );
-    }
-    
-    // reset the "current process" pointer
-    _current = NULL;
+    // this CPU's ready queues
+    _sched_cpu_init( _cpu );
+
+    __memclr( _lat_hist, sizeof(_lat_hist) );
+
+    _fair = _queue_create_linked( _cmp_vruntime, PCB_LINK );
+    assert( _fair != NULL );
+    _fair_weight = _fair_min = 0;
+
+    _edf = _queue_create_linked( _cmp_vruntime, PCB_LINK );
+    assert( _edf != NULL );
+    _edf_util = _edf_misses = 0;
+
+    // start with fixed priorities
+    _sched_policy = SchedMLQ;
     
     __cio_puts( " done" );
 }
 
+/**
+** _sched_cpu_init() - initialize a CPU's scheduler state
+**
+** Allocates its ready queues (the first time) and resets its
+** "current process" pointer
+**
+** @param cpu   The CPU
+*/
+void _sched_cpu_init( cpu_t *cpu ) {
+
+    if( cpu->ready[0] == NULL ) {
+        _lock_init( &cpu->ready_lock, "ready", LOCK_SPIN );
+        for( int i = 0; i < N_PRIOS; ++i ) {
+            cpu->ready[i] = _queue_create_linked( NULL, PCB_LINK );
+            // at this point, allocation failure is terminal
+            assert( cpu->ready[i] != NULL );
+        }
+    }
+
+    // nothing is ready yet
+    for( int i = 0; i < PRIO_WORDS; ++i ) {
+        cpu->ready_map[i] = 0;
+    }
+
+    cpu->current = NULL;
+    cpu->acct_pcb = NULL;
+    cpu->forced = false;
+    cpu->ticks = cpu->steals = 0;
+}
+
 /**
 ** _schedule() - add a process to the ready queue
 **
@@ -85,46 +401,142 @@ void _schedule( pcb_t *pcb ) {
         return;
     }
 
+    // a new process starts out on the queue of the CPU creating it
+    if( pcb->state == New ) {
+        pcb->cpu = _cpu->id;
+    }
+
+    // note when a process returning to the CPU became ready (one
+    // that is just changing queues keeps the time it had)
+    if( pcb->state == Running ) {
+        pcb->readied = 0;
+    } else if( pcb->state != Ready ) {
+        pcb->readied = __get_tsc();
+    }
+
+    // EDF tasks are ordered by deadline.  When a job is over, the
+    // next one is released a period after it was, or as soon as the
+    // task is runnable again, whichever is later; until then, the
+    // task is throttled on the sleep wheel.
+    if( pcb->sclass == SCLASS_EDF ) {
+        if( pcb->budget == 0 ) {
+            time_t release = pcb->deadline - pcb->rt_deadline +
+                             pcb->rt_period;
+            if( VR_BEFORE(_system_time,release) ) {
+                _pcb_set_state( pcb, Sleeping );
+                _lock_acquire( &_sleep_lock );
+                _wheel_add( _sleeping, (void *) pcb, release );
+                _lock_release( &_sleep_lock );
+                return;
+            }
+            pcb->deadline = _system_time + pcb->rt_deadline;
+            pcb->budget = pcb->rt_runtime;
+        }
+        _pcb_set_state( pcb, Ready );
+        int status = _queue_add( _edf, pcb, pcb->deadline );
+        assert( status == E_SUCCESS );
+        return;
+    }
+
+    // fair class processes are ordered by virtual runtime; one that
+    // has been away (sleeping, blocked, or new) starts no further
+    // back than the furthest-behind runnable process, so it can't
+    // save up CPU time while it isn't competing for it
+    if( pcb->sclass == SCLASS_FAIR ) {
+        if( pcb->state != Running && VR_BEFORE(pcb->vruntime,_fair_min) ) {
+            pcb->vruntime = _fair_min;
+        }
+        _pcb_set_state( pcb, Ready );
+        int status = _queue_add( _fair, pcb, pcb->vruntime );
+        assert( status == E_SUCCESS );
+        _fair_weight += pcb->weight;
+        return;
+    }
+
     // bad priority value causes a fault
     assert1( pcb->priority < N_PRIOS );
     
     // mark the process as ready to execute
-    pcb->state = Ready;
+    _pcb_set_state( pcb, Ready );
 
-    // add it to the appropriate queue
-    int status = _queue_add( _ready[pcb->priority], pcb, 0 );
+    // add it to the appropriate queue of the CPU it last ran on
+    cpu_t *cpu = &_cpus[pcb->cpu];
+    _lock_acquire( &cpu->ready_lock );
+    int status = _queue_add( cpu->ready[pcb->priority], pcb, 0 );
 
     // failure is not an option!
     assert( status == E_SUCCESS );
+
+    // this level now has something in it
+    cpu->ready_map[MAP_WORD(pcb->priority)] |= MAP_BIT(pcb->priority);
+    _lock_release( &cpu->ready_lock );
+}
+
+/**
+** _sched_highest() - find the highest-priority non-empty level of
+**                    this CPU's ready queue
+**
+** @return the priority level, or N_PRIOS if nothing is ready
+*/
+int _sched_highest( void ) {
+    return( _sched_level(_cpu) );
 }
 
 /**
 ** _dispatch() - select a new "current" process
 **
-** Selects the highest-priority process available
+** Selects the highest-priority process available.  When this CPU
+** has nothing above the Deferred level, it takes work from the
+** other CPUs' ready queues first.
 */
 void _dispatch( void ) {
+    cpu_t *cpu = _cpu;
+    cpu_t *victim;
     pcb_t *pcb;
     int n;
     
     do {
 
-        // find a ready queue that has an available process
-        for( n = 0; n < N_PRIOS; ++n ) {
-            if( _queue_length(_ready[n]) > 0 ) {
-                break;
+        status_t status;
+
+        if( _queue_length(_edf) > 0 ) {
+
+            // EDF tasks run ahead of everything else; take the one
+            // whose deadline is nearest
+            status = _queue_remove( _edf, (void **) &pcb );
+            assert( status == E_SUCCESS );
+
+        } else if( (n = _sched_level(cpu)) < Deferred ) {
+
+            // take the first process from our best level
+            pcb = _sched_take( cpu, n );
+
+        } else if( (victim = _sched_victim(cpu,&n)) != NULL ) {
+
+            // nothing to do here, but another CPU has a backlog;
+            // take the first process from its best level
+            pcb = _sched_take( victim, n );
+            ++cpu->steals;
+
+        } else if( _queue_length(_fair) > 0 ) {
+
+            // the fair class runs ahead of deferred work; take the
+            // process that has had the least (weighted) CPU time
+            status = _queue_remove( _fair, (void **) &pcb );
+            assert( status == E_SUCCESS );
+            _fair_weight -= pcb->weight;
+            if( VR_BEFORE(_fair_min,pcb->vruntime) ) {
+                _fair_min = pcb->vruntime;
             }
-        }
 
-        // this should never happen - if nothing else, the
-        // idle process should be on the "Deferred" queue
-        assert( n < N_PRIOS );
+        } else {
 
-        // OK, we found a queue; pull the first process from it
-        status_t status = _queue_remove( _ready[n], (void **) &pcb );
+            // this should never happen - if nothing else, this
+            // CPU's idle process should be on its "Deferred" queue
+            assert( n < N_PRIOS );
 
-        // failure to deque means something serious has gone wrong
-        assert( status == E_SUCCESS );
+            pcb = _sched_take( cpu, n );
+        }
 
         // if this process has been terminated, clean it up, then
         // loop and pick another process; otherwise, leave the loop
@@ -137,10 +549,456 @@ void _dispatch( void ) {
 
     } while( 1 );
 
-    // set its state and remaining quantum
-    pcb->state = Running;
-    pcb->ticks = pcb->quantum;
+    // set its state, remaining quantum, and (new) home
+    _pcb_set_state( pcb, Running );
+    pcb->ticks = _sched_quantum( pcb );
+    pcb->cpu = cpu->id;
+
+    _sched_latency( pcb );
+
+    // the outgoing process pays for the time up to now; from here
+    // on, the time belongs to the new one
+    _sched_account( cpu, true );
+    if( pcb != cpu->acct_pcb && cpu->acct_pcb != NULL ) {
+        if( cpu->forced ) {
+            ++cpu->acct_pcb->nivcsw;
+        } else {
+            ++cpu->acct_pcb->nvcsw;
+        }
+    }
+    cpu->acct_pcb = pcb;
+    cpu->forced = false;
 
     // make this the current process
-    _current = pcb;
+    cpu->current = pcb;
+}
+
+/**
+** _sched_preempt() - take the CPU away from the current process and
+**                    return it to the ready queue
+**
+** Under MLFQ, a process whose time slice has expired drops to the
+** next level down.
+**
+** @param pcb   The process
+*/
+void _sched_preempt( pcb_t *pcb ) {
+
+    _cpu->forced = true;
+
+    if( pcb->sclass == SCLASS_EDF ) {
+        // out of budget means the job is over
+        if( pcb->budget == 0 ) {
+            _edf_done( pcb );
+        }
+    } else if( pcb->ticks == 0 ) {
+        if( _sched_mlfq(pcb) ) {
+            // it used its whole slice:  drop a level, if there is one
+            if( pcb->priority < User + MLFQ_LEVELS - 1 ) {
+                pcb->priority += 1;
+            }
+        } else {
+            // everyone else runs at their base level (this sends an
+            // aged Deferred process back where it came from)
+            pcb->priority = pcb->base;
+        }
+    }
+
+    // (a process preempted before its slice ran out keeps its level)
+    _schedule( pcb );
+}
+
+/**
+** _sched_block() - note that a process is giving up the CPU to wait
+**                  for something (sleep, or input)
+**
+** Under MLFQ, the process rises to the next level up.
+**
+** @param pcb   The process
+*/
+void _sched_block( pcb_t *pcb ) {
+
+    if( pcb->sclass == SCLASS_EDF ) {
+        // the job is finished; what's left of its budget is forfeit
+        _edf_done( pcb );
+        pcb->budget = 0;
+    } else if( _sched_mlfq(pcb) && pcb->priority > pcb->base ) {
+        pcb->priority -= 1;
+    }
+}
+
+/**
+** _sched_boost() - return every process to its base priority
+**
+** Deferred processes are aged into the lowest MLFQ level, so that
+** they get some CPU time even when User processes are always ready.
+*/
+void _sched_boost( void ) {
+
+    for( uint32_t i = 0; i < _n_procs; ++i ) {
+        pcb_t *pcb = PTABLE( i );
+
+        // (the CPUs' idle processes must stay where they are)
+        if( pcb->base < User ||
+                pcb->sclass != SCLASS_MLQ || pcb == _cpus[pcb->cpu].idle ) {
+            continue;
+        }
+
+        if( pcb->base == Deferred ) {
+            // only those actually waiting for the CPU
+            if( _sched_policy == SchedMLFQ && pcb->state == Ready ) {
+                _sched_move( pcb, User + MLFQ_LEVELS - 1 );
+            }
+        } else {
+            _sched_move( pcb, pcb->base );
+        }
+    }
+}
+
+/**
+** _sched_setpolicy() - select a scheduling policy
+**
+** @param policy  The new policy
+**
+** @return the previous policy, or E_BAD_PARAM
+*/
+int _sched_setpolicy( int policy ) {
+    int old = _sched_policy;
+
+    if( policy < 0 || policy >= N_POLICIES ) {
+        return( E_BAD_PARAM );
+    }
+
+    // nobody keeps a level earned under the old policy
+    _sched_boost();
+    _sched_policy = policy;
+
+    return( old );
+}
+
+/**
+** _sched_idle() - is deferred work all there is to run?
+**
+** @return true if the current process and everything that is ready
+**         is at the Deferred level
+*/
+bool_t _sched_idle( void ) {
+    int n;
+
+    return( _current->sclass == SCLASS_MLQ &&
+            _current->priority == Deferred &&
+            _sched_highest() >= Deferred && _queue_length(_fair) == 0 &&
+            _queue_length(_edf) == 0 && _sched_victim(_cpu,&n) == NULL );
+}
+
+/**
+** _sched_charge() - charge CPU time to a process
+**
+** @param pcb   The process
+** @param n     Number of ticks it has run
+*/
+void _sched_charge( pcb_t *pcb, uint32_t n ) {
+
+    // the lighter the process, the faster its virtual clock runs
+    if( pcb->sclass == SCLASS_FAIR ) {
+        pcb->vruntime += (n * FAIR_TICK * WEIGHT_DEFAULT) / pcb->weight;
+    } else if( pcb->sclass == SCLASS_EDF ) {
+        pcb->budget -= n < pcb->budget ? n : pcb->budget;
+    }
+}
+
+/**
+** _sched_unready() - take a Ready process off its run queue
+**
+** @param pcb   The process
+**
+** @return the process, or NULL if it wasn't on the queue
+*/
+pcb_t *_sched_unready( pcb_t *pcb ) {
+
+    if( pcb->sclass == SCLASS_FAIR ) {
+        pcb_t *tmp = _queue_remove_specific( _fair, pcb );
+        if( tmp != NULL ) {
+            _fair_weight -= pcb->weight;
+        }
+        return( tmp );
+    }
+
+    if( pcb->sclass == SCLASS_EDF ) {
+        return( _queue_remove_specific(_edf, pcb) );
+    }
+
+    cpu_t *cpu = &_cpus[pcb->cpu];
+    _lock_acquire( &cpu->ready_lock );
+    pcb_t *tmp = _queue_remove_specific( cpu->ready[pcb->priority], pcb );
+    _lock_release( &cpu->ready_lock );
+
+    return( tmp );
+}
+
+/**
+** _sched_setweight() - set the fair class weight of a process
+**
+** A non-zero weight puts the process in the fair class; a weight of
+** zero returns it to the priority levels.
+**
+** @param pcb     The process
+** @param weight  The new weight
+**
+** @return the status of the change
+*/
+status_t _sched_setweight( pcb_t *pcb, uint32_t weight ) {
+
+    // EDF tasks must leave that class first
+    if( weight > WEIGHT_MAX || pcb->sclass == SCLASS_EDF ) {
+        return( E_BAD_PARAM );
+    }
+
+    // a Ready process must move to the right queue
+    bool_t ready = pcb->state == Ready;
+    if( ready ) {
+        void *data = _sched_unready( pcb );
+        assert1( data == pcb );
+        // keep _schedule() from treating it as a newcomer
+        _pcb_set_state( pcb, Running );
+    }
+
+    if( weight == 0 ) {
+        pcb->sclass = SCLASS_MLQ;
+    } else {
+        if( pcb->sclass != SCLASS_FAIR ) {
+            // joining:  start even with the furthest-behind process
+            pcb->vruntime = _fair_min;
+            pcb->sclass = SCLASS_FAIR;
+        }
+        pcb->weight = weight;
+    }
+
+    if( ready ) {
+        _schedule( pcb );
+    }
+
+    return( E_SUCCESS );
+}
+
+/**
+** _sched_setdeadline() - set the EDF class parameters of a process
+**
+** Non-zero parameters put the process in the EDF class, if the
+** total density of the EDF tasks would stay within EDF_UTIL_MAX;
+** a runtime of zero returns it to the priority levels.  A deadline
+** of zero means the deadline is the period.
+**
+** @param pcb       The process (must be the current process)
+** @param runtime   CPU ticks needed by each job
+** @param period    Ticks between job releases
+** @param deadline  Ticks from release by which each job must finish
+**
+** @return the status of the change
+*/
+status_t _sched_setdeadline( pcb_t *pcb, uint32_t runtime,
+                             uint32_t period, uint32_t deadline ) {
+
+    // only the current process changes class, so it isn't on
+    // any run queue
+    assert1( pcb == _current );
+
+    if( runtime == 0 ) {
+        _sched_release( pcb );
+        return( E_SUCCESS );
+    }
+
+    if( deadline == 0 ) {
+        deadline = period;
+    }
+
+    if( period > EDF_PARAM_MAX || deadline > period || runtime > deadline ) {
+        return( E_BAD_PARAM );
+    }
+
+    // admission control:  a task changing its parameters gives up
+    // its old share of the CPU
+    uint32_t old = pcb->sclass == SCLASS_EDF ?
+                   _edf_density( pcb->rt_runtime, pcb->rt_deadline ) : 0;
+    uint32_t util = _edf_util - old + _edf_density( runtime, deadline );
+
+    if( util > EDF_UTIL_MAX ) {
+        return( E_OVERLOAD );
+    }
+
+    _edf_util = util;
+    pcb->sclass = SCLASS_EDF;
+    pcb->rt_runtime = runtime;
+    pcb->rt_period = period;
+    pcb->rt_deadline = deadline;
+    pcb->jobs = pcb->misses = 0;
+
+    // the first job is released now
+    pcb->deadline = _system_time + deadline;
+    pcb->budget = runtime;
+
+    return( E_SUCCESS );
+}
+
+/**
+** _sched_preempting() - should the current process give way?
+**
+** @return true if an EDF task with an earlier deadline than the
+**         current process is ready, or if the current process is
+**         deferred work and something better is ready
+*/
+bool_t _sched_preempting( void ) {
+    key_t deadline;
+    int n;
+
+    if( _queue_kpeek(_edf,&deadline) != E_SUCCESS ) {
+        // a CPU running deferred work (e.g., its idle process) looks
+        // for work on every tick, as nobody else will tell it
+        return( _current->sclass == SCLASS_MLQ &&
+                _current->priority >= Deferred &&
+                (_sched_highest() < Deferred || _queue_length(_fair) > 0 ||
+                 _sched_victim(_cpu,&n) != NULL) );
+    }
+
+    return( _current->sclass != SCLASS_EDF ||
+            VR_BEFORE(deadline,_current->deadline) );
+}
+
+/**
+** _sched_release() - give up any scheduling class reservations
+**                    held by a terminating process
+**
+** @param pcb   The process
+*/
+void _sched_release( pcb_t *pcb ) {
+
+    // settle its CPU time now; the PCB may be gone by the
+    // time the next process is dispatched
+    for( uint32_t i = 0; i < _n_cpus; ++i ) {
+        if( pcb == _cpus[i].acct_pcb ) {
+            _sched_account( &_cpus[i], true );
+            _cpus[i].acct_pcb = NULL;
+        }
+    }
+
+    if( pcb->sclass == SCLASS_EDF ) {
+        _edf_util -= _edf_density( pcb->rt_runtime, pcb->rt_deadline );
+        pcb->sclass = SCLASS_MLQ;
+    }
+}
+
+/**
+** _sched_ready_bands() - total the lengths of a CPU's ready queues
+**                        by priority band
+**
+** @param cpu     The CPU
+** @param counts  The three band totals, which are added to
+*/
+void _sched_ready_bands( cpu_t *cpu, uint32_t counts[3] ) {
+
+    for( int level = 0; level < N_PRIOS; ++level ) {
+        counts[ level < User ? 0 : (level < Deferred ? 1 : 2) ] +=
+            _queue_length( cpu->ready[level] );
+    }
+}
+
+/**
+** _sched_edf_dump() - dump the EDF tasks to the console
+*/
+void _sched_edf_dump( void ) {
+
+    __cio_printf( "EDF: density %d.%02d%%, %d misses\n",
+                  _edf_util / 100, _edf_util % 100, _edf_misses );
+
+    for( uint32_t i = 0; i < _n_procs; ++i ) {
+        pcb_t *pcb = PTABLE( i );
+
+        if( pcb->sclass != SCLASS_EDF ) {
+            continue;
+        }
+
+        __cio_printf( " pid %d (%d,%d,%d) st %d dl %d bgt %d"
+                      " jobs %d misses %d\n",
+                      pcb->pid, pcb->rt_runtime, pcb->rt_period,
+                      pcb->rt_deadline, pcb->state, pcb->deadline,
+                      pcb->budget, pcb->jobs, pcb->misses );
+    }
+}
+
+/**
+** _sched_lat_dump() - dump the wakeup latency histograms to the console
+**
+** @param reset  Clear the histograms afterward?
+*/
+void _sched_lat_dump( bool_t reset ) {
+
+    __cio_puts( "Wakeup latency (TSC cycles, log2 buckets):\n" );
+
+    for( int i = 0; i < LAT_LEVELS; ++i ) {
+        uint32_t n = 0;
+        uint32_t lo = LAT_BUCKETS;
+        uint32_t hi = 0;
+
+        for( uint32_t b = 0; b < LAT_BUCKETS; ++b ) {
+            if( _lat_hist[i][b] != 0 ) {
+                n += _lat_hist[i][b];
+                lo = lo < b ? lo : b;
+                hi = b;
+            }
+        }
+
+        if( n == 0 ) {
+            continue;
+        }
+
+        if( i == LAT_EDF ) {
+            __cio_puts( "  EDF " );
+        } else if( i == LAT_FAIR ) {
+            __cio_puts( " fair " );
+        } else {
+            __cio_printf( " %4d ", i );
+        }
+        __cio_printf( "n %d:", n );
+
+        // the median and 99th percentile fall in these buckets
+        uint32_t sum = 0, p50 = lo, p99 = lo;
+        for( uint32_t b = lo; b <= hi; ++b ) {
+            sum += _lat_hist[i][b];
+            if( sum < (n + 1) / 2 ) {
+                p50 = b + 1;
+            }
+            if( sum < n - n / 100 ) {
+                p99 = b + 1;
+            }
+            if( _lat_hist[i][b] != 0 ) {
+                __cio_printf( " %d:%d", b, _lat_hist[i][b] );
+            }
+        }
+        __cio_printf( "  p50 <2^%d p99 <2^%d\n", p50 + 1, p99 + 1 );
+    }
+
+    if( reset ) {
+        __memclr( _lat_hist, sizeof(_lat_hist) );
+    }
+}
+
+/**
+** _sched_isr_enter() - CPU accounting at entry to an ISR
+**
+** Called by the ISR entry code; the time since the last ISR
+** returned was spent in user code.
+*/
+void _sched_isr_enter( void ) {
+    _sched_account( _cpu, false );
+}
+
+/**
+** _sched_isr_exit() - CPU accounting at exit from an ISR
+**
+** Called by the ISR exit code; the time since the ISR was entered
+** (or since the current process was dispatched) was spent in the
+** kernel.
+*/
+void _sched_isr_exit( void ) {
+    _sched_account( _cpu, true );
 }
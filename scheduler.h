@@ -17,6 +17,7 @@
 */
 
 #include "common.h"
+#include "smp.h"
 
 #ifndef SP_ASM_SRC
 
@@ -30,6 +31,40 @@
 // standard process quantum
 #define Q_DEFAULT       5
 
+// scheduling classes
+#define SCLASS_MLQ      0       // priority levels (MLQ or MLFQ policy)
+#define SCLASS_FAIR     1       // proportional share, by virtual runtime
+#define SCLASS_EDF      2       // real-time, earliest deadline first
+
+// EDF class admission limit:  the total density (runtime/deadline)
+// of the admitted tasks, in parts per EDF_UTIL_SCALE; the remainder
+// is left for everyone else
+#define EDF_UTIL_SCALE  10000
+#define EDF_UTIL_MAX    9000
+
+// fair class parameters:  each runnable fair process should get the
+// CPU once every FAIR_LATENCY ticks, for at least FAIR_MIN_SLICE ticks;
+// a tick of CPU time advances the virtual runtime of a process of the
+// default weight by FAIR_TICK
+#define FAIR_LATENCY    20
+#define FAIR_MIN_SLICE  1
+#define FAIR_TICK       1024
+
+// wakeup latency histograms:  one per priority level, plus one each
+// for the fair and EDF classes; bucket n counts latencies of 2^n
+// through 2^(n+1) - 1 TSC cycles (the last bucket also counts any
+// longer ones)
+#define LAT_FAIR        N_PRIOS
+#define LAT_EDF         (N_PRIOS + 1)
+#define LAT_LEVELS      (N_PRIOS + 2)
+#define LAT_BUCKETS     32
+
+// MLFQ parameters:  User processes move among MLFQ_LEVELS levels
+// starting at User, with the quantum doubling at each level down;
+// every MLFQ_BOOST ticks, everyone is returned to their base level
+#define MLFQ_LEVELS     4
+#define MLFQ_BOOST      1000
+
 /*
 ** Types
 */
@@ -38,11 +73,18 @@
 ** Globals
 */
 
-// the ready queue:  a MLQ with one level per priority value
-extern queue_t _ready[N_PRIOS];
+// the current user process on this CPU (each CPU has its own ready
+// queue, too; see smp.h)
+#define _current    (_cpu->current)
+
+// the scheduling policy in effect (see common.h)
+extern int _sched_policy;
 
-// the current user process
-extern pcb_t *_current;
+// the fair class run queue, ordered by virtual runtime
+extern queue_t _fair;
+
+// the EDF class run queue, ordered by absolute deadline
+extern queue_t _edf;
 
 /*
 ** Prototypes
@@ -59,22 +101,205 @@ extern pcb_t *_current;
 */
 void _sched_init( void );
 
+/**
+** _sched_cpu_init() - initialize a CPU's scheduler state
+**
+** Allocates its ready queues (the first time) and resets its
+** "current process" pointer
+**
+** @param cpu   The CPU
+*/
+void _sched_cpu_init( cpu_t *cpu );
+
 /**
 ** _schedule() - add a process to the ready queue
 **
-** Enques the supplied process according to its priority value
+** Enques the supplied process according to its priority value, on
+** the ready queue of the CPU it last ran on
 **
 ** @param pcb   The process to be scheduled
 */
 void _schedule( pcb_t *pcb );
 
+/**
+** _sched_highest() - find the highest-priority non-empty level of
+**                    this CPU's ready queue
+**
+** Uses a bitmap of non-empty levels, so the cost does not depend
+** on the number of priority levels.
+**
+** @return the priority level, or N_PRIOS if nothing is ready
+*/
+int _sched_highest( void );
+
 /**
 ** _dispatch() - select a new "current" process
 **
-** Selects the highest-priority process available
+** Selects the highest-priority process available.  When this CPU
+** has nothing above the Deferred level, it takes work from the
+** other CPUs' ready queues first.
 */
 void _dispatch( void );
 
+/**
+** _sched_preempt() - take the CPU away from the current process and
+**                    return it to the ready queue
+**
+** Under MLFQ, a process whose time slice has expired drops to the
+** next level down.  Counts as an involuntary context switch.
+**
+** @param pcb   The process
+*/
+void _sched_preempt( pcb_t *pcb );
+
+/**
+** _sched_block() - note that a process is giving up the CPU to wait
+**                  for something (sleep, or input)
+**
+** Under MLFQ, the process rises to the next level up.
+**
+** @param pcb   The process
+*/
+void _sched_block( pcb_t *pcb );
+
+/**
+** _sched_boost() - return every process to its base priority
+**
+** Deferred processes are aged into the lowest MLFQ level, so that
+** they get some CPU time even when User processes are always ready.
+*/
+void _sched_boost( void );
+
+/**
+** _sched_setpolicy() - select a scheduling policy
+**
+** @param policy  The new policy
+**
+** @return the previous policy, or E_BAD_PARAM
+*/
+int _sched_setpolicy( int policy );
+
+/**
+** _sched_idle() - is deferred work all there is to run?
+**
+** @return true if the current process and everything that is ready
+**         is at the Deferred level
+*/
+bool_t _sched_idle( void );
+
+/**
+** _sched_charge() - charge CPU time to a process
+**
+** @param pcb   The process
+** @param n     Number of ticks it has run
+*/
+void _sched_charge( pcb_t *pcb, uint32_t n );
+
+/**
+** _sched_unready() - take a Ready process off its run queue
+**
+** @param pcb   The process
+**
+** @return the process, or NULL if it wasn't on the queue
+*/
+pcb_t *_sched_unready( pcb_t *pcb );
+
+/**
+** _sched_setweight() - set the fair class weight of a process
+**
+** A non-zero weight puts the process in the fair class; a weight of
+** zero returns it to the priority levels.  The fair class runs when
+** nothing above the Deferred level is ready.
+**
+** @param pcb     The process
+** @param weight  The new weight
+**
+** @return the status of the change
+*/
+status_t _sched_setweight( pcb_t *pcb, uint32_t weight );
+
+/**
+** _sched_setdeadline() - set the EDF class parameters of a process
+**
+** Non-zero parameters put the process in the EDF class, if the
+** total density of the EDF tasks would stay within EDF_UTIL_MAX;
+** a runtime of zero returns it to the priority levels.  A deadline
+** of zero means the deadline is the period.  The EDF class runs
+** ahead of every priority level.
+**
+** @param pcb       The process (must be the current process)
+** @param runtime   CPU ticks needed by each job
+** @param period    Ticks between job releases
+** @param deadline  Ticks from release by which each job must finish
+**
+** @return the status of the change
+*/
+status_t _sched_setdeadline( pcb_t *pcb, uint32_t runtime,
+                             uint32_t period, uint32_t deadline );
+
+/**
+** _sched_preempting() - should the current process give way?
+**
+** @return true if an EDF task with an earlier deadline than the
+**         current process is ready, or if the current process is
+**         deferred work and something better is ready
+*/
+bool_t _sched_preempting( void );
+
+/**
+** _sched_release() - give up any scheduling class reservations
+**                    held by a terminating process
+**
+** @param pcb   The process
+*/
+void _sched_release( pcb_t *pcb );
+
+/**
+** _sched_ready_bands() - total the lengths of a CPU's ready queues
+**                        by priority band
+**
+** Levels System through User-1 are counted as System, User through
+** Deferred-1 (including MLFQ-demoted processes) as User, and Deferred
+** as Deferred.
+**
+** @param cpu     The CPU
+** @param counts  The three band totals, which are added to
+*/
+void _sched_ready_bands( cpu_t *cpu, uint32_t counts[3] );
+
+/**
+** _sched_edf_dump() - dump the EDF tasks to the console
+*/
+void _sched_edf_dump( void );
+
+/**
+** _sched_lat_dump() - dump the wakeup latency histograms to the console
+**
+** Latency is measured from when _schedule() makes a process Ready
+** after it has been away from the CPU (sleeping, blocked, waiting,
+** or new) to when _dispatch() makes it the current process.
+**
+** @param reset  Clear the histograms afterward?
+*/
+void _sched_lat_dump( bool_t reset );
+
+/**
+** _sched_isr_enter() - CPU accounting at entry to an ISR
+**
+** Called by the ISR entry code; the time since the last ISR
+** returned was spent in user code.
+*/
+void _sched_isr_enter( void );
+
+/**
+** _sched_isr_exit() - CPU accounting at exit from an ISR
+**
+** Called by the ISR exit code; the time since the ISR was entered
+** (or since the current process was dispatched) was spent in the
+** kernel.
+*/
+void _sched_isr_exit( void );
+
 #endif
 /* SP_ASM_SRC */
 
@@ -62,6 +62,8 @@
 #include "process.h"
 #include "scheduler.h"
 #include "kernel.h"
+#include "clock.h"
+#include "lock.h"
 
 #include "lib.h"
 
@@ -93,6 +95,10 @@ static int _sending;
     // interrupt register status
 static uint8_t _ier;
 
+    // protects the buffers and _sending; the ISR takes it too, so
+    // everything else takes it with interrupts disabled
+static lock_t _sio_lock;
+
 /*
 ** PUBLIC GLOBAL VARIABLES
 */
@@ -165,10 +171,14 @@ static void _sio_isr( int vector, int ecode ) {
                 assert( pcb );
 
                 // return char via arg #2 and count in EAX
-                char *buf = (char *) ARG(pcb,2);
-                *buf = ch & 0xff;
+                // (the buffer is in its address space, not ours)
+                char *buf = (char *) _vm_kaddr( pcb, (void *) ARG(pcb,2) );
+                if( buf != NULL ) {
+                    *buf = ch & 0xff;
+                }
                 RET(pcb) = 1;
                 SCHED( pcb );
+                _clk_rearm();
 
             } else {
 
@@ -177,10 +187,12 @@ static void _sio_isr( int vector, int ecode ) {
                 // if there is room, otherwise just ignore it.
                 //
 
+                _lock_acquire( &_sio_lock );
                 if( _incount < BUF_SIZE ) {
                     *_inlast++ = ch;
                     ++_incount;
                 }
+                _lock_release( &_sio_lock );
 
             }
             break;
@@ -196,6 +208,7 @@ static void _sio_isr( int vector, int ecode ) {
     __cio_puts( " TX" );
 #endif
             // if there is another character, send it
+            _lock_acquire( &_sio_lock );
             if( _sending && _outcount > 0 ) {
 #if TRACING_SIO_ISR
     __cio_printf( " ch %02x", *_outnext );
@@ -221,6 +234,7 @@ static void _sio_isr( int vector, int ecode ) {
                 // disable TX interrupts
                 _sio_disable( SIO_TX );
             }
+            _lock_release( &_sio_lock );
             break;
 
         case UA4_EIR_NO_INT:
@@ -266,6 +280,8 @@ void _sio_init( void ) {
     ** Initialize SIO variables.
     */
 
+    _lock_init( &_sio_lock, "sio", LOCK_SPIN );
+
     __memclr( (void *) _inbuffer, sizeof(_inbuffer) );
     _inlast = _innext = _inbuffer;
     _incount = 0;
@@ -450,6 +466,8 @@ int _sio_readc( void ) {
     // assume there is no character available
     ch = -1;
 
+    uint32_t flags = _lock_acquire_irq( &_sio_lock );
+
     // 
     // If there is a character, return it
     //
@@ -467,6 +485,8 @@ int _sio_readc( void ) {
 
     }
 
+    _lock_release_irq( &_sio_lock, flags );
+
     return( ch );
 
 }
@@ -490,7 +510,10 @@ int _sio_reads( char *buf, int length ) {
 
     // if there are no characters, just return 0
 
+    uint32_t flags = _lock_acquire_irq( &_sio_lock );
+
     if( _incount < 1 ) {
+        _lock_release_irq( &_sio_lock, flags );
         return( 0 );
     }
 
@@ -514,6 +537,8 @@ int _sio_reads( char *buf, int length ) {
         _inlast = _innext = _inbuffer;
     }
 
+    _lock_release_irq( &_sio_lock, flags );
+
     // return the copy count
 
     return( copied );
@@ -544,9 +569,12 @@ void _sio_writec( int ch ){
     // If we're currently transmitting, just add this to the buffer
     //
 
+    uint32_t flags = _lock_acquire_irq( &_sio_lock );
+
     if( _sending ) {
         *_outlast++ = ch;
         ++_outcount;
+        _lock_release_irq( &_sio_lock, flags );
         return;
     }
 
@@ -561,6 +589,8 @@ void _sio_writec( int ch ){
 
     _sio_enable( SIO_TX );
 
+    _lock_release_irq( &_sio_lock, flags );
+
 }
 
 /**
@@ -587,7 +617,10 @@ int _sio_write( const char *buffer, int length ) {
     // _sio_writec() to send the first one out.
     //
 
-    if( !_sending ) {
+    uint32_t flags = _lock_acquire_irq( &_sio_lock );
+    int sending = _sending;
+
+    if( !sending ) {
         ptr += 1;
         copied++;
     }
@@ -602,13 +635,16 @@ int _sio_write( const char *buffer, int length ) {
         ++copied;
     }
 
+    _lock_release_irq( &_sio_lock, flags );
+
     //
     // We use _sio_writec() to send out the first character,
     // as it will correctly set all the other necessary
-    // variables for us.
+    // variables for us.  (If we weren't sending, TX interrupts
+    // are off, so the ISR can't have started in the meantime.)
     //
 
-    if( !_sending ) {
+    if( !sending ) {
         _sio_writec( first );
     }
 
@@ -0,0 +1,545 @@
+/**
+** @file slab.c
+**
+** @author  CSCI-452 class of 20215
+**
+** Slab cache module implementation
+**
+** Also provides the general-purpose _kmalloc()/_kfree() allocator,
+** which is built from a set of power-of-two size class caches.
+*/
+
+#define SP_KERNEL_SRC
+
+#include "common.h"
+
+#include "slab.h"
+
+/*
+** PRIVATE DEFINITIONS
+*/
+
+// largest slab we will build, as a page allocator order
+
+#define SLAB_MAX_ORDER  3
+
+// slabs may waste at most 1/SLAB_WASTE of their space
+
+#define SLAB_WASTE      8
+
+// kmalloc size classes run from 2^KM_MIN_SHIFT to 2^KM_MAX_SHIFT bytes
+
+#define KM_MIN_SHIFT    4
+#define KM_MAX_SHIFT    11
+#define N_KM_CLASSES    (KM_MAX_SHIFT - KM_MIN_SHIFT + 1)
+
+// round 'x' up to a multiple of 'a' (which must be a power of two)
+
+#define ROUNDUP(x,a)    (((x) + (a) - 1) & ~((a) - 1))
+
+/*
+** PRIVATE DATA TYPES
+*/
+
+/*
+** Slab organization
+** -----------------
+** A slab is a block of 2^order contiguous pages.  The slab header
+** occupies the beginning of the first page; the objects follow it,
+** starting at the first suitably-aligned address.  Free objects are
+** kept on a singly-linked list threaded through their first word.
+**
+** Every page of a slab is tagged (via _km_page_set_owner()) with a
+** pointer to the slab header, so the slab containing any object can
+** be found without searching.
+*/
+
+typedef struct slab_s {
+    struct slab_s *next;        // next slab on this list
+    struct slab_s *prev;        // previous slab on this list
+    struct kmem_cache_s *cache; // cache this slab belongs to
+    void *free;                 // first free object
+    uint32_t inuse;             // number of allocated objects
+} slab_t;
+
+/*
+** A cache keeps its slabs on three lists according to how many
+** of their objects are in use:  none (empty), some (partial), or
+** all (full).  Allocation prefers partial slabs, to keep the number
+** of slabs low.
+*/
+
+struct kmem_cache_s {
+    const char *name;           // NULL if this entry is unused
+    uint32_t size;              // requested object size
+    uint32_t objsize;           // object size, including padding
+    uint32_t align;             // object alignment
+    void (*ctor)( void * );     // object initializer
+    uint32_t order;             // slab size, as a page allocator order
+    uint32_t offset;            // offset of the first object in a slab
+    uint32_t per_slab;          // number of objects per slab
+    uint32_t slab_waste;        // bytes per slab not usable by objects
+    slab_t *partial;            // slabs with some objects allocated
+    slab_t *full;               // slabs with all objects allocated
+    slab_t *empty;              // slabs with no objects allocated
+    uint32_t n_slabs;           // total number of slabs
+    uint32_t n_empty;           // number of slabs on the empty list
+    uint32_t in_use;            // number of objects allocated
+    uint32_t allocs;            // successful allocations
+    uint32_t frees;             // deallocations
+    uint32_t fails;             // failed allocations
+};
+
+/*
+** PRIVATE GLOBAL VARIABLES
+*/
+
+// all the caches in the system
+static struct kmem_cache_s _caches[N_CACHES];
+
+// the kmalloc size class caches, smallest first
+static kmem_cache_t _km_classes[N_KM_CLASSES];
+
+static const char *_km_class_names[N_KM_CLASSES] = {
+    "kmalloc-16", "kmalloc-32", "kmalloc-64", "kmalloc-128",
+    "kmalloc-256", "kmalloc-512", "kmalloc-1k", "kmalloc-2k"
+};
+
+// number of emptied slabs given back to the page allocator
+static uint32_t _slab_reclaims;
+
+/*
+** PUBLIC GLOBAL VARIABLES
+*/
+
+/*
+** PRIVATE FUNCTIONS
+*/
+
+/**
+** _slab_list() - find the list a slab belongs on
+**
+** @param cache  The cache
+** @param inuse  Number of objects allocated from the slab
+**
+** @return a pointer to the head of the appropriate list
+*/
+static slab_t **_slab_list( kmem_cache_t cache, uint32_t inuse ) {
+
+    if( inuse == 0 ) {
+        return( &cache->empty );
+    }
+
+    if( inuse == cache->per_slab ) {
+        return( &cache->full );
+    }
+
+    return( &cache->partial );
+}
+
+/**
+** _slab_link() - add a slab to the front of a list
+**
+** @param list  The list
+** @param slab  The slab to be added
+*/
+static void _slab_link( slab_t **list, slab_t *slab ) {
+
+    slab->prev = NULL;
+    slab->next = *list;
+    if( slab->next != NULL ) {
+        slab->next->prev = slab;
+    }
+    *list = slab;
+}
+
+/**
+** _slab_unlink() - remove a slab from a list
+**
+** @param list  The list
+** @param slab  The slab to be removed
+*/
+static void _slab_unlink( slab_t **list, slab_t *slab ) {
+
+    if( slab->prev == NULL ) {
+        *list = slab->next;
+    } else {
+        slab->prev->next = slab->next;
+    }
+    if( slab->next != NULL ) {
+        slab->next->prev = slab->prev;
+    }
+    slab->next = slab->prev = NULL;
+}
+
+/**
+** _slab_grow() - add an empty slab to a cache
+**
+** @param cache  The cache to be expanded
+**
+** @return the new slab, or NULL if no memory was available
+*/
+static slab_t *_slab_grow( kmem_cache_t cache ) {
+    uint32_t pages = 1 << cache->order;
+
+    slab_t *slab = (slab_t *) _km_page_alloc( pages );
+    if( slab == NULL ) {
+        return( NULL );
+    }
+
+    // let _kmem_cache_free() find this slab from any of its objects
+    _km_page_set_owner( slab, pages, slab );
+
+    slab->cache = cache;
+    slab->inuse = 0;
+
+    // thread the free list through the objects, in address order
+    uint8_t *obj = ((uint8_t *) slab) + cache->offset;
+    slab->free = obj;
+    for( uint32_t i = 1; i < cache->per_slab; ++i ) {
+        *(void **) obj = obj + cache->objsize;
+        obj += cache->objsize;
+    }
+    *(void **) obj = NULL;
+
+    _slab_link( &cache->empty, slab );
+    cache->n_slabs += 1;
+    cache->n_empty += 1;
+
+    return( slab );
+}
+
+/*
+** PUBLIC FUNCTIONS
+*/
+
+/**
+** _kmem_cache_init() - initialize the slab cache module
+**
+** Dependencies:
+**    Cannot be called before kmem is initialized
+**    Must be called before any cache is created
+*/
+void _kmem_cache_init( void ) {
+
+    __cio_puts( " Slab:" );
+
+    __memclr( _caches, sizeof(_caches) );
+
+    // create the kmalloc size classes
+    for( int i = 0; i < N_KM_CLASSES; ++i ) {
+        _km_classes[i] = _kmem_cache_create( _km_class_names[i],
+                1 << (KM_MIN_SHIFT + i), KM_CACHE_LINE, NULL );
+        assert( _km_classes[i] != NULL );
+    }
+
+    __cio_puts( " done" );
+}
+
+/**
+** _kmem_cache_create() - create a new object cache
+**
+** Objects are placed on 'align'-byte boundaries; an alignment of
+** KM_CACHE_LINE keeps objects from sharing cache lines, except that
+** objects no larger than half a line are packed at smaller power-of-two
+** boundaries rather than being padded out to a full line.
+**
+** @param name   Name of the cache (for statistics reports)
+** @param size   Size of each object, in bytes
+** @param align  Required alignment (a power of two), or 0 for a word
+** @param ctor   Function to initialize a newly-allocated object, or NULL
+**
+** @return the new cache, or NULL on failure
+*/
+kmem_cache_t _kmem_cache_create( const char *name, uint32_t size,
+                                 uint32_t align, void (*ctor)(void *) ) {
+    kmem_cache_t cache = NULL;
+
+    assert1( name != NULL );
+    assert1( size > 0 );
+    assert1( (align & (align - 1)) == 0 );
+
+    // find a free entry in the cache table
+    for( int i = 0; i < N_CACHES; ++i ) {
+        if( _caches[i].name == NULL ) {
+            cache = &_caches[i];
+            break;
+        }
+    }
+
+    if( cache == NULL ) {
+        WARNING( "out of cache descriptors" );
+        return( NULL );
+    }
+
+    // every object must be able to hold a free list link
+    if( size < sizeof(void *) ) {
+        size = sizeof(void *);
+    }
+
+    // figure out the actual alignment
+    if( align == 0 ) {
+        align = sizeof(void *);
+    } else if( align == KM_CACHE_LINE ) {
+        // small objects share lines, but never straddle them
+        while( align > sizeof(void *) && size <= align / 2 ) {
+            align >>= 1;
+        }
+    }
+
+    uint32_t objsize = ROUNDUP( size, align );
+    uint32_t offset = ROUNDUP( sizeof(slab_t), align );
+
+    // pick the smallest slab that doesn't waste too much space
+    uint32_t order, per_slab, waste;
+    for( order = 0; ; ++order ) {
+        uint32_t bytes = SZ_PAGE << order;
+
+        per_slab = bytes > offset ? (bytes - offset) / objsize : 0;
+        waste = bytes - per_slab * objsize;
+
+        if( order >= SLAB_MAX_ORDER ||
+                (per_slab > 0 && waste * SLAB_WASTE <= bytes) ) {
+            break;
+        }
+    }
+
+    if( per_slab == 0 ) {
+        WARNING( "object too large for a slab" );
+        return( NULL );
+    }
+
+    __memclr( cache, sizeof(*cache) );
+    cache->name = name;
+    cache->size = size;
+    cache->objsize = objsize;
+    cache->align = align;
+    cache->ctor = ctor;
+    cache->order = order;
+    cache->offset = offset;
+    cache->per_slab = per_slab;
+    cache->slab_waste = waste;
+
+    return( cache );
+}
+
+/**
+** _kmem_cache_alloc() - allocate an object from a cache
+**
+** @param cache  The cache to allocate from
+**
+** @return a pointer to the object, or NULL if no memory is available
+*/
+void *_kmem_cache_alloc( kmem_cache_t cache ) {
+    slab_t *slab;
+
+    assert1( cache != NULL );
+
+    // prefer partially-used slabs; fall back to empty ones
+    slab = cache->partial;
+    if( slab == NULL ) {
+        slab = cache->empty;
+        if( slab == NULL ) {
+            slab = _slab_grow( cache );
+            if( slab == NULL ) {
+                cache->fails += 1;
+                return( NULL );
+            }
+        }
+    }
+
+    // take the first free object
+    void *obj = slab->free;
+    assert1( obj != NULL );
+
+    _slab_unlink( _slab_list(cache, slab->inuse), slab );
+    if( slab->inuse == 0 ) {
+        cache->n_empty -= 1;
+    }
+
+    slab->free = *(void **) obj;
+    slab->inuse += 1;
+
+    _slab_link( _slab_list(cache, slab->inuse), slab );
+
+    cache->in_use += 1;
+    cache->allocs += 1;
+
+    if( cache->ctor != NULL ) {
+        cache->ctor( obj );
+    }
+
+    return( obj );
+}
+
+/**
+** _kmem_cache_free() - return an object to its cache
+**
+** If this leaves its slab empty and the cache already has an
+** empty slab in reserve, the slab is returned to the page allocator.
+**
+** @param cache  The cache the object was allocated from
+** @param obj    The object to be freed
+*/
+void _kmem_cache_free( kmem_cache_t cache, void *obj ) {
+
+    assert1( cache != NULL );
+
+    if( obj == NULL ) {
+        return;
+    }
+
+    slab_t *slab = (slab_t *) _km_page_owner( obj );
+    assert( slab != NULL && slab->cache == cache );
+    assert1( slab->inuse > 0 );
+
+    _slab_unlink( _slab_list(cache, slab->inuse), slab );
+
+    *(void **) obj = slab->free;
+    slab->free = obj;
+    slab->inuse -= 1;
+
+    cache->in_use -= 1;
+    cache->frees += 1;
+
+    if( slab->inuse > 0 ) {
+        _slab_link( _slab_list(cache, slab->inuse), slab );
+        return;
+    }
+
+    // keep one empty slab around to absorb alloc/free flutter
+    if( cache->n_empty == 0 ) {
+        _slab_link( &cache->empty, slab );
+        cache->n_empty += 1;
+        return;
+    }
+
+    cache->n_slabs -= 1;
+    _slab_reclaims += 1;
+    _km_page_free( slab );
+}
+
+/**
+** _kmalloc() - allocate a block of memory of arbitrary size
+**
+** Requests of up to 2^KM_MAX_SHIFT bytes are satisfied from the
+** smallest size class that can hold them; larger requests are given
+** whole pages.  No header is attached to the block; _kfree() finds
+** the block's size through the page allocator.
+**
+** @param size  Number of bytes desired
+**
+** @return a pointer to the block, or NULL if no memory is available
+*/
+void *_kmalloc( uint32_t size ) {
+
+    if( size == 0 ) {
+        return( NULL );
+    }
+
+    // large requests go straight to the page allocator
+    if( size > (1 << KM_MAX_SHIFT) ) {
+        return( _km_page_alloc((size + SZ_PAGE - 1) / SZ_PAGE) );
+    }
+
+    // find the smallest class that will hold it
+    int i = 0;
+    while( (1 << (KM_MIN_SHIFT + i)) < size ) {
+        ++i;
+    }
+
+    return( _kmem_cache_alloc(_km_classes[i]) );
+}
+
+/**
+** _kzalloc() - allocate a block of zeroed memory of arbitrary size
+**
+** Page-sized requests are satisfied from the pre-zeroed page pool
+** when possible, so the caller doesn't pay for clearing them.
+**
+** @param size  Number of bytes desired
+**
+** @return a pointer to the block, or NULL if no memory is available
+*/
+void *_kzalloc( uint32_t size ) {
+
+    if( size > (1 << KM_MAX_SHIFT) ) {
+        return( _km_page_alloc_zero((size + SZ_PAGE - 1) / SZ_PAGE) );
+    }
+
+    void *ptr = _kmalloc( size );
+    if( ptr != NULL ) {
+        __memclr( ptr, size );
+    }
+
+    return( ptr );
+}
+
+/**
+** _kfree() - release a block obtained from _kmalloc()
+**
+** @param ptr  The block to be freed
+*/
+void _kfree( void *ptr ) {
+
+    if( ptr == NULL ) {
+        return;
+    }
+
+    // slab objects have their pages tagged with the owning slab
+    slab_t *slab = (slab_t *) _km_page_owner( ptr );
+
+    if( slab != NULL ) {
+        _kmem_cache_free( slab->cache, ptr );
+    } else {
+        _km_page_free( ptr );
+    }
+}
+
+/**
+** _kmem_cache_stats() - fill in the slab cache part of a kmstat_t
+**
+** @param st  The structure to be filled in
+*/
+void _kmem_cache_stats( kmstat_t *st ) {
+
+    st->slab_pages = st->slab_empty = 0;
+    for( int i = 0; i < N_CACHES; ++i ) {
+        kmem_cache_t c = &_caches[i];
+
+        if( c->name != NULL ) {
+            st->slab_pages += c->n_slabs << c->order;
+            st->slab_empty += c->n_empty << c->order;
+        }
+    }
+    st->slab_reclaims = _slab_reclaims;
+}
+
+/**
+** _kmem_cache_dump() - print statistics for all caches
+**
+** Waste counts the slab headers and leftover space at the end
+** of each slab, plus the padding in each allocated object.
+*/
+void _kmem_cache_dump( void ) {
+
+    __cio_puts( "\ncache        size obj  inuse/total slabs(empty) pages  waste\n" );
+
+    for( int i = 0; i < N_CACHES; ++i ) {
+        kmem_cache_t c = &_caches[i];
+
+        if( c->name == NULL ) {
+            continue;
+        }
+
+        uint32_t waste = c->n_slabs * c->slab_waste +
+                         c->in_use * (c->objsize - c->size);
+
+        __cio_printf( "%-11s %5d %4d %5d/%-5d %5d(%d) %5d %6d\n",
+                      c->name, c->size, c->objsize, c->in_use,
+                      c->n_slabs * c->per_slab, c->n_slabs, c->n_empty,
+                      c->n_slabs << c->order, waste );
+    }
+
+    __cio_printf( "%d empty slabs given back\n", _slab_reclaims );
+}
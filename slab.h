@@ -0,0 +1,146 @@
+/*
+** @file slab.h
+**
+** @author CSCI-452 class of 20215
+**
+** Slab cache module declarations
+**
+** A slab cache hands out fixed-size objects carved from blocks
+** of pages ("slabs") obtained from the page allocator.  Each cache
+** keeps its slabs on partial, full, and empty lists; slabs that
+** become empty are returned to the page allocator.
+**
+** _kmalloc() and _kfree() provide variable-sized allocation on top
+** of a set of power-of-two size class caches.
+*/
+
+#ifndef SLAB_H_
+#define SLAB_H_
+
+/*
+** General (C and/or assembly) definitions
+*/
+
+#include "common.h"
+
+#include "kmem.h"
+
+// size of a processor cache line, in bytes
+
+#define KM_CACHE_LINE   64
+
+// maximum number of caches in the system (including the
+// kmalloc size classes)
+
+#define N_CACHES        24
+
+#ifndef SP_ASM_SRC
+
+/*
+** Start of C-only definitions
+*/
+
+/*
+** Types
+*/
+
+// the cache itself is opaque to the rest of the system
+
+typedef struct kmem_cache_s *kmem_cache_t;
+
+/*
+** Globals
+*/
+
+/*
+** Prototypes
+*/
+
+/**
+** _kmem_cache_init() - initialize the slab cache module
+**
+** Dependencies:
+**    Cannot be called before kmem is initialized
+**    Must be called before any cache is created
+*/
+void _kmem_cache_init( void );
+
+/**
+** _kmem_cache_create() - create a new object cache
+**
+** Objects are placed on 'align'-byte boundaries; an alignment of
+** KM_CACHE_LINE keeps objects from sharing cache lines, except that
+** objects no larger than half a line are packed at smaller power-of-two
+** boundaries rather than being padded out to a full line.
+**
+** @param name   Name of the cache (for statistics reports)
+** @param size   Size of each object, in bytes
+** @param align  Required alignment (a power of two), or 0 for a word
+** @param ctor   Function to initialize a newly-allocated object, or NULL
+**
+** @return the new cache, or NULL on failure
+*/
+kmem_cache_t _kmem_cache_create( const char *name, uint32_t size,
+                                 uint32_t align, void (*ctor)(void *) );
+
+/**
+** _kmem_cache_alloc() - allocate an object from a cache
+**
+** @param cache  The cache to allocate from
+**
+** @return a pointer to the object, or NULL if no memory is available
+*/
+void *_kmem_cache_alloc( kmem_cache_t cache );
+
+/**
+** _kmem_cache_free() - return an object to its cache
+**
+** @param cache  The cache the object was allocated from
+** @param obj    The object to be freed
+*/
+void _kmem_cache_free( kmem_cache_t cache, void *obj );
+
+/**
+** _kmalloc() - allocate a block of memory of arbitrary size
+**
+** Requests of up to 2KB are satisfied from power-of-two size class
+** caches (16 bytes and up); larger requests are given whole pages.
+**
+** @param size  Number of bytes desired
+**
+** @return a pointer to the block, or NULL if no memory is available
+*/
+void *_kmalloc( uint32_t size );
+
+/**
+** _kzalloc() - allocate a block of zeroed memory of arbitrary size
+**
+** @param size  Number of bytes desired
+**
+** @return a pointer to the block, or NULL if no memory is available
+*/
+void *_kzalloc( uint32_t size );
+
+/**
+** _kfree() - release a block obtained from _kmalloc() or _kzalloc()
+**
+** @param ptr  The block to be freed
+*/
+void _kfree( void *ptr );
+
+/**
+** _kmem_cache_stats() - fill in the slab cache part of a kmstat_t
+**
+** @param st  The structure to be filled in
+*/
+void _kmem_cache_stats( kmstat_t *st );
+
+/**
+** _kmem_cache_dump() - print statistics for all caches
+*/
+void _kmem_cache_dump( void );
+
+#endif
+/* SP_ASM_SRC */
+
+#endif
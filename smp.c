@@ -0,0 +1,730 @@
+/**
+** @file smp.c
+**
+** @author CSCI-452 class of 20215
+**
+** Multiprocessor support implementation
+*/
+
+#define SP_KERNEL_SRC
+
+#include "common.h"
+
+#include "x86arch.h"
+#include "x86pit.h"
+#include "bootstrap.h"
+
+#include "clock.h"
+#include "process.h"
+#include "scheduler.h"
+#include "lock.h"
+#include "smp.h"
+#include "offsets.h"
+
+/*
+** PRIVATE DEFINITIONS
+*/
+
+// the ISR code and smpboot.S reach into cpu_t using offsets.h; make
+// sure its layout there (from -mx32) matches ours (see lock.h)
+
+typedef char _cpu_layout_check[ sizeof(cpu_t) == CPU_SIZE ? 1 : -1 ];
+
+// local APIC registers (byte offsets from the APIC base address)
+#define LAPIC_ID            0x020
+#define LAPIC_TPR           0x080   // task priority
+#define LAPIC_EOI           0x0b0
+#define LAPIC_SVR           0x0f0   // spurious interrupt vector
+#define LAPIC_ICR_LO        0x300   // interrupt command
+#define LAPIC_ICR_HI        0x310
+#define LAPIC_LVT_TIMER     0x320
+#define LAPIC_TICR          0x380   // timer initial count
+#define LAPIC_TCCR          0x390   // timer current count
+#define LAPIC_TDCR          0x3e0   // timer divide configuration
+
+// register contents
+#define SVR_ENABLE          0x00000100
+#define ICR_INIT            0x00004500  // INIT, level assert
+#define ICR_STARTUP         0x00004600  // startup IPI (| start page)
+#define ICR_PENDING         0x00001000  // delivery status
+#define LVT_MASKED          0x00010000
+#define LVT_PERIODIC        0x00020000
+#define TDCR_DIV_16         0x00000003
+
+// PIT channel 2 is gated through port B of the keyboard controller
+#define PORT_B              0x61
+#define PORT_B_GATE2        0x01
+#define PORT_B_SPEAKER      0x02
+#define PORT_B_OUT2         0x20
+
+// length of the LAPIC timer calibration
+#define CALIBRATE_MS        10
+
+// table signatures, as little-endian words
+#define SIG_MP              0x5f504d5f  // "_MP_"
+#define SIG_PCMP            0x504d4350  // "PCMP"
+#define SIG_RSD             0x20445352  // "RSD "
+#define SIG_PTR             0x20525450  // "PTR "
+#define SIG_APIC            0x43495041  // "APIC"
+
+// where the BIOS leaves the tables:  the first KB of the extended BIOS
+// data area, the last KB of base memory, or the BIOS ROM
+#define BDA_EBDA_SEG        0x0000040e  // EBDA segment number
+#define BDA_BASE_KB         0x00000413  // KB of base memory
+#define BIOS_ROM            0x000e0000
+#define BIOS_ROM_LEN        0x00020000
+
+// MP configuration table entries
+#define MP_PROC             0           // entry type:  a processor
+#define MP_ENTRY_LEN        8           // length of all the others
+#define MP_CPU_ENABLED      0x01
+
+// ACPI MADT entries
+#define MADT_LAPIC          0           // entry type:  a local APIC
+#define MADT_CPU_ENABLED    0x01
+
+// descriptor access bytes and flags
+#define DESC_DATA           0x92        // present, ring 0, R/W data
+#define DESC_TSS            0x89        // present, ring 0, 32-bit TSS
+#define DESC_32BIT          0x04        // 32-bit, byte granularity
+
+/*
+** PRIVATE DATA TYPES
+*/
+
+// MP floating pointer structure
+typedef struct mp_fp_s {
+    uint32_t signature;     // "_MP_"
+    uint32_t config;        // address of the configuration table
+    uint8_t length;         // in 16-byte units
+    uint8_t revision;
+    uint8_t checksum;
+    uint8_t features[5];    // features[0] != 0:  a default configuration
+} mp_fp_t;
+
+// MP configuration table header
+typedef struct mp_conf_s {
+    uint32_t signature;     // "PCMP"
+    uint16_t length;        // of the base table, including this header
+    uint8_t revision;
+    uint8_t checksum;
+    char oem[8];
+    char product[12];
+    uint32_t oem_table;
+    uint16_t oem_length;
+    uint16_t entries;       // number of entries following the header
+    uint32_t lapic;         // local APIC address
+    uint16_t ext_length;
+    uint8_t ext_checksum;
+    uint8_t reserved;
+} mp_conf_t;
+
+// MP processor entry
+typedef struct mp_proc_s {
+    uint8_t type;           // MP_PROC
+    uint8_t apic_id;
+    uint8_t apic_version;
+    uint8_t flags;
+    uint32_t signature;
+    uint32_t features;
+    uint32_t reserved[2];
+} mp_proc_t;
+
+// ACPI root system description pointer (the version 1 part)
+typedef struct acpi_rsdp_s {
+    uint32_t signature[2];  // "RSD PTR "
+    uint8_t checksum;
+    char oem[6];
+    uint8_t revision;
+    uint32_t rsdt;          // address of the RSDT
+} acpi_rsdp_t;
+
+// ACPI system description table header
+typedef struct acpi_sdt_s {
+    uint32_t signature;
+    uint32_t length;        // of the whole table
+    uint8_t revision;
+    uint8_t checksum;
+    char oem[6];
+    char oem_table[8];
+    uint32_t oem_revision;
+    uint32_t creator;
+    uint32_t creator_revision;
+} acpi_sdt_t;
+
+// ACPI multiple APIC description table; variable-length entries follow
+typedef struct acpi_madt_s {
+    acpi_sdt_t header;      // "APIC"
+    uint32_t lapic;         // local APIC address
+    uint32_t flags;
+} acpi_madt_t;
+
+// MADT local APIC entry
+typedef struct madt_lapic_s {
+    uint8_t type;           // MADT_LAPIC
+    uint8_t length;
+    uint8_t acpi_id;
+    uint8_t apic_id;
+    uint32_t flags;
+} madt_lapic_t;
+
+/*
+** PRIVATE GLOBAL VARIABLES
+*/
+
+// the local APIC registers (NULL until we have found them)
+static volatile uint32_t *_lapic;
+
+// LAPIC timer counts per ms (with the divisor set to 16)
+static uint32_t _lapic_per_ms;
+
+// APIC IDs of the enabled CPUs listed in the tables
+static uint8_t _apic_ids[N_CPUS];
+static uint32_t _n_found;
+
+// the kernel lock; a ticket lock, so that a CPU which keeps taking
+// interrupts can't keep the others out
+static lock_t _kernel_lock;
+
+/*
+** PUBLIC GLOBAL VARIABLES
+*/
+
+// per-CPU data; [0] is the BSP, and the first _n_cpus are running
+cpu_t _cpus[N_CPUS];
+uint32_t _n_cpus;
+
+// the AP being started
+cpu_t *_smp_booting;
+
+/*
+** PRIVATE FUNCTIONS
+*/
+
+// the AP startup code (see smpboot.S)
+extern char __smp_tramp[], __smp_tramp_end[];
+
+/**
+** _lapic_read(), _lapic_write() - access a local APIC register
+*/
+static uint32_t _lapic_read( uint32_t reg ) {
+    return( _lapic[reg >> 2] );
+}
+
+static void _lapic_write( uint32_t reg, uint32_t value ) {
+    _lapic[reg >> 2] = value;
+}
+
+/**
+** _lapic_delay() - busy-wait, using the LAPIC timer
+**
+** Only the BSP uses this, while its own timer is otherwise unused.
+**
+** @param us    Microseconds to wait
+*/
+static void _lapic_delay( uint32_t us ) {
+
+    _lapic_write( LAPIC_LVT_TIMER, LVT_MASKED | INT_VEC_LAPIC_TIMER );
+    _lapic_write( LAPIC_TICR, (_lapic_per_ms * us) / 1000 + 1 );
+    while( _lapic_read(LAPIC_TCCR) != 0 ) {
+        __cpu_relax();
+    }
+}
+
+/**
+** _lapic_calibrate() - measure the LAPIC timer rate against the PIT
+**
+** Runs PIT channel 2 for CALIBRATE_MS as a one-shot (channel 0
+** belongs to the clock module), and sees how far the LAPIC timer
+** counts down meanwhile.
+**
+** @return the number of counts per ms
+*/
+static uint32_t _lapic_calibrate( void ) {
+    uint32_t cycles = (TIMER_FREQUENCY * CALIBRATE_MS) / 1000;
+
+    // gate channel 2 on, with the speaker off
+    __outb( PORT_B, (__inb(PORT_B) & ~PORT_B_SPEAKER) | PORT_B_GATE2 );
+
+    // interrupt on terminal count; the count starts when the MSB is
+    // written, so start the LAPIC timer right after that
+    __outb( TIMER_CONTROL_PORT, TIMER_2_SELECT | TIMER_2_READ |
+                                TIMER_MODE_0 );
+    __outb( TIMER_2_PORT, cycles & 0xff );
+    _lapic_write( LAPIC_TDCR, TDCR_DIV_16 );
+    _lapic_write( LAPIC_LVT_TIMER, LVT_MASKED | INT_VEC_LAPIC_TIMER );
+    __outb( TIMER_2_PORT, (cycles >> 8) & 0xff );
+    _lapic_write( LAPIC_TICR, 0xffffffff );
+
+    while( (__inb(PORT_B) & PORT_B_OUT2) == 0 ) {
+        ;
+    }
+
+    uint32_t counts = 0xffffffff - _lapic_read( LAPIC_TCCR );
+    _lapic_write( LAPIC_TICR, 0 );
+
+    return( counts / CALIBRATE_MS );
+}
+
+/**
+** _lapic_ipi() - send an interprocessor interrupt, and wait for
+**                it to be delivered
+**
+** @param apic_id   The destination
+** @param command   Low word of the interrupt command
+*/
+static void _lapic_ipi( uint8_t apic_id, uint32_t command ) {
+
+    _lapic_write( LAPIC_ICR_HI, ((uint32_t) apic_id) << 24 );
+    _lapic_write( LAPIC_ICR_LO, command );
+    while( _lapic_read(LAPIC_ICR_LO) & ICR_PENDING ) {
+        __cpu_relax();
+    }
+}
+
+/**
+** _smp_timer_isr() - ISR for the LAPIC timers of the APs
+**
+** The BSP's clock ISR keeps the time and wakes up sleepers; each AP
+** just charges and time-slices its own current process.
+**
+** @param vector    Vector number for the interrupt
+** @param code      Error code (0 for this interrupt)
+*/
+static void _smp_timer_isr( int vector, int code ) {
+
+    ++_cpu->ticks;
+    _clk_slice( 1 );
+
+    _lapic_write( LAPIC_EOI, 0 );
+}
+
+/**
+** _smp_spurious_isr() - ISR for spurious LAPIC interrupts
+**
+** These must not be acknowledged.
+*/
+static void _smp_spurious_isr( int vector, int code ) {
+    ;
+}
+
+/**
+** _smp_idle() - the idle process for each CPU
+**
+** Halts until the next interrupt, forever.  Each CPU has its own,
+** at the Deferred level; Deferred work is never taken by another
+** CPU, so each CPU always has something to run.
+*/
+static int32_t _smp_idle( int argc, char *argv[] ) {
+
+    for(;;) {
+        __pause();
+    }
+
+    return( 42 );  // shut the compiler up!
+}
+
+/**
+** _smp_idle_create() - create the idle process for this CPU
+*/
+static void _smp_idle_create( void ) {
+    char *args[2] = { "cpuidle", NULL };
+
+    pcb_t *pcb = _pcb_alloc();
+    assert( pcb != NULL );
+
+    pcb->stack = _stk_alloc();
+    assert( pcb->stack != NULL );
+
+    status_t status = _vm_create( pcb );
+    assert( status == E_SUCCESS );
+
+    pcb->pid = _pid_alloc();
+    pcb->ppid = PID_INIT;
+    _pcb_set_state( pcb, New );
+    pcb->quantum = Q_DEFAULT;
+    pcb->priority = pcb->base = Deferred;
+
+    pcb->context = _stk_setup( pcb->stack, (uint32_t) _smp_idle, args );
+    assert( pcb->context != NULL );
+
+    status = _ptable_add( pcb );
+    assert( status == E_SUCCESS );
+
+    // a new process goes on the queue of the CPU that creates it
+    _cpu->idle = pcb;
+    _schedule( pcb );
+}
+
+/**
+** _smp_sum() - byte-wise checksum of a table
+**
+** @return the sum, which is zero for a valid table
+*/
+static uint8_t _smp_sum( const void *table, uint32_t length ) {
+    const uint8_t *p = (const uint8_t *) table;
+    uint8_t sum = 0;
+
+    while( length-- > 0 ) {
+        sum += *p++;
+    }
+
+    return( sum );
+}
+
+/**
+** _smp_scan() - look for a structure on a 16-byte boundary
+**
+** @param base  Where to start looking
+** @param len   How many bytes to look through
+** @param sig   The first word of the signature
+** @param sig2  The second word of the signature (0 for none)
+** @param size  Number of bytes covered by its checksum
+**
+** @return the structure, or NULL
+*/
+static void *_smp_scan( uint32_t base, uint32_t len, uint32_t sig,
+                        uint32_t sig2, uint32_t size ) {
+
+    for( uint32_t a = base; a + size <= base + len; a += 16 ) {
+        uint32_t *p = (uint32_t *) a;
+        if( p[0] == sig && (sig2 == 0 || p[1] == sig2) &&
+                _smp_sum(p,size) == 0 ) {
+            return( (void *) p );
+        }
+    }
+
+    return( NULL );
+}
+
+/**
+** _smp_search() - look for a structure wherever the BIOS may put it
+*/
+static void *_smp_search( uint32_t sig, uint32_t sig2, uint32_t size ) {
+    uint32_t ebda = ((uint32_t) *((uint16_t *) BDA_EBDA_SEG)) << 4;
+    uint32_t top = ((uint32_t) *((uint16_t *) BDA_BASE_KB)) << 10;
+    void *p = NULL;
+
+    if( ebda != 0 ) {
+        p = _smp_scan( ebda, 1024, sig, sig2, size );
+    }
+    if( p == NULL && top >= 1024 ) {
+        p = _smp_scan( top - 1024, 1024, sig, sig2, size );
+    }
+    if( p == NULL ) {
+        p = _smp_scan( BIOS_ROM, BIOS_ROM_LEN, sig, sig2, size );
+    }
+
+    return( p );
+}
+
+/**
+** _smp_found() - note a CPU listed in the tables
+*/
+static void _smp_found( uint8_t apic_id ) {
+
+    if( _n_found < N_CPUS ) {
+        _apic_ids[_n_found++] = apic_id;
+    }
+}
+
+/**
+** _smp_madt() - list the CPUs in the ACPI MADT
+**
+** @return the local APIC address, or 0 if there is no MADT
+*/
+static uint32_t _smp_madt( void ) {
+
+    acpi_rsdp_t *rsdp = _smp_search( SIG_RSD, SIG_PTR, sizeof(acpi_rsdp_t) );
+    if( rsdp == NULL ) {
+        return( 0 );
+    }
+
+    acpi_sdt_t *rsdt = (acpi_sdt_t *) rsdp->rsdt;
+    if( rsdt == NULL || _smp_sum(rsdt,rsdt->length) != 0 ) {
+        return( 0 );
+    }
+
+    uint32_t *tables = (uint32_t *) (rsdt + 1);
+    uint32_t n = (rsdt->length - sizeof(acpi_sdt_t)) / sizeof(uint32_t);
+
+    for( uint32_t i = 0; i < n; ++i ) {
+        acpi_madt_t *madt = (acpi_madt_t *) tables[i];
+
+        if( madt->header.signature != SIG_APIC ||
+                _smp_sum(madt,madt->header.length) != 0 ) {
+            continue;
+        }
+
+        uint8_t *p = (uint8_t *) (madt + 1);
+        uint8_t *end = ((uint8_t *) madt) + madt->header.length;
+
+        while( p + 2 <= end && p[1] >= 2 ) {
+            madt_lapic_t *e = (madt_lapic_t *) p;
+            if( e->type == MADT_LAPIC && (e->flags & MADT_CPU_ENABLED) ) {
+                _smp_found( e->apic_id );
+            }
+            p += e->length;
+        }
+
+        return( madt->lapic );
+    }
+
+    return( 0 );
+}
+
+/**
+** _smp_mp() - list the CPUs in the MP configuration table
+**
+** @return the local APIC address, or 0 if there is no usable table
+*/
+static uint32_t _smp_mp( void ) {
+
+    mp_fp_t *fp = _smp_search( SIG_MP, 0, sizeof(mp_fp_t) );
+
+    // (we don't handle the "default" configurations)
+    if( fp == NULL || fp->config == 0 || fp->features[0] != 0 ) {
+        return( 0 );
+    }
+
+    mp_conf_t *conf = (mp_conf_t *) fp->config;
+    if( conf->signature != SIG_PCMP || _smp_sum(conf,conf->length) != 0 ) {
+        return( 0 );
+    }
+
+    uint8_t *p = (uint8_t *) (conf + 1);
+    for( int i = 0; i < conf->entries; ++i ) {
+        if( *p == MP_PROC ) {
+            mp_proc_t *e = (mp_proc_t *) p;
+            if( e->flags & MP_CPU_ENABLED ) {
+                _smp_found( e->apic_id );
+            }
+            p += sizeof(mp_proc_t);
+        } else {
+            p += MP_ENTRY_LEN;
+        }
+    }
+
+    return( conf->lapic );
+}
+
+/**
+** _smp_desc() - build a segment descriptor
+*/
+static uint64_t _smp_desc( uint32_t base, uint32_t limit,
+                           uint8_t access, uint8_t flags ) {
+
+    return( ((uint64_t) (limit & 0xffff)) |
+            (((uint64_t) (base & 0xffffff)) << 16) |
+            (((uint64_t) access) << 40) |
+            (((uint64_t) ((limit >> 16) & 0xf)) << 48) |
+            (((uint64_t) (flags & 0xf)) << 52) |
+            (((uint64_t) (base >> 24)) << 56) );
+}
+
+/**
+** _smp_setup() - fill in a CPU's own data, GDT, and TSS
+**
+** @param cpu     The CPU
+** @param id      Its index into _cpus[]
+** @param apic_id Its local APIC ID
+** @param stk     Its system stack (NULL for the BSP, for now)
+*/
+static void _smp_setup( cpu_t *cpu, uint8_t id, uint8_t apic_id,
+                        stack_t *stk ) {
+
+    cpu->self = cpu;
+    cpu->id = id;
+    cpu->apic_id = apic_id;
+    cpu->online = false;
+
+    // the ISR code expects ESP to start out as _stk_init() sets it up
+    cpu->system_stack = stk;
+    cpu->system_esp = stk ? ((uint32_t *) (stk + 1)) - 2 : NULL;
+
+    __memclr( &cpu->tss, sizeof(tss_t) );
+    cpu->tss.esp0 = (uint32_t) cpu->system_esp;
+    cpu->tss.ss0 = GDT_STACK;
+    cpu->tss.iomap = sizeof(tss_t);
+
+    // the bootstrap's entries, and then this CPU's own
+    __memcpy( cpu->gdt, (void *) GDT_ADDRESS, GDT_CPU );
+    cpu->gdt[GDT_CPU >> 3] = _smp_desc( (uint32_t) cpu, sizeof(cpu_t) - 1,
+                                        DESC_DATA, DESC_32BIT );
+    cpu->gdt[GDT_TSS >> 3] = _smp_desc( (uint32_t) &cpu->tss,
+                                        sizeof(tss_t) - 1, DESC_TSS, 0 );
+}
+
+/**
+** _smp_boot() - start an AP
+**
+** @param cpu     Its data
+** @param id      Its index into _cpus[]
+** @param apic_id Its local APIC ID
+**
+** @return true if it came up
+*/
+static bool_t _smp_boot( cpu_t *cpu, uint8_t id, uint8_t apic_id ) {
+
+    stack_t *stk = _stk_alloc();
+    if( stk == NULL ) {
+        return( false );
+    }
+
+    _smp_setup( cpu, id, apic_id, stk );
+    _sched_cpu_init( cpu );
+    _smp_booting = cpu;
+
+    // INIT, then the startup IPI; the second one is in case the
+    // first was missed
+    _lapic_ipi( apic_id, ICR_INIT );
+    _lapic_delay( 10000 );
+    for( int i = 0; i < 2 && !cpu->online; ++i ) {
+        _lapic_ipi( apic_id, ICR_STARTUP | (AP_TRAMPOLINE_ADDRESS >> 12) );
+        _lapic_delay( 200 );
+    }
+
+    // give it 100ms to check in
+    for( int i = 0; i < 100 && !cpu->online; ++i ) {
+        _lapic_delay( 1000 );
+    }
+
+    if( !cpu->online ) {
+        __cio_printf( " (APIC %d didn't start)", apic_id );
+        _stk_free( stk );
+        return( false );
+    }
+
+    return( true );
+}
+
+/*
+** PUBLIC FUNCTIONS
+*/
+
+/**
+** _smp_init() - set up the BSP's own data
+*/
+void _smp_init( void ) {
+
+    _lapic = NULL;
+    _n_found = 0;
+    _lock_init( &_kernel_lock, "kernel", LOCK_TICKET );
+
+    // its system stack doesn't exist yet; see _smp_start()
+    _smp_setup( &_cpus[0], 0, 0, NULL );
+    __smp_load_gdt( _cpus[0].gdt, sizeof(_cpus[0].gdt) );
+    _n_cpus = 1;
+}
+
+/**
+** _smp_start() - find and start the other CPUs
+*/
+void _smp_start( void ) {
+    cpu_t *bsp = &_cpus[0];
+
+    __cio_puts( " SMP:" );
+
+    bsp->system_stack = _system_stack;
+    bsp->system_esp = _system_esp;
+    bsp->tss.esp0 = (uint32_t) _system_esp;
+    bsp->online = true;
+
+    // the APs wait for this until initialization is complete
+    _smp_lock();
+
+    _smp_idle_create();
+
+    __install_isr( INT_VEC_LAPIC_TIMER, _smp_timer_isr );
+    __install_isr( INT_VEC_LAPIC_SPURIOUS, _smp_spurious_isr );
+
+    // prefer the ACPI tables; fall back to the MP tables
+    uint32_t base = _smp_madt();
+    if( base == 0 ) {
+        _n_found = 0;
+        base = _smp_mp();
+    }
+
+    if( base == 0 ) {
+        __cio_puts( " no tables, 1 CPU done" );
+        return;
+    }
+
+    _lapic = (volatile uint32_t *) base;
+    bsp->apic_id = _lapic_read( LAPIC_ID ) >> 24;
+    _lapic_write( LAPIC_SVR, SVR_ENABLE | INT_VEC_LAPIC_SPURIOUS );
+    _lapic_per_ms = _lapic_calibrate();
+
+    __memcpy( (void *) AP_TRAMPOLINE_ADDRESS, __smp_tramp,
+              __smp_tramp_end - __smp_tramp );
+
+    for( uint32_t i = 0; i < _n_found && _n_cpus < N_CPUS; ++i ) {
+        if( _apic_ids[i] != bsp->apic_id &&
+                _smp_boot(&_cpus[_n_cpus],_n_cpus,_apic_ids[i]) ) {
+            ++_n_cpus;
+        }
+    }
+
+    __cio_printf( " %d CPU%s done", _n_cpus, _n_cpus == 1 ? "" : "s" );
+}
+
+/**
+** _smp_ap_main() - C entry point for each AP
+*/
+void _smp_ap_main( void ) {
+    cpu_t *cpu = _smp_booting;
+
+    __smp_load_gdt( cpu->gdt, sizeof(cpu->gdt) );
+    _vm_cpu_init();
+
+    // accept all interrupts, and start the time slice clock
+    _lapic_write( LAPIC_TPR, 0 );
+    _lapic_write( LAPIC_SVR, SVR_ENABLE | INT_VEC_LAPIC_SPURIOUS );
+    _lapic_write( LAPIC_TDCR, TDCR_DIV_16 );
+    _lapic_write( LAPIC_LVT_TIMER, LVT_PERIODIC | INT_VEC_LAPIC_TIMER );
+    _lapic_write( LAPIC_TICR, _lapic_per_ms / TICKS_PER_MS );
+
+    // check in; the BSP is waiting for this
+    cpu->online = true;
+
+    // once the BSP has finished initialization, get to work
+    // (__isr_restore releases the lock)
+    _smp_lock();
+    _smp_idle_create();
+    _dispatch();
+}
+
+/**
+** _smp_lock() - acquire the kernel lock
+*/
+void _smp_lock( void ) {
+    _lock_acquire( &_kernel_lock );
+}
+
+/**
+** _smp_unlock() - release the kernel lock
+*/
+void _smp_unlock( void ) {
+    _lock_release( &_kernel_lock );
+}
+
+/**
+** _smp_dump() - dump the per-CPU data to the console
+*/
+void _smp_dump( void ) {
+
+    __cio_printf( "%d CPU%s, LAPIC timer %d/ms\n", _n_cpus,
+                  _n_cpus == 1 ? "" : "s", _lapic_per_ms );
+
+    for( uint32_t i = 0; i < _n_cpus; ++i ) {
+        cpu_t *cpu = &_cpus[i];
+        uint32_t rq[3] = { 0, 0, 0 };
+
+        // (by band, so MLFQ-demoted processes are counted too)
+        _sched_ready_bands( cpu, rq );
+        __cio_printf( " cpu %d apic %d: pid %d, %d ticks, %d steals,"
+                      " ready S/U/D %d/%d/%d\n", cpu->id, cpu->apic_id,
+                      cpu->current ? cpu->current->pid : 0, cpu->ticks,
+                      cpu->steals, rq[0], rq[1], rq[2] );
+    }
+}
@@ -0,0 +1,181 @@
+/**
+** @file smp.h
+**
+** @author CSCI-452 class of 20215
+**
+** Multiprocessor support declarations
+**
+** The bootstrap processor (BSP) finds the other CPUs (the application
+** processors, or APs) in the ACPI or MP tables, and starts each one
+** with an INIT and two startup IPIs.  Every CPU has its own copy of
+** the GDT, whose GDT_CPU segment covers that CPU's cpu_t; %gs always
+** holds GDT_CPU, so "%gs:0" is the address of the running CPU's own
+** data wherever it is used.
+**
+** The kernel proper still runs on one CPU at a time:  the ISR entry
+** code takes the kernel lock before touching anything shared, and
+** releases it just before returning into a process, so only user
+** code runs in parallel.  The structures the kernel shares between
+** CPUs (the process table, each CPU's ready queues, the sleep wheel,
+** the page and slice pools, and the SIO buffers) also have locks of
+** their own (see lock.h), which are what will allow the kernel lock
+** to be split up later.
+*/
+
+#ifndef SMP_H_
+#define SMP_H_
+
+/*
+** General (C and/or assembly) definitions
+*/
+
+// the most CPUs we will bring up
+#define N_CPUS                  8
+
+// interrupt vectors used by the local APICs
+#define INT_VEC_LAPIC_TIMER     0x40
+#define INT_VEC_LAPIC_SPURIOUS  0xff
+
+#ifndef SP_ASM_SRC
+
+/*
+** Start of C-only definitions
+*/
+
+#include "common.h"
+#include "queues.h"
+#include "process.h"
+#include "lock.h"
+
+// entries in each CPU's GDT:  the five the bootstrap creates, plus
+// GDT_CPU and GDT_TSS (see bootstrap.h)
+#define CPU_GDT_ENTRIES         7
+
+/*
+** Types
+*/
+
+// a task state segment.  Everything runs at privilege level 0 and we
+// never switch tasks, so nothing uses it yet; the ring 0 stack is
+// filled in for when something does.
+typedef struct tss_s {
+    uint32_t link;
+    uint32_t esp0;          // ring 0 stack pointer
+    uint32_t ss0;           //   and segment
+    uint32_t unused[22];    // other rings' stacks, and the register save
+    uint16_t trap;
+    uint16_t iomap;         // offset of the I/O permission bitmap
+} tss_t;
+
+// per-CPU data
+typedef struct cpu_s {
+    // these three are used by the ISR code; see offsets.h
+    struct cpu_s *self;         // this structure (found at %gs:0)
+    pcb_t *current;             // the process this CPU is running
+    uint32_t *system_esp;       // initial ESP for ISRs on this CPU
+
+    stack_t *system_stack;      // the stack system_esp points into
+    pcb_t *idle;                // this CPU's idle process
+    uint8_t id;                 // index into _cpus[]
+    uint8_t apic_id;            // local APIC ID
+    volatile uint8_t online;    // has it started running?
+
+    // scheduler state (see scheduler.c)
+    lock_t ready_lock;          // protects ready[] and ready_map[]
+    queue_t ready[N_PRIOS];     // MLQ, with one level per priority value
+    uint32_t ready_map[(N_PRIOS + 31) / 32];   // levels that may be ready
+    pcb_t *acct_pcb;            // TSC cycles since acct_stamp belong to it
+    uint64_t acct_stamp;
+    bool_t forced;              // was the CPU taken away from acct_pcb?
+
+    // statistics
+    uint32_t ticks;             // timer interrupts taken
+    uint32_t steals;            // processes taken from other CPUs' queues
+
+    tss_t tss;
+    uint32_t pad;               // keeps gdt 8-byte aligned (see lock.h)
+    uint64_t gdt[CPU_GDT_ENTRIES];
+} cpu_t;
+
+/*
+** Globals
+*/
+
+// per-CPU data; [0] is the BSP, and the first _n_cpus are running
+extern cpu_t _cpus[N_CPUS];
+extern uint32_t _n_cpus;
+
+// the AP being started (used by the AP startup code)
+extern cpu_t *_smp_booting;
+
+// the running CPU's own data
+#define _cpu    (__cpu_self())
+
+/*
+** Prototypes
+*/
+
+/**
+** __cpu_self() - find the running CPU's own data
+**
+** @return a pointer to the cpu_t, read from %gs:0
+*/
+cpu_t *__cpu_self( void );
+
+/**
+** __smp_load_gdt() - load a CPU's own GDT, and reload the segment
+**                    registers and the task register from it
+**
+** @param gdt   The GDT
+** @param size  Its length, in bytes
+*/
+void __smp_load_gdt( uint64_t *gdt, uint32_t size );
+
+/**
+** _smp_init() - set up the BSP's own data
+**
+** Dependencies:
+**    Must be called before anything that uses _current or _cpu
+*/
+void _smp_init( void );
+
+/**
+** _smp_start() - find and start the other CPUs
+**
+** Each one comes up with its own GDT, TSS, system stack, run
+** queues, and idle process, then waits for the kernel lock, which
+** the BSP holds until system initialization is complete.
+**
+** Dependencies:
+**    Must follow the scheduler, stack, process, and VM modules
+**    Must precede _km_reclaim_acpi()
+*/
+void _smp_start( void );
+
+/**
+** _smp_ap_main() - C entry point for each AP, from the AP startup code
+**
+** Dispatches a process for this CPU; on return, the startup code
+** restores its context.
+*/
+void _smp_ap_main( void );
+
+/**
+** _smp_lock() - acquire the kernel lock
+*/
+void _smp_lock( void );
+
+/**
+** _smp_unlock() - release the kernel lock
+*/
+void _smp_unlock( void );
+
+/**
+** _smp_dump() - dump the per-CPU data to the console
+*/
+void _smp_dump( void );
+
+#endif
+/* SP_ASM_SRC */
+
+#endif
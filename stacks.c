@@ -13,6 +13,7 @@
 #include "bootstrap.h"
 #include "stacks.h"
 #include "kernel.h"
+#include "slab.h"
 
 // also need the exit_helper() entry point
 void exit_helper( void );
@@ -109,8 +110,9 @@ stack_t *_stk_alloc( void ) {
         //
         _stack_list = (stack_t *) ((uint32_t *)new)[0];
 
-        // clear out the fields in this one just to be safe
-        __memclr( new, sizeof(stack_t) );
+        // we don't clear the stack here; every user of a new
+        // stack either copies a whole stack over it (fork) or
+        // clears it itself (_stk_setup)
 
     }
 
@@ -162,7 +164,8 @@ void _stk_free( stack_t *stk ) {
 ** @param entry  - Entry point for the new process
 ** @param args   - Argument vector to be put in place
 **
-** @return A pointer to the context_t on the stack, or NULL
+** @return A pointer to the context_t on the stack, as the new process
+**         will see it (see CTX() in process.h), or NULL
 */
 context_t *_stk_setup( stack_t *stk, uint32_t entry, char *args[] ) {
 
@@ -196,32 +199,21 @@ context_t *_stk_setup( stack_t *stk, uint32_t entry, char *args[] ) {
 #endif
 
     /*
-    ** Allocate the arrays.  We are safe using dynamic arrays here
-    ** because we're using the OS stack, not the user stack.  Once
-    ** we have copied the strings, it's safe to clear the stack.
+    ** Allocate the arrays.  The argv pointers and the argument
+    ** strings share a single right-sized block from _kmalloc(),
+    ** which keeps large argument lists off the OS stack.  Once we
+    ** have copied the strings, it's safe to clear the stack.
     **
-    ** We want the argstrings and argv arrays to contain all zeroes.
-    ** The C standard states, in section 6.7.8, that
-    **
-    **   "21 If there are fewer initializers in a brace-enclosed list
-    **       than there are elements or members of an aggregate, or
-    **       fewer characters in a string literal used to initialize an
-    **       array of known size than there are elements in the array,
-    **       the remainder of the aggregate shall be initialized
-    **       implicitly the same as objects that have static storage
-    **       duration."
-    **
-    ** Sadly, because we're using variable-sized arrays, we can't
-    ** rely on this, so we have to call __memclr() instead. :-(  In
-    ** truth, it doesn't really cost us much more time, but it's an
-    ** annoyance.
+    ** We want the argstrings and argv arrays to contain all zeroes,
+    ** so we ask for a cleared block.
     */
 
-    char argstrings[ argbytes ];
-    char *argv[ argc + 1 ];
-
-    __memclr( argstrings, argbytes );
-    __memclr( argv, (argc + 1) * sizeof(char *) );
+    uint32_t argvbytes = (argc + 1) * sizeof(char *);
+    char **argv = (char **) _kzalloc( argvbytes + argbytes );
+    if( argv == NULL ) {
+        return( NULL );
+    }
+    char *argstrings = ((char *) argv) + argvbytes;
 
     // Next, duplicate the argument strings, and create pointers to
     // each one in our argv.
@@ -288,6 +280,11 @@ context_t *_stk_setup( stack_t *stk, uint32_t entry, char *args[] ) {
     ** see below for more information.
     */
 
+    // The process sees this stack at VM_STACK, not where we see it, so
+    // any pointer into the stack that we leave for the process must
+    // be moved by this much.
+    int32_t window = VM_STACK - (uint32_t) stk;
+
     // Pointer to the last word in stack.
     uint32_t *ptr = ((uint32_t *)( stk + 1 )) - 1;
 
@@ -343,18 +340,18 @@ context_t *_stk_setup( stack_t *stk, uint32_t entry, char *args[] ) {
     */
 
     *argcptr = argc;
-    *ptr = *(argcptr + 1) = (uint32_t) fill;
+    *ptr = *(argcptr + 1) = (uint32_t) fill + window;
 
     /*
     ** Next, we copy in all argc+1 pointers.  This is complicated slightly
     ** by the need to adjust the pointers; they currently point into the
     ** local argstrings array.  We do this by adding the distance between
     ** the start of the argstrings array and the duplicate of that data on
-    ** the stack.
+    ** the stack, as the process will see it.
     */
 
     // Calculate the distance between the two argstring arrays.
-    int32_t distance = strings - &argstrings[0];
+    int32_t distance = strings - &argstrings[0] + window;
 
     // Adjust and copy the string pointers.
     for( int i = 0; i <= argc; ++i ) {
@@ -369,12 +366,15 @@ context_t *_stk_setup( stack_t *stk, uint32_t entry, char *args[] ) {
     // reset 'fill' to where argc was placed
     fill = argcptr;
 
+    // we're done with the temporary copies
+    _kfree( argv );
+
 #if TRACING_STACK
     // get argv from the stack
-    char **targs = (char **) *(fill + 1);
+    char **targs = (char **) (*(fill + 1) - window);
     __cio_printf( "=== _stk_setup, copied %d args:", argc );
     for( int i = 0; i < argc; ++i ) {
-        __cio_printf( " '%s'", targs[i] );
+        __cio_printf( " '%s'", targs[i] - window );
     }
     __cio_putchar( '\n' );
 #endif
@@ -407,7 +407,8 @@ context_t *_stk_setup( stack_t *stk, uint32_t entry, char *args[] ) {
     ct->eip = entry;                // initial EIP
     ct->cs = GDT_CODE;              // segment registers
     ct->ss = GDT_STACK;
-    ct->ds = ct->es = ct->fs = ct->gs = GDT_DATA;
+    ct->ds = ct->es = ct->fs = GDT_DATA;
+    ct->gs = GDT_CPU;               // whichever CPU restores it
 
 // #if TRACING_STACK
     // __cio_printf( "=== context @ %08x\n", ct );
@@ -420,7 +421,7 @@ context_t *_stk_setup( stack_t *stk, uint32_t entry, char *args[] ) {
     ** caller's responsibility to schedule this process.
     */
     
-    return( ct );
+    return( (context_t *) ((uint32_t) ct + window) );
 }
 
 /*
@@ -87,7 +87,8 @@ void _stk_free( stack_t *stk );
 ** @param entry  - Entry point for the new process
 ** @param args   - Argument vector to be put in place
 **
-** @return A pointer to the context_t on the stack, or NULL
+** @return A pointer to the context_t on the stack, as the new process
+**         will see it, or NULL
 */
 context_t *_stk_setup( stack_t *stk, uint32_t entry, char *args[] );
 
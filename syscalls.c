@@ -24,6 +24,7 @@
 #include "clock.h"
 #include "cio.h"
 #include "sio.h"
+#include "slab.h"
 
 /*
 ** PRIVATE DEFINITIONS
@@ -72,6 +73,15 @@ static void _sys_isr( int vector, int code ) {
     // Much less likely to occur, but still potentially problematic.
     assert2( _current->context != NULL );
 
+    // If it was killed while it was running on this CPU, it doesn't
+    // get to make any more calls.
+    if( _current->state == Killed ) {
+        _perform_exit( _current );
+        _dispatch();
+        __outb( PIC_PRI_CMD_PORT, PIC_EOI );
+        return;
+    }
+
     // Retrieve the system call code.
     uint32_t syscode = REG( _current, eax );
 
@@ -88,6 +98,10 @@ static void _sys_isr( int vector, int code ) {
     // Handle the system call.
     _syscalls[syscode]( _current );
 
+    // In tickless mode, the call may have changed when the next
+    // timer interrupt is needed.
+    _clk_rearm();
+
     // Tell the PIC we're done.
     __outb( PIC_PRI_CMD_PORT, PIC_EOI );
 }
@@ -178,42 +192,34 @@ static void _sys_fork( pcb_t *curr ) {
         return;
     }
 
+    // Give it an address space of its own, with the stack and a
+    // copy of the parent's data segment in it.
+    if( _vm_fork(curr,new) != E_SUCCESS ) {
+        _stk_free( new->stack );
+        _pcb_free( new );
+        RET(curr) = E_NO_PROCS;
+#if TRACING_SYSRET
+        __cio_printf( "<-- %08x\n", E_NO_PROCS );
+#endif
+        return;
+    }
+
     // Duplicate the parent's stack.
     __memcpy( (void *)new->stack, (void *)curr->stack, sizeof(stack_t) );
 
     // Set the child's identity.
-    new->pid = _next_pid++;
+    new->pid = _pid_alloc();
     new->ppid = curr->pid;
-    new->state = New;
+    new->parent = curr;
+    _pcb_set_state( new, New );
     new->quantum = Q_DEFAULT;
 
     /*
-    ** Now, we need to update the ESP and EBP values in the child's
-    ** stack.  The problem is that because we duplicated the parent's
-    ** stack, these pointers are still pointing back into that stack,
-    ** which will cause problems as the two processes continue to execute.
+    ** The child's copy of the stack is mapped at the same virtual
+    ** address as the parent's, so its context pointer, ESP, and EBP
+    ** chain are all correct as they stand.
     */
-
-    // Figure out the byte offset from one stack to the other.
-    int32_t offset = (void *) new->stack - (void *) curr->stack;
-
-    // Add this to the child's context pointer.
-    new->context = (context_t *) (((void *)curr->context) + offset);
-
-    // Fix the child's ESP and EBP values IFF they're non-zero.
-    if( REG(new,ebp) != 0 ) {
-        REG(new,ebp) += offset;
-    }
-    if( REG(new,esp) != 0 ) {
-        REG(new,esp) += offset;
-    }
-
-    // Follow the EBP chain through the child's stack.
-    uint32_t *bp = (uint32_t *) REG(new,ebp);
-    while( bp && *bp ) {
-        *bp += offset;
-        bp = (uint32_t *) *bp;
-    }
+    new->context = curr->context;
 
     // Set the return values for the two processes.
     RET(curr) = new->pid;
@@ -221,23 +227,19 @@ static void _sys_fork( pcb_t *curr ) {
     // _context_dump( "fork: new 1:", new->context );
     // __delay(400);
 
-    // Add the new process to the process table.
-    int ix;
-    for( ix = 0; ix < N_PROCS; ++ix ) {
-        if( _processes[ix] == NULL ) {
-            break;
-        }
-    }
-
-    // Did we find an open slot?
-    if( ix >= N_PROCS ) {
-        PANIC( 0, "no empty slot in non-full process table" );
+    // Add the new process to the process table; this can fail if
+    // the table needs to grow and there's no memory for it.
+    if( _ptable_add(new) != E_SUCCESS ) {
+        _vm_destroy( new );
+        _stk_free( new->stack );
+        _pcb_free( new );
+        RET(curr) = E_NO_PROCS;
+#if TRACING_SYSRET
+        __cio_printf( "<-- %08x\n", E_NO_PROCS );
+#endif
+        return;
     }
 
-    // Yes - record the new process.
-    _processes[ix] = new;
-    ++_n_procs;
-
     // Schedule the child, and let the parent continue.
     _schedule( new );
 #if TRACING_SYSRET
@@ -271,14 +273,19 @@ static void _sys_execp( pcb_t *curr ) {
     context_t *ct = _stk_setup( curr->stack, entry, args );
     assert( ct != NULL );
 
+    // The old data segment goes away (but not before the arguments,
+    // which may have been in it, were copied).
+    _vm_exec( curr );
+
     // Copy the context pointer into the current PCB.
     curr->context = ct;
 
     // It's also the current ESP for the process.
-    curr->context->esp = (uint32_t) ct;
+    REG(curr,esp) = (uint32_t) ct;
 
-    // Assign the specified priority.
-    curr->priority = prio;
+    // Assign the specified priority; under MLFQ, this is also the
+    // level the process will return to when priorities are boosted.
+    curr->priority = curr->base = prio;
 
     /*
     ** Decision:  (A) schedule this process and dispatch another,
@@ -317,13 +324,7 @@ static void _sys_kill( pcb_t *curr ) {
     }
     
     // locate the victim
-    pcb_t *pcb = NULL;
-    for( int i = 0; i < N_PROCS; ++i ) {
-        if( _processes[i] != NULL && _processes[i]->pid == victim ) {
-            pcb = _processes[i];
-            break;
-        }
-    }
+    pcb_t *pcb = _pcb_find( victim );
 
     // did we find the victim?
     if( pcb == NULL ) {
@@ -348,7 +349,7 @@ static void _sys_kill( pcb_t *curr ) {
 
     case Ready:
         // remove it from the ready queue
-        tmp = _queue_remove_specific( _ready[pcb->priority], pcb );
+        tmp = _sched_unready( pcb );
         // verify that we got the correct PCB
         assert( tmp == pcb );
         // mark it as killed and clean it up
@@ -358,26 +359,38 @@ static void _sys_kill( pcb_t *curr ) {
         break;
 
     case Sleeping:
-        // remove it from the sleep queue
-        tmp = _queue_remove_specific( _sleeping, pcb );
+        // remove it from the sleep wheel
+        _lock_acquire( &_sleep_lock );
+        tmp = _wheel_cancel( _sleeping, pcb );
+        _lock_release( &_sleep_lock );
         // verify that we got the correct PCB
         assert( tmp == pcb );
         // mark it as killed and clean it up
         pcb->exit_status = E_KILLED;
         _perform_exit( pcb );
         RET(curr) = E_SUCCESS;
+        break;
 
     case Blocked:
         // we don't want to deque it because it's waiting for some
         // type of device event; instead, we mark it as Killed,
         // and when it comes up for scheduling or dispatching, we'll
         // clean it up then
-        pcb->state = Killed;
+        _pcb_set_state( pcb, Killed );
         pcb->exit_status = E_KILLED;
         RET(curr) = E_SUCCESS;
         break;
 
-    case Running:  // current process
+    case Running:
+        if( pcb != curr ) {
+            // it's the current process on another CPU; mark it as
+            // Killed, and that CPU will clean it up the next time
+            // it takes an interrupt
+            _pcb_set_state( pcb, Killed );
+            pcb->exit_status = E_KILLED;
+            RET(curr) = E_SUCCESS;
+            break;
+        }
         // we have met the enemy, and he is us!
         curr->exit_status = E_KILLED;
         _perform_exit( curr );
@@ -422,8 +435,7 @@ static void _sys_kill( pcb_t *curr ) {
 **      exit status of the child via a non-NULL 'status' parameter
 */
 static void _sys_wait( pcb_t *curr ) {
-    pcb_t *child = NULL;
-    int nchildren = 0;
+    pcb_t *child;
 
 #if TRACING_SYSCALLS
     __cio_printf( "--> _sys_wait, pid %d\n", curr->pid );
@@ -432,37 +444,17 @@ static void _sys_wait( pcb_t *curr ) {
     /*
     ** We want to do two things here:  (1) find out whether or
     ** not this process has any children in the system, and (2)
-    ** find out whether any of them have terminated.  We'll loop
-    ** until we find a Zombie child process or have gone through
-    ** all the slots in the process table.
+    ** find out whether any of them have terminated.  Terminated
+    ** children are kept on their own list, so both are easy.
     **
     ** Note that we don't care which child process we reap here;
     ** there could be several, but we only need to find one.
     */
 
-    for( int i = 0; i < N_PROCS; ++i ) {
-
-        // only look at valid entries
-        if( _processes[i] != NULL ) {
-
-            // is this one of our children?
-            if( _processes[i]->ppid == curr->pid ) {
-
-                // yes - count it
-                ++nchildren;
-
-                // see if it has terminated
-                if( _processes[i]->state == Zombie ) {
-                    // yes!  remember it
-                    child = _processes[i];
-                    break;
-                }
-            }
-        }
-    }
+    child = curr->zombies;
 
     // no children at all
-    if( nchildren == 0 ) {
+    if( child == NULL && curr->children == NULL ) {
         RET(curr) = E_NO_CHILDREN;
 #if TRACING_SYSRET
         __cio_printf( "<-- %08x\n", E_NO_CHILDREN );
@@ -474,7 +466,7 @@ static void _sys_wait( pcb_t *curr ) {
     if( child == NULL ) {
 
         // no - mark the parent as "Waiting"
-        curr->state = Waiting;
+        _pcb_set_state( curr, Waiting );
 
         // select a new current process
         _dispatch();
@@ -486,7 +478,7 @@ static void _sys_wait( pcb_t *curr ) {
     int *stat = (int *) ARG(curr,1);
 
     // if stat is NULL, the parent doesn't want the status
-    if( stat != NULL ) {
+    if( stat != NULL && _vm_touch(curr, stat, sizeof(int)) == E_SUCCESS ) {
         *stat = child->exit_status;
     }
 
@@ -512,15 +504,11 @@ static void _sys_sleep( pcb_t *curr ) {
     if( ms == 0 ) {
         _schedule( curr );
     } else {
-        curr->wakeup = _system_time + MS_TO_TICKS(ms);
-        curr->state = Sleeping;
-        status_t status = _queue_add( _sleeping,
-                            (void *) curr, curr->wakeup );
-        if( status != E_SUCCESS ) {
-            __sprint(b256,"cannot put %d to sleep",curr->pid);
-            WARNING( b256 );
-            _schedule( curr );
-        }
+        _sched_block( curr );
+        _pcb_set_state( curr, Sleeping );
+        _lock_acquire( &_sleep_lock );
+        _wheel_add( _sleeping, (void *) curr, _system_time + MS_TO_TICKS(ms) );
+        _lock_release( &_sleep_lock );
     }
 
     _dispatch();
@@ -545,6 +533,15 @@ static void _sys_read( pcb_t *curr ) {
     __cio_printf( "--> _sys_read, pid %d\n", curr->pid );
 #endif
 
+    // the kernel writes the data directly into the buffer
+    if( _vm_touch(curr, buf, length) != E_SUCCESS ) {
+        RET(curr) = E_NO_MEM;
+#if TRACING_SYSRET
+        __cio_printf( "<-- %08x\n", E_NO_MEM );
+#endif
+        return;
+    }
+
     // try to get the next character(s)
     switch( ARG(curr,1) ) {
     case CHAN_CIO:
@@ -587,7 +584,8 @@ static void _sys_read( pcb_t *curr ) {
     } else {
 
         // mark it as blocked
-        curr->state = Blocked;
+        _sched_block( curr );
+        _pcb_set_state( curr, Blocked );
 
         // put it on the SIO input queue
         assert( _queue_add(_reading,curr,0) == E_SUCCESS );
@@ -656,7 +654,8 @@ static void _sys_sysstat( pcb_t *curr ) {
 #endif
 
     // verify that the user gave us a pointer we could use
-    if( counts == NULL ) {
+    if( counts == NULL ||
+            _vm_touch(curr, counts, N_STATES * sizeof(uint32_t)) != E_SUCCESS ) {
         RET(curr) = E_BAD_PARAM;
 #if TRACING_SYSRET
         __cio_printf( "<-- %08x\n", E_BAD_PARAM );
@@ -753,6 +752,261 @@ static void _sys_getprio( pcb_t *curr ) {
 #endif
 }
 
+/**
+** _sys_kmstat - retrieve memory allocator statistics
+**
+** implements:
+**      status_t kmstat( kmstat_t *stats );
+**
+** returns:
+**      the allocator statistics (via the parameter)
+**      success, or an error code (intrinsic)
+*/
+static void _sys_kmstat( pcb_t *curr ) {
+    kmstat_t *stats = (kmstat_t *) ARG(curr,1);
+
+#if TRACING_SYSCALLS
+    __cio_printf( "--> _sys_kmstat, pid %d\n", curr->pid );
+#endif
+
+    // verify that the user gave us a pointer we could use
+    if( stats == NULL ||
+            _vm_touch(curr, stats, sizeof(kmstat_t)) != E_SUCCESS ) {
+        RET(curr) = E_BAD_PARAM;
+#if TRACING_SYSRET
+        __cio_printf( "<-- %08x\n", E_BAD_PARAM );
+#endif
+        return;
+    }
+
+    _km_stats( stats );
+    _kmem_cache_stats( stats );
+
+    RET(curr) = E_SUCCESS;
+#if TRACING_SYSRET
+        __cio_printf( "<-- %08x\n", E_SUCCESS );
+#endif
+}
+
+/**
+** _sys_setpolicy - select the scheduling policy
+**
+** implements:
+**      int setpolicy( int policy );
+**
+** returns:
+**      the previous policy, or an error code (intrinsic)
+*/
+static void _sys_setpolicy( pcb_t *curr ) {
+    int policy = ARG(curr,1);
+
+#if TRACING_SYSCALLS
+    __cio_printf( "--> _sys_setpolicy, pid %d\n", curr->pid );
+#endif
+
+    RET(curr) = _sched_setpolicy( policy );
+#if TRACING_SYSRET
+        __cio_printf( "<-- %08x\n", RET(curr) );
+#endif
+}
+
+/**
+** _sys_setweight - set the fair class weight of a process
+**
+** implements:
+**      status_t setweight( pid_t pid, uint32_t weight );
+**
+** returns:
+**      success, or an error code (intrinsic)
+*/
+static void _sys_setweight( pcb_t *curr ) {
+    pid_t pid = ARG(curr,1);
+    uint32_t weight = ARG(curr,2);
+
+#if TRACING_SYSCALLS
+    __cio_printf( "--> _sys_setweight, pid %d\n", curr->pid );
+#endif
+
+    // setweight(0,...) applies to the calling process
+    if( pid == 0 ) {
+        pid = curr->pid;
+    }
+
+    // locate the process
+    pcb_t *pcb = _pcb_find( pid );
+
+    RET(curr) = pcb == NULL ? E_NOT_FOUND : _sched_setweight( pcb, weight );
+#if TRACING_SYSRET
+        __cio_printf( "<-- %08x\n", RET(curr) );
+#endif
+}
+
+/**
+** _sys_setdeadline - put the current process in the EDF class
+**
+** implements:
+**      status_t setdeadline( uint32_t runtime, uint32_t period,
+**                            uint32_t deadline );
+**
+** returns:
+**      status of the change
+*/
+static void _sys_setdeadline( pcb_t *curr ) {
+    uint32_t runtime = ARG(curr,1);
+    uint32_t period = ARG(curr,2);
+    uint32_t deadline = ARG(curr,3);
+
+#if TRACING_SYSCALLS
+    __cio_printf( "--> _sys_setdeadline, pid %d\n", curr->pid );
+#endif
+
+    status_t status = _sched_setdeadline( curr, runtime, period, deadline );
+    RET(curr) = status;
+#if TRACING_SYSRET
+        __cio_printf( "<-- %08x\n", status );
+#endif
+
+    // the caller's first job competes with the other EDF tasks
+    // (or, if it left the class, it goes back to its level)
+    if( status == E_SUCCESS ) {
+        _schedule( curr );
+        _dispatch();
+    }
+}
+
+/**
+** _sys_edfstat - retrieve the EDF class statistics of a process
+**
+** implements:
+**      status_t edfstat( pid_t pid, edfstat_t *stats );
+**
+** returns:
+**      the statistics (in 'stats')
+**      status of the retrieval
+*/
+static void _sys_edfstat( pcb_t *curr ) {
+    pid_t pid = ARG(curr,1);
+    edfstat_t *stats = (edfstat_t *) ARG(curr,2);
+
+#if TRACING_SYSCALLS
+    __cio_printf( "--> _sys_edfstat, pid %d\n", curr->pid );
+#endif
+
+    // edfstat(0,...) applies to the calling process
+    if( pid == 0 ) {
+        pid = curr->pid;
+    }
+
+    // locate the process
+    pcb_t *pcb = _pcb_find( pid );
+
+    if( pcb == NULL ) {
+        RET(curr) = E_NOT_FOUND;
+    } else if( stats == NULL ||
+            _vm_touch(curr, stats, sizeof(edfstat_t)) != E_SUCCESS ) {
+        RET(curr) = E_BAD_PARAM;
+    } else {
+        // a process outside the class reports all zeroes
+        bool_t edf = pcb->sclass == SCLASS_EDF;
+        stats->runtime = edf ? pcb->rt_runtime : 0;
+        stats->period = edf ? pcb->rt_period : 0;
+        stats->deadline = edf ? pcb->rt_deadline : 0;
+        stats->jobs = pcb->jobs;
+        stats->misses = pcb->misses;
+        RET(curr) = E_SUCCESS;
+    }
+#if TRACING_SYSRET
+        __cio_printf( "<-- %08x\n", RET(curr) );
+#endif
+}
+
+/**
+** _sys_pstat - retrieve the CPU accounting summaries of the active
+**              processes
+**
+** implements:
+**      int pstat( pstat_t *table, uint32_t size );
+**
+** returns:
+**      up to 'size' summaries (in 'table')
+**      number of summaries, or an error code (intrinsic)
+*/
+static void _sys_pstat( pcb_t *curr ) {
+    pstat_t *table = (pstat_t *) ARG(curr,1);
+    uint32_t size = ARG(curr,2);
+
+#if TRACING_SYSCALLS
+    __cio_printf( "--> _sys_pstat, pid %d\n", curr->pid );
+#endif
+
+    // verify that the user gave us a pointer we could use
+    if( size > _n_procs ) {
+        size = _n_procs;
+    }
+    if( table == NULL ||
+            _vm_touch(curr, table, size * sizeof(pstat_t)) != E_SUCCESS ) {
+        RET(curr) = E_BAD_PARAM;
+#if TRACING_SYSRET
+        __cio_printf( "<-- %08x\n", E_BAD_PARAM );
+#endif
+        return;
+    }
+
+    int32_t n = 0;
+    for( uint32_t i = 0; i < _n_procs && n < size; ++i ) {
+        _pcb_stat( PTABLE(i), &table[n++] );
+    }
+
+    RET(curr) = n;
+#if TRACING_SYSRET
+        __cio_printf( "<-- %08x\n", n );
+#endif
+}
+
+/**
+** _sys_sbrk - grow or shrink the data segment of the current process
+**
+** implements:
+**      void *sbrk( int32_t increment );
+**
+** returns:
+**      the previous end of the data segment, or NULL (intrinsic)
+*/
+static void _sys_sbrk( pcb_t *curr ) {
+    int32_t increment = ARG(curr,1);
+
+#if TRACING_SYSCALLS
+    __cio_printf( "--> _sys_sbrk, pid %d\n", curr->pid );
+#endif
+
+    RET(curr) = _vm_sbrk( curr, increment );
+#if TRACING_SYSRET
+        __cio_printf( "<-- %08x\n", RET(curr) );
+#endif
+}
+
+/**
+** _sys_setfork - select how fork() copies the data segment
+**
+** implements:
+**      int setfork( int mode );
+**
+** returns:
+**      the previous mode, or an error code (intrinsic)
+*/
+static void _sys_setfork( pcb_t *curr ) {
+    int mode = ARG(curr,1);
+
+#if TRACING_SYSCALLS
+    __cio_printf( "--> _sys_setfork, pid %d\n", curr->pid );
+#endif
+
+    RET(curr) = _vm_setfork( mode );
+#if TRACING_SYSRET
+        __cio_printf( "<-- %08x\n", RET(curr) );
+#endif
+}
+
 /*
 ** PUBLIC FUNCTIONS
 */
@@ -789,6 +1043,14 @@ void _sys_init( void ) {
     _syscalls[ SYS_getppid ]  = _sys_getppid;
     _syscalls[ SYS_gettime ]  = _sys_gettime;
     _syscalls[ SYS_getprio ]  = _sys_getprio;
+    _syscalls[ SYS_kmstat ]   = _sys_kmstat;
+    _syscalls[ SYS_setpolicy ] = _sys_setpolicy;
+    _syscalls[ SYS_setweight ] = _sys_setweight;
+    _syscalls[ SYS_setdeadline ] = _sys_setdeadline;
+    _syscalls[ SYS_edfstat ]  = _sys_edfstat;
+    _syscalls[ SYS_pstat ]    = _sys_pstat;
+    _syscalls[ SYS_sbrk ]     = _sys_sbrk;
+    _syscalls[ SYS_setfork ]  = _sys_setfork;
 
     // install the second-stage ISR
     __install_isr( INT_VEC_SYSCALL, _sys_isr );
@@ -803,7 +1065,7 @@ void _sys_init( void ) {
 ** @param victim  Pointer to the PCB for the exiting process
 */
 void _perform_exit( pcb_t *victim ) {
-    pcb_t *parent = NULL;
+    pcb_t *parent = victim->parent;
     pcb_t *zombie = NULL;
 
 #if TRACING_EXIT
@@ -812,57 +1074,27 @@ void _perform_exit( pcb_t *victim ) {
 #endif
 
     // set its state
-    victim->state = Zombie;
+    _pcb_set_state( victim, Zombie );
+
+    // it no longer needs any CPU time it had reserved
+    _sched_release( victim );
 
     /*
-    ** We need to locate the parent of this process.  We also need
-    ** to reparent any children of this process.  We do these in
-    ** a single loop.
+    ** Any children of this process become children of 'init'.
+    ** If any of them are already zombies, remember one, so that
+    ** we can pass it on to 'init'.
     */
 
-    for( int i = 0; i < N_PROCS; ++i ) {
-        register pcb_t *curr = _processes[i];
-
-        // make sure this is a valid entry
-        if( curr == NULL ) {
-            continue;
-        }
-
-        // see if this is our parent; if it isn't, see if
-        // it's a child of the terminating process
-        if( curr->pid == victim->ppid ) {
-
-            // found the parent!
-            parent = curr;
-#if TRACING_EXIT
-    __cio_printf( "--> perform exit, parent PCB %08x pid %d\n",
-            (uint32_t) parent, parent->pid );
-#endif
-
-        } else if( curr->ppid == victim->pid ) {
+    if( victim != _init_pcb ) {
+        zombie = _pcb_reparent( victim, _init_pcb );
 #if TRACING_EXIT
-    __cio_printf( "--> perform exit, child PCB %08x pid %d",
-            (uint32_t) curr, curr->pid );
-#endif
-
-            curr->ppid = PID_INIT;
-            if( curr->state == Zombie ) {
-                // if it's already a zombie, remember it, so we
-                // can pass it on to 'init'
-                zombie = _processes[i];
-#if TRACING_EXIT
-    __cio_puts( " is a zombie\n" );
-#endif
-            }
-#if TRACING_EXIT
-    __cio_puts( " reparented\n" );
-#endif
+        if( zombie != NULL ) {
+            __cio_printf( "--> perform exit, zombie child %d reparented\n",
+                    zombie->pid );
         }
+#endif
     }
 
-    // every process must have a parent, even if it's 'init'
-    assert( parent != NULL );
-
     /*
     ** If we found a child that was already terminated, we need to
     ** wake up the init process if it's already waiting.
@@ -888,14 +1120,11 @@ void _perform_exit( pcb_t *victim ) {
         // may also want to return the exit status
         int32_t *ptr = (int32_t *) ARG(_init_pcb,1);
         if( ptr != NULL ) {
-            // *****************************************************
-            // Potential VM issue here!  This code assigns the exit
-            // status into a variable in the parent's address space.
-            // This works in the baseline because we aren't using
-            // any type of memory protection.  If address space
-            // separation is implemented, this code will very likely
-            // STOP WORKING, and will need to be fixed.
-            // *****************************************************
+            // the variable is in the parent's address space, which
+            // may not be the current one
+            ptr = (int32_t *) _vm_kaddr( _init_pcb, ptr );
+        }
+        if( ptr != NULL ) {
             *ptr = zombie->exit_status;
         }
 #if TRACING_EXIT
@@ -908,6 +1137,19 @@ void _perform_exit( pcb_t *victim ) {
         _pcb_cleanup( zombie );
     }
 
+    /*
+    ** Processes created by the kernel ('init' and the CPUs' idle
+    ** processes) have no parent to collect them.
+    */
+
+    if( parent == NULL ) {
+        return;
+    }
+#if TRACING_EXIT
+    __cio_printf( "--> perform exit, parent PCB %08x pid %d\n",
+            (uint32_t) parent, parent->pid );
+#endif
+
     // if the parent is already waiting, wake it up
     if( parent->state == Waiting ) {
 
@@ -917,14 +1159,11 @@ void _perform_exit( pcb_t *victim ) {
         // may also want to return the exit status
         int32_t *ptr = (int32_t *) ARG(parent,1);
         if( ptr != NULL ) {
-            // *****************************************************
-            // Potential VM issue here!  This code assigns the exit
-            // status into a variable in the parent's address space.
-            // This works in the baseline because we aren't using
-            // any type of memory protection.  If address space
-            // separation is implemented, this code will very likely
-            // STOP WORKING, and will need to be fixed.
-            // *****************************************************
+            // the variable is in the parent's address space, which
+            // may not be the current one
+            ptr = (int32_t *) _vm_kaddr( parent, ptr );
+        }
+        if( ptr != NULL ) {
             *ptr = victim->exit_status;
         }
 #if TRACING_EXIT
@@ -939,7 +1178,8 @@ void _perform_exit( pcb_t *victim ) {
     } else {
 
         // parent isn't waiting, so we become a Zombie
-        victim->state = Zombie;
+        _pcb_set_state( victim, Zombie );
+        _pcb_zombie( victim );
 
     }
 
@@ -34,9 +34,17 @@
 #define SYS_getppid     10
 #define SYS_gettime     11
 #define SYS_getprio     12
+#define SYS_kmstat      13
+#define SYS_setpolicy   14
+#define SYS_setweight   15
+#define SYS_setdeadline 16
+#define SYS_edfstat     17
+#define SYS_pstat       18
+#define SYS_sbrk        19
+#define SYS_setfork     20
 
 // UPDATE THIS DEFINITION IF MORE SYSCALLS ARE ADDED!
-#define N_SYSCALLS      13
+#define N_SYSCALLS      21
 
 // dummy system call code for testing our ISR
 #define SYS_bogus       0xbad
@@ -188,6 +188,123 @@ time_t gettime( void );
 */
 prio_t getprio( void );
 
+/**
+** kmstat - retrieve kernel memory allocator statistics
+**
+** usage:   status = kmstat(&stats);
+**
+** @param stats  Pointer to a kmstat_t into which the statistics
+**               will be placed
+**
+** @returns E_SUCCESS, or an error code
+*/
+status_t kmstat( kmstat_t *stats );
+
+/**
+** setpolicy - select the scheduling policy for User processes
+**
+** usage:   old = setpolicy(policy);
+**
+** @param policy  The new policy (SchedMLQ or SchedMLFQ)
+**
+** @returns The previous policy, or an error code
+*/
+int setpolicy( int policy );
+
+/**
+** setweight - set the fair class weight of a process
+**
+** usage:   status = setweight(pid,weight);
+**
+** A non-zero weight puts the process in the fair class, where it gets
+** CPU time in proportion to its weight; a weight of zero returns it
+** to its priority level.
+**
+** @param pid     The process, or 0 for the calling process
+** @param weight  The new weight (0 through WEIGHT_MAX)
+**
+** @returns E_SUCCESS, or an error code
+*/
+status_t setweight( pid_t pid, uint32_t weight );
+
+/**
+** setdeadline - put the calling process in the EDF real-time class
+**
+** usage:   status = setdeadline(runtime,period,deadline);
+**
+** The process is promised 'runtime' ticks of CPU time within
+** 'deadline' ticks of the start of each period, ahead of every
+** process outside the class.  A job ends when the process sleeps
+** or blocks, or when it has used up its runtime; the next one starts
+** no sooner than a period after the last.  The request is refused
+** if the promises already made leave too little CPU time to keep it.
+** A runtime of zero takes the process out of the class.
+**
+** @param runtime   CPU ticks needed in each period
+** @param period    Length of the period, in ticks
+** @param deadline  Relative deadline, in ticks (0 means the period)
+**
+** @returns E_SUCCESS, E_OVERLOAD, or another error code
+*/
+status_t setdeadline( uint32_t runtime, uint32_t period, uint32_t deadline );
+
+/**
+** edfstat - retrieve the EDF class statistics of a process
+**
+** usage:   status = edfstat(pid,&stats);
+**
+** @param pid    The process, or 0 for the calling process
+** @param stats  Pointer to an edfstat_t into which the parameters
+**               and the job and deadline miss counts will be placed
+**
+** @returns E_SUCCESS, or an error code
+*/
+status_t edfstat( pid_t pid, edfstat_t *stats );
+
+/**
+** pstat - retrieve CPU accounting summaries of the active processes
+**
+** usage:   n = pstat(table,size);
+**
+** Each summary gives the time the process has spent in user code and
+** in the kernel, in ticks; its total CPU time, in TSC cycles; and the
+** number of times it gave up the CPU or had it taken away.
+**
+** @param table  Array of pstat_t into which the summaries are placed
+** @param size   Number of entries in the array
+**
+** @returns The number of summaries, or an error code
+*/
+int pstat( pstat_t *table, uint32_t size );
+
+/**
+** sbrk - grow or shrink the data segment
+**
+** usage:   old = sbrk(increment);
+**
+** The data segment is private to the process, and is discarded by
+** exec(); fork() gives the child a copy of it (see setfork()).  The
+** segment is always a whole number of pages, so the increment is
+** rounded toward zero when shrinking and up when growing; new pages
+** are zeroed.
+**
+** @param increment  Number of bytes to add (or remove, if negative)
+**
+** @returns The previous end of the data segment, or NULL on failure
+*/
+void *sbrk( int32_t increment );
+
+/**
+** setfork - select how fork() copies the data segment
+**
+** usage:   old = setfork(mode);
+**
+** @param mode  The new mode (ForkCopy or ForkCOW)
+**
+** @returns The previous mode, or an error code
+*/
+int setfork( int mode );
+
 /**
 ** bogus - a bogus system call, for testing our syscall ISR
 **
@@ -0,0 +1,119 @@
+#ifndef MAIN10_C_
+#define MAIN10_C_
+
+#include "common.h"
+
+/**
+** User function main #10:  exit, spawn, wait, write, gettime
+**
+** Parallel throughput benchmark.  For k = 1 through MAIN10_MAX_K,
+** spawns k CPU-bound workers which each do the same fixed amount of
+** work, and times how long it takes for all of them to finish.  With
+** k CPUs available, k workers should finish in about the time one
+** does alone, so the throughput (units of work per second) should
+** grow almost linearly with k up to the number of CPUs, and level
+** off after that.  Nothing else should be competing for the CPUs
+** at User priority or above while this runs.
+**
+** Invoked as:  main10  x  [ units ]
+**   where x is the ID character
+**         units is the work done by each worker (default 2000)
+*/
+
+#define MAIN10_MAX_K    4
+#define MAIN10_SPINS    10000
+
+/**
+** work10 - a CPU-bound worker
+**
+** Does the requested number of units of work, and exits.
+**
+** Invoked as:  work10  units
+*/
+
+int32_t work10( int argc, char *argv[] ) {
+    volatile uint32_t spin = 0;
+
+    if( argc < 2 ) {
+        exit( -1 );
+    }
+
+    uint32_t units = str2int( argv[1], 10 );
+
+    for( uint32_t u = 0; u < units; ++u ) {
+        for( int i = 0; i < MAIN10_SPINS; ++i ) {
+            ++spin;
+        }
+    }
+
+    exit( 0 );
+
+    return( 42 );  // shut the compiler up!
+}
+
+int32_t main10( int argc, char *argv[] ) {
+    char ch = '@';      // default character to print
+    uint32_t units = 2000;  // default work per worker
+    char buf[128];
+    char ubuf[12];
+    char *args[3] = { "work10", ubuf, NULL };
+    uint32_t base = 0;  // elapsed time for one worker
+
+    // process the argument(s)
+    if( argc > 1 ) {
+        ch = argv[1][0];
+        if( argc > 2 ) {
+            units = str2int( argv[2], 10 );
+        }
+    }
+
+    // announce our presence
+    cwritech( ch );
+
+    sprint( ubuf, "%d", units );
+
+    for( int k = 1; k <= MAIN10_MAX_K; ++k ) {
+
+        // start them all, then wait for them all
+        time_t start = gettime();
+        int n = 0;
+        for( int i = 0; i < k; ++i ) {
+            if( spawn(work10, args) < 0 ) {
+                break;
+            }
+            ++n;
+        }
+        for( int i = 0; i < n; ++i ) {
+            (void) wait( NULL );
+        }
+        uint32_t elapsed = gettime() - start;
+
+        if( n < k ) {
+            sprint( buf, "\nmain%c: only %d of %d workers started\n",
+                    ch, n, k );
+            cwrites( buf );
+            exit( E_FAILURE );
+        }
+
+        if( elapsed == 0 ) {
+            elapsed = 1;
+        }
+        if( k == 1 ) {
+            base = elapsed;
+        }
+
+        // throughput in units/second; speedup in hundredths
+        uint32_t rate = (k * units * 1000) / elapsed;
+        uint32_t speedup = (base * k * 100) / elapsed;
+        sprint( buf, "main%c: %d workers, %d ms, %d units/sec,"
+                " speedup %d.%02d\n", ch, k, elapsed, rate,
+                speedup / 100, speedup % 100 );
+        cwrites( buf );
+    }
+
+    exit( 0 );
+
+    return( 42 );  // shut the compiler up!
+}
+
+#endif
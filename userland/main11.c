@@ -0,0 +1,115 @@
+#ifndef MAIN11_C_
+#define MAIN11_C_
+
+#include "common.h"
+
+/**
+** User function main #11:  exit, fork, kill, wait, sleep, write, gettime
+**
+** Fork storm benchmark.  Forks a large number of children, all of
+** which stay alive (asleep) until every one has been created; then
+** kills them all, and then collects them all.  Each phase is timed
+** separately, and reported as operations per second, so the cost of
+** fork() (including growing the process table), of exiting, and of
+** wait() can be seen as the table fills up.
+**
+** If memory runs out before all the children have been created, the
+** benchmark carries on with the ones it has.
+**
+** Invoked as:  main11  x  [ count ]
+**   where x is the ID character
+**         count is the number of children (default MAIN11_PROCS,
+**         which is also the most it will create)
+*/
+
+#define MAIN11_PROCS    5000
+
+// too big for the stack
+pid_t pids11[MAIN11_PROCS];
+
+/**
+** rate11 - report the throughput of one phase
+*/
+
+void rate11( char ch, const char *what, int n, uint32_t start ) {
+    char buf[128];
+
+    uint32_t elapsed = gettime() - start;
+    if( elapsed == 0 ) {
+        elapsed = 1;
+    }
+
+    sprint( buf, "main%c: %d %s in %d ms, %d/sec\n", ch, n, what,
+            elapsed, (n * 1000) / elapsed );
+    cwrites( buf );
+}
+
+int32_t main11( int argc, char *argv[] ) {
+    char ch = '@';      // default character to print
+    int count = MAIN11_PROCS;
+    char buf[128];
+
+    // process the argument(s)
+    if( argc > 1 ) {
+        ch = argv[1][0];
+        if( argc > 2 ) {
+            count = str2int( argv[2], 10 );
+            if( count > MAIN11_PROCS ) {
+                count = MAIN11_PROCS;
+            }
+        }
+    }
+
+    // announce our presence
+    cwritech( ch );
+    cwritech( '\n' );
+
+    // phase 1:  create them all
+    uint32_t start = gettime();
+    int n = 0;
+    for( int i = 0; i < count; ++i ) {
+        pid_t pid = fork();
+        if( pid < 0 ) {
+            // out of memory; work with what we have
+            break;
+        }
+        if( pid == 0 ) {
+            // child:  wait around to be killed
+            for(;;) {
+                sleep( SEC_TO_MS(60) );
+            }
+        }
+        pids11[n++] = pid;
+    }
+    rate11( ch, "forks", n, start );
+
+    if( n < count ) {
+        sprint( buf, "main%c: only %d of %d forks succeeded\n",
+                ch, n, count );
+        cwrites( buf );
+    }
+
+    // phase 2:  make them all exit
+    start = gettime();
+    int killed = 0;
+    for( int i = 0; i < n; ++i ) {
+        if( kill(pids11[i]) == E_SUCCESS ) {
+            ++killed;
+        }
+    }
+    rate11( ch, "exits", killed, start );
+
+    // phase 3:  collect them all
+    start = gettime();
+    int reaped = 0;
+    while( wait(NULL) > 0 ) {
+        ++reaped;
+    }
+    rate11( ch, "waits", reaped, start );
+
+    exit( 0 );
+
+    return( 42 );  // shut the compiler up!
+}
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef MAIN12_C_
+#define MAIN12_C_
+
+#include "common.h"
+
+/**
+** User function main #12:  exit, spawn, wait, sleep, write, getpid, pstat
+**
+** Context switch benchmark.  Each worker gives up the CPU (with
+** sleep(0)) a fixed number of times, and then reports the CPU time
+** it used per yield, in TSC cycles.  A worker that runs alone gets
+** the CPU straight back, so its cost is just the system call and the
+** scheduler; with several workers on every CPU, each yield is also a
+** switch to another process, including a change of address space.
+** The difference between the two is the cost of the switch itself.
+**
+** Nothing else should be competing for the CPUs at User priority or
+** above while this runs.
+**
+** Invoked as:  main12  x  [ yields  [ workers ] ]
+**   where x is the ID character
+**         yields is the number of yields each worker does (default
+**         MAIN12_YIELDS)
+**         workers is the number of workers in the second round
+**         (default MAIN12_PROCS, enough to put two on each of
+**         eight CPUs)
+*/
+
+#define MAIN12_YIELDS   20000
+#define MAIN12_PROCS    16
+#define MAIN12_TABLE    128
+
+/**
+** yield12 - a worker that just gives up the CPU
+**
+** Exits with the number of TSC cycles it used per yield, or -1 if it
+** couldn't find out.
+**
+** Invoked as:  yield12  yields
+*/
+
+int32_t yield12( int argc, char *argv[] ) {
+    pstat_t table[MAIN12_TABLE];
+
+    if( argc < 2 ) {
+        exit( -1 );
+    }
+
+    uint32_t yields = str2int( argv[1], 10 );
+    if( yields == 0 ) {
+        exit( -1 );
+    }
+
+    for( uint32_t i = 0; i < yields; ++i ) {
+        sleep( 0 );
+    }
+
+    // find our own CPU time
+    pid_t me = getpid();
+    int n = pstat( table, MAIN12_TABLE );
+    for( int i = 0; i < n; ++i ) {
+        if( table[i].pid == me ) {
+            // (no 64-bit division out here)
+            uint32_t cycles = table[i].runtime > 0xffffffffULL ?
+                              0xffffffff : (uint32_t) table[i].runtime;
+            exit( cycles / yields );
+        }
+    }
+
+    exit( -1 );
+
+    return( 42 );  // shut the compiler up!
+}
+
+/**
+** round12 - run one round of the benchmark
+**
+** @return the average cycles per yield, or -1 on failure
+*/
+
+int32_t round12( char ch, int workers, char *args[] ) {
+    char buf[128];
+    int n = 0;
+
+    for( int i = 0; i < workers; ++i ) {
+        if( spawn(yield12, args) < 0 ) {
+            break;
+        }
+        ++n;
+    }
+
+    int good = 0;
+    uint32_t sum = 0;
+    for( int i = 0; i < n; ++i ) {
+        int32_t status;
+        if( wait(&status) > 0 && status > 0 ) {
+            sum += status;
+            ++good;
+        }
+    }
+
+    if( n < workers || good < n ) {
+        sprint( buf, "main%c: %d of %d workers started, %d reported\n",
+                ch, n, workers, good );
+        cwrites( buf );
+    }
+
+    if( good == 0 ) {
+        return( -1 );
+    }
+
+    int32_t avg = sum / good;
+    sprint( buf, "main%c: %d worker(s), %d cycles/yield\n",
+            ch, workers, avg );
+    cwrites( buf );
+
+    return( avg );
+}
+
+int32_t main12( int argc, char *argv[] ) {
+    char ch = '@';      // default character to print
+    uint32_t yields = MAIN12_YIELDS;
+    int workers = MAIN12_PROCS;
+    char buf[128];
+    char ybuf[12];
+    char *args[3] = { "yield12", ybuf, NULL };
+
+    // process the argument(s)
+    if( argc > 1 ) {
+        ch = argv[1][0];
+        if( argc > 2 ) {
+            yields = str2int( argv[2], 10 );
+            if( argc > 3 ) {
+                workers = str2int( argv[3], 10 );
+            }
+        }
+    }
+
+    // announce our presence
+    cwritech( ch );
+    cwritech( '\n' );
+
+    sprint( ybuf, "%d", yields );
+
+    // first alone, then crowded
+    int32_t alone = round12( ch, 1, args );
+    int32_t crowded = round12( ch, workers, args );
+
+    if( alone < 0 || crowded < 0 ) {
+        exit( E_FAILURE );
+    }
+
+    sprint( buf, "main%c: context switch costs about %d cycles\n",
+            ch, crowded - alone );
+    cwrites( buf );
+
+    exit( 0 );
+
+    return( 42 );  // shut the compiler up!
+}
+
+#endif
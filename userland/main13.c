@@ -0,0 +1,139 @@
+#ifndef MAIN13_C_
+#define MAIN13_C_
+
+#include "common.h"
+
+/**
+** User function main #13:  exit, fork, kill, wait, sleep, write, gettime,
+**                          sbrk, setfork
+**
+** Copy-on-write fork benchmark.  Builds a large data segment with
+** sbrk() and writes to every page of it, and then times a batch of
+** forks in each fork mode.  The children only sleep until they are
+** killed, so they never write to the data segment; with ForkCopy each
+** fork copies every page, while with ForkCOW it only shares them.
+**
+** Invoked as:  main13  x  [ kbytes  [ count ] ]
+**   where x is the ID character
+**         kbytes is the size of the data segment (default MAIN13_KB)
+**         count is the number of forks in each batch (default
+**         MAIN13_PROCS, which is also the most it will do)
+*/
+
+#define MAIN13_KB       1024
+#define MAIN13_PROCS    50
+#define MAIN13_ROUNDS   3
+#define MAIN13_PAGE     4096    // (kmem.h isn't available out here)
+
+pid_t pids13[MAIN13_PROCS];
+
+/**
+** batch13 - time one batch of forks in the current fork mode
+**
+** @return the elapsed time in ms, or -1 if not every fork succeeded
+*/
+
+int32_t batch13( int count ) {
+    int n = 0;
+
+    uint32_t start = gettime();
+    for( int i = 0; i < count; ++i ) {
+        pid_t pid = fork();
+        if( pid < 0 ) {
+            break;
+        }
+        if( pid == 0 ) {
+            // child:  wait around to be killed
+            for(;;) {
+                sleep( SEC_TO_MS(60) );
+            }
+        }
+        pids13[n++] = pid;
+    }
+    uint32_t elapsed = gettime() - start;
+
+    // clean up after ourselves
+    for( int i = 0; i < n; ++i ) {
+        kill( pids13[i] );
+    }
+    while( wait(NULL) > 0 ) {
+        ;
+    }
+
+    return( n < count ? -1 : (int32_t) elapsed );
+}
+
+int32_t main13( int argc, char *argv[] ) {
+    char ch = '@';      // default character to print
+    uint32_t kbytes = MAIN13_KB;
+    int count = MAIN13_PROCS;
+    char buf[128];
+    const char *names[N_FORKMODES] = { "copy", "cow" };
+
+    // process the argument(s)
+    if( argc > 1 ) {
+        ch = argv[1][0];
+        if( argc > 2 ) {
+            kbytes = str2int( argv[2], 10 );
+            if( argc > 3 ) {
+                count = str2int( argv[3], 10 );
+                if( count < 1 || count > MAIN13_PROCS ) {
+                    count = MAIN13_PROCS;
+                }
+            }
+        }
+    }
+
+    // announce our presence
+    cwritech( ch );
+    cwritech( '\n' );
+
+    // build the data segment, and make sure every page is really ours
+    char *data = (char *) sbrk( kbytes * 1024 );
+    if( data == NULL ) {
+        sprint( buf, "main%c: sbrk(%d KB) failed\n", ch, kbytes );
+        cwrites( buf );
+        exit( E_FAILURE );
+    }
+    for( uint32_t i = 0; i < kbytes * 1024; i += MAIN13_PAGE ) {
+        data[i] = (char) i;
+    }
+
+    int old = setfork( ForkCopy );
+    if( old < 0 ) {
+        exit( E_FAILURE );
+    }
+
+    int32_t result = 0;
+    for( int mode = 0; mode < N_FORKMODES; ++mode ) {
+        setfork( mode );
+        uint32_t total = 0;
+        int rounds = 0;
+        while( rounds < MAIN13_ROUNDS ) {
+            int32_t elapsed = batch13( count );
+            if( elapsed < 0 ) {
+                sprint( buf, "main%c: %s forks ran out of memory\n",
+                        ch, names[mode] );
+                cwrites( buf );
+                result = E_FAILURE;
+                break;
+            }
+            total += elapsed;
+            ++rounds;
+        }
+        if( rounds > 0 ) {
+            // (in us, since a COW fork can take well under a ms)
+            sprint( buf, "main%c: %d KB, %s fork %d us\n", ch, kbytes,
+                    names[mode], (total * 1000) / (rounds * count) );
+            cwrites( buf );
+        }
+    }
+
+    setfork( old );
+
+    exit( result );
+
+    return( 42 );  // shut the compiler up!
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef MAIN7_C_
+#define MAIN7_C_
+
+#include "common.h"
+
+/**
+** User function main #7:  exit, spawn, kill, wait, sleep, write,
+**                         gettime, setpolicy
+**
+** Scheduler response-time workload.  For each scheduling policy in
+** turn, starts a number of CPU-bound "hog" processes, then acts as an
+** interactive process itself:  it repeatedly sleeps for a short "think
+** time" (standing in for waiting for a keystroke), and measures how
+** much later than requested it gets the CPU back.  At the end of each
+** run it kills the hogs and reports the 50th/90th/99th percentile and
+** maximum response times, in ms.
+**
+** Invoked as:  main7  x  [ hogs  [ samples  [ think ] ] ]
+**   where x is the ID character
+**         hogs is the number of CPU hogs (default 4)
+**         samples is the number of measurements per policy (default 100)
+**         think is the think time, in ms (default 20)
+*/
+
+#define MAIN7_MAX_HOGS      16
+#define MAIN7_MAX_SAMPLES   500
+
+/**
+** hog7 - a CPU-bound process; spins until it is killed
+**
+** Invoked as:  hog7
+*/
+
+int32_t hog7( int argc, char *argv[] ) {
+    volatile uint32_t spin = 0;
+
+    for(;;) {
+        ++spin;
+    }
+
+    return( 42 );  // shut the compiler up!
+}
+
+int32_t main7( int argc, char *argv[] ) {
+    static const char *names[N_POLICIES] = { "MLQ", "MLFQ" };
+    char ch = '7';      // default character to print
+    int hogs = 4;       // default number of hogs
+    int samples = 100;  // default number of measurements
+    int think = 20;     // default think time
+    char buf[128];
+    pid_t pids[MAIN7_MAX_HOGS];
+    time_t resp[MAIN7_MAX_SAMPLES];
+    char *args[2] = { "hog7", NULL };
+
+    // process the argument(s)
+    if( argc > 1 ) {
+        ch = argv[1][0];
+        if( argc > 2 ) {
+            hogs = str2int( argv[2], 10 );
+            if( argc > 3 ) {
+                samples = str2int( argv[3], 10 );
+                if( argc > 4 ) {
+                    think = str2int( argv[4], 10 );
+                }
+            }
+        }
+    }
+    if( hogs > MAIN7_MAX_HOGS ) {
+        hogs = MAIN7_MAX_HOGS;
+    }
+    if( samples > MAIN7_MAX_SAMPLES ) {
+        samples = MAIN7_MAX_SAMPLES;
+    } else if( samples < 1 ) {
+        samples = 1;
+    }
+
+    // announce our presence
+    cwritech( ch );
+
+    int old = setpolicy( SchedMLQ );
+
+    for( int policy = 0; policy < N_POLICIES; ++policy ) {
+
+        (void) setpolicy( policy );
+
+        // start the hogs
+        int n = 0;
+        for( int i = 0; i < hogs; ++i ) {
+            pid_t pid = spawn( hog7, args );
+            if( pid < 0 ) {
+                break;
+            }
+            pids[n++] = pid;
+        }
+
+        // act interactive
+        for( int i = 0; i < samples; ++i ) {
+            time_t start = gettime();
+            sleep( think );
+            // (one tick per ms)
+            resp[i] = gettime() - start - think;
+        }
+
+        // get rid of the hogs
+        for( int i = 0; i < n; ++i ) {
+            (void) kill( pids[i] );
+        }
+        for( int i = 0; i < n; ++i ) {
+            (void) wait( NULL );
+        }
+
+        // sort the measurements
+        for( int i = 1; i < samples; ++i ) {
+            time_t t = resp[i];
+            int j;
+            for( j = i; j > 0 && resp[j-1] > t; --j ) {
+                resp[j] = resp[j-1];
+            }
+            resp[j] = t;
+        }
+
+        sprint( buf, "\nmain%c: %s, %d hogs, %d samples: response ms"
+                " p50 %d p90 %d p99 %d max %d\n", ch, names[policy], n,
+                samples, resp[samples / 2], resp[(samples * 9) / 10],
+                resp[(samples * 99) / 100], resp[samples - 1] );
+        cwrites( buf );
+    }
+
+    (void) setpolicy( old );
+
+    exit( 0 );
+
+    return( 42 );  // shut the compiler up!
+}
+
+#endif
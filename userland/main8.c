@@ -0,0 +1,151 @@
+#ifndef MAIN8_C_
+#define MAIN8_C_
+
+#include "common.h"
+
+/**
+** User function main #8:  exit, spawn, wait, write, gettime, setweight
+**
+** Fair class share benchmark.  Spawns CPU-bound workers which put
+** themselves in the fair class with weights in the ratio 1:2:3:4,
+** lets them compete for a fixed interval, and compares the share of
+** the work each one got done with the share its weight entitles it to.
+** Nothing else should be competing for the CPU at User priority or
+** above while this runs.
+**
+** Invoked as:  main8  x  [ seconds ]
+**   where x is the ID character
+**         seconds is the length of the measurement (default 5)
+*/
+
+#define MAIN8_WORKERS   4
+
+/**
+** fair8 - a fair class worker
+**
+** Spins from the start time to the end time, counting units of work
+** done, and exits with the count as its status.
+**
+** Invoked as:  fair8  weight  start  end
+*/
+
+int32_t fair8( int argc, char *argv[] ) {
+    volatile uint32_t spin = 0;
+    int32_t count = 0;
+    time_t now;
+
+    if( argc < 4 ) {
+        exit( -1 );
+    }
+
+    uint32_t weight = str2int( argv[1], 10 );
+    time_t start = str2int( argv[2], 10 );
+    time_t end = str2int( argv[3], 10 );
+
+    if( setweight(0, weight) != E_SUCCESS ) {
+        exit( -1 );
+    }
+
+    // everyone is competing by the time 'start' arrives
+    while( (now = gettime()) < end ) {
+        for( int i = 0; i < 10000; ++i ) {
+            ++spin;
+        }
+        if( now >= start ) {
+            ++count;
+        }
+    }
+
+    exit( count );
+
+    return( 42 );  // shut the compiler up!
+}
+
+int32_t main8( int argc, char *argv[] ) {
+    char ch = '8';      // default character to print
+    int seconds = 5;    // default length of the measurement
+    char buf[128];
+    char wbuf[MAIN8_WORKERS][12], sbuf[12], ebuf[12];
+    char *args[MAIN8_WORKERS][5];
+    pid_t pids[MAIN8_WORKERS];
+    int32_t counts[MAIN8_WORKERS];
+    uint32_t weights[MAIN8_WORKERS];
+
+    // process the argument(s)
+    if( argc > 1 ) {
+        ch = argv[1][0];
+        if( argc > 2 ) {
+            seconds = str2int( argv[2], 10 );
+        }
+    }
+
+    // announce our presence
+    cwritech( ch );
+
+    // leave half a second for the workers to get going
+    time_t start = gettime() + SEC_TO_MS(1) / 2;
+    time_t end = start + SEC_TO_MS(seconds);
+    sprint( sbuf, "%d", start );
+    sprint( ebuf, "%d", end );
+
+    uint32_t total_weight = 0;
+    int n = 0;
+    for( int i = 0; i < MAIN8_WORKERS; ++i ) {
+        weights[i] = WEIGHT_DEFAULT * (i + 1);
+        sprint( wbuf[i], "%d", weights[i] );
+        args[i][0] = "fair8";
+        args[i][1] = wbuf[i];
+        args[i][2] = sbuf;
+        args[i][3] = ebuf;
+        args[i][4] = NULL;
+        pids[i] = spawn( fair8, args[i] );
+        if( pids[i] < 0 ) {
+            break;
+        }
+        counts[i] = 0;
+        total_weight += weights[i];
+        ++n;
+    }
+
+    // collect the results
+    int32_t total = 0;
+    for( int i = 0; i < n; ++i ) {
+        int32_t status;
+        pid_t pid = wait( &status );
+        for( int j = 0; j < n; ++j ) {
+            if( pids[j] == pid ) {
+                counts[j] = status;
+                total += status > 0 ? status : 0;
+            }
+        }
+    }
+
+    if( total == 0 ) {
+        sprint( buf, "\nmain%c: no work was done\n", ch );
+        cwrites( buf );
+        exit( E_FAILURE );
+    }
+
+    // shares in tenths of a percent
+    for( int i = 0; i < n; ++i ) {
+        uint32_t c = counts[i] > 0 ? counts[i] : 0, t = total;
+        // (keep c * 1000 within 32 bits)
+        while( c > 4000000 ) {
+            c >>= 1;
+            t >>= 1;
+        }
+        int want = (weights[i] * 1000) / total_weight;
+        int got = (c * 1000) / t;
+        int off = got > want ? got - want : want - got;
+        sprint( buf, "main%c: weight %d want %d.%d%% got %d.%d%%"
+                " (off by %d.%d)\n", ch, weights[i], want / 10, want % 10,
+                got / 10, got % 10, off / 10, off % 10 );
+        cwrites( buf );
+    }
+
+    exit( 0 );
+
+    return( 42 );  // shut the compiler up!
+}
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef MAIN9_C_
+#define MAIN9_C_
+
+#include "common.h"
+
+/**
+** User function main #9:  exit, spawn, kill, wait, sleep, write,
+**                         gettime, setdeadline, edfstat
+**
+** EDF class deadline benchmark.  Starts a number of CPU-bound "load"
+** processes, then a set of periodic real-time tasks in the EDF class
+** whose total density is well within the admission limit; each task
+** does (almost) its declared runtime of work in every period.  While
+** they run, checks that a request which would overload the class is
+** refused.  At the end, each task reports its jobs and deadline
+** misses; under EDF, there should be no misses however many load
+** processes there are.
+**
+** Invoked as:  main9  x  [ load  [ seconds ] ]
+**   where x is the ID character
+**         load is the number of CPU hogs (default 4)
+**         seconds is the length of the measurement (default 5)
+*/
+
+#define MAIN9_MAX_LOAD  16
+#define MAIN9_TASKS     3
+
+/**
+** load9 - a CPU-bound process; spins until it is killed
+**
+** Invoked as:  load9
+*/
+
+int32_t load9( int argc, char *argv[] ) {
+    volatile uint32_t spin = 0;
+
+    for(;;) {
+        ++spin;
+    }
+
+    return( 42 );  // shut the compiler up!
+}
+
+/**
+** edf9 - a periodic EDF task
+**
+** Works for runtime - 1 ticks at the start of each period, and sleeps
+** for the rest of it.  Reports its results and exits with its number
+** of deadline misses as its status.
+**
+** Invoked as:  edf9  x  runtime  period  deadline  end
+*/
+
+int32_t edf9( int argc, char *argv[] ) {
+    volatile uint32_t spin = 0;
+    char buf[128];
+    edfstat_t st;
+
+    if( argc < 6 ) {
+        exit( -1 );
+    }
+
+    char ch = argv[1][0];
+    uint32_t runtime = str2int( argv[2], 10 );
+    uint32_t period = str2int( argv[3], 10 );
+    uint32_t deadline = str2int( argv[4], 10 );
+    time_t end = str2int( argv[5], 10 );
+
+    status_t status = setdeadline( runtime, period, deadline );
+    if( status != E_SUCCESS ) {
+        sprint( buf, "\nmain%c: setdeadline(%d,%d,%d) failed, %d\n",
+                ch, runtime, period, deadline, status );
+        cwrites( buf );
+        exit( -1 );
+    }
+
+    // our first job was released when we joined the class
+    time_t release = gettime();
+
+    while( release < end ) {
+
+        // do this job's work (one tick per ms)
+        while( gettime() - release < runtime - 1 ) {
+            ++spin;
+        }
+
+        // wait for the next one; sleeping ends the job
+        release += period;
+        time_t now = gettime();
+        sleep( release > now ? release - now : 1 );
+    }
+
+    (void) edfstat( 0, &st );
+    sprint( buf, "main%c: (%d,%d,%d) jobs %d misses %d\n", ch,
+            st.runtime, st.period, st.deadline, st.jobs, st.misses );
+    cwrites( buf );
+
+    exit( st.misses );
+
+    return( 42 );  // shut the compiler up!
+}
+
+int32_t main9( int argc, char *argv[] ) {
+    static const uint32_t params[MAIN9_TASKS][3] = {
+        // runtime, period, deadline:  a total density of 46.7%
+        { 2, 10, 10 }, { 5, 40, 30 }, { 10, 100, 100 }
+    };
+    char ch = '9';      // default character to print
+    int load = 4;       // default number of hogs
+    int seconds = 5;    // default length of the measurement
+    char buf[128];
+    char cbuf[2], pbuf[MAIN9_TASKS][3][12], ebuf[12];
+    char *args[MAIN9_TASKS][7];
+    char *largs[2] = { "load9", NULL };
+    pid_t pids[MAIN9_MAX_LOAD];
+
+    // process the argument(s)
+    if( argc > 1 ) {
+        ch = argv[1][0];
+        if( argc > 2 ) {
+            load = str2int( argv[2], 10 );
+            if( argc > 3 ) {
+                seconds = str2int( argv[3], 10 );
+            }
+        }
+    }
+    if( load > MAIN9_MAX_LOAD ) {
+        load = MAIN9_MAX_LOAD;
+    }
+
+    // announce our presence
+    cwritech( ch );
+
+    // start the load
+    int n = 0;
+    for( int i = 0; i < load; ++i ) {
+        pid_t pid = spawn( load9, largs );
+        if( pid < 0 ) {
+            break;
+        }
+        pids[n++] = pid;
+    }
+
+    // start the real-time tasks
+    cbuf[0] = ch;
+    cbuf[1] = '\0';
+    time_t end = gettime() + SEC_TO_MS(seconds);
+    sprint( ebuf, "%d", end );
+    int tasks = 0;
+    for( int i = 0; i < MAIN9_TASKS; ++i ) {
+        args[i][0] = "edf9";
+        args[i][1] = cbuf;
+        for( int j = 0; j < 3; ++j ) {
+            sprint( pbuf[i][j], "%d", params[i][j] );
+            args[i][2+j] = pbuf[i][j];
+        }
+        args[i][5] = ebuf;
+        args[i][6] = NULL;
+        if( spawn(edf9,args[i]) >= 0 ) {
+            ++tasks;
+        }
+    }
+
+    // once they have been admitted, there is no room for a task
+    // wanting 90% of the CPU
+    sleep( 100 );
+    status_t status = setdeadline( 9, 10, 10 );
+    if( status == E_SUCCESS ) {
+        (void) setdeadline( 0, 0, 0 );
+    }
+    sprint( buf, "\nmain%c: overload request %s (%d)\n", ch,
+            status == E_OVERLOAD ? "refused" : "NOT REFUSED", status );
+    cwrites( buf );
+
+    // collect the real-time tasks
+    int32_t misses = 0;
+    for( int i = 0; i < tasks; ++i ) {
+        int32_t st;
+        // (the load processes never exit on their own)
+        (void) wait( &st );
+        misses += st > 0 ? st : 0;
+    }
+
+    // get rid of the load
+    for( int i = 0; i < n; ++i ) {
+        (void) kill( pids[i] );
+    }
+    for( int i = 0; i < n; ++i ) {
+        (void) wait( NULL );
+    }
+
+    sprint( buf, "main%c: %d tasks, %d hogs, %d deadline misses\n",
+            ch, tasks, n, misses );
+    cwrites( buf );
+
+    exit( 0 );
+
+    return( 42 );  // shut the compiler up!
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef USER_O_C_
+#define USER_O_C_
+
+#include "common.h"
+
+/**
+** User function O:  exit, fork, wait, sleep, write, kmstat
+**
+** Fork storm:  forks a burst of short-lived children, then reaps
+** them all, and reports how many pages of kernel memory were in use
+** before the storm, at its height, and after it has drained.  The
+** difference between the last two is the memory the kernel gave
+** back to the page allocator.
+**
+** The PCBs and queue nodes for the children come from slab caches,
+** so it also reports the pages held by slabs at each point, how many
+** of those are in empty slabs each cache keeps in reserve, and how
+** many emptied slabs were given back during the storm.
+**
+** Invoked as:  userO  x  [ n ]
+**   where x is the ID character
+**         n is the number of children to create (default 20)
+*/
+
+int32_t userO( int argc, char *argv[] ) {
+    char ch = 'o';      // default character to print
+    int count = 20;     // default number of children
+    char buf[128];
+    kmstat_t before, during, after;
+
+    // process the argument(s)
+    if( argc > 1 ) {
+        ch = argv[1][0];
+        if( argc > 2 ) {
+            count = str2int( argv[2], 10 );
+        }
+    }
+
+    // announce our presence
+    cwritech( ch );
+
+    (void) kmstat( &before );
+
+    // create the storm
+    int n = 0;
+    for( int i = 0; i < count; ++i ) {
+        pid_t pid = fork();
+        if( pid < 0 ) {
+            // out of processes; work with what we have
+            break;
+        }
+        if( pid == 0 ) {
+            // child:  linger briefly so they all overlap, then go away
+            sleep( SEC_TO_MS(1) );
+            exit( 0 );
+        }
+        ++n;
+    }
+
+    (void) kmstat( &during );
+
+    // let it drain
+    for( int i = 0; i < n; ++i ) {
+        (void) wait( NULL );
+    }
+
+    (void) kmstat( &after );
+
+    sprint( buf, "\nuser%c: %d children, pages in use %d -> %d -> %d"
+            " (peak %d), %d returned\n", ch, n, before.pages_used,
+            during.pages_used, after.pages_used, after.pages_peak,
+            during.pages_used - after.pages_used );
+    cwrites( buf );
+    sprint( buf, "user%c: slab pages %d -> %d -> %d (%d in empty slabs),"
+            " %d slabs returned\n", ch, before.slab_pages,
+            during.slab_pages, after.slab_pages, after.slab_empty,
+            after.slab_reclaims - before.slab_reclaims );
+    cwrites( buf );
+
+    exit( 0 );
+
+    return( 42 );  // shut the compiler up!
+}
+
+#endif
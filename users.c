@@ -39,6 +39,16 @@ int32_t idle( int, char *[] );
 int32_t main1( int, char *[] ); int32_t main2( int, char *[] );
 int32_t main3( int, char *[] ); int32_t main4( int, char *[] );
 int32_t main5( int, char *[] ); int32_t main6( int, char *[] );
+int32_t main7( int, char *[] ); int32_t hog7( int, char *[] );
+int32_t main8( int, char *[] ); int32_t fair8( int, char *[] );
+int32_t main9( int, char *[] ); int32_t edf9( int, char *[] );
+int32_t load9( int, char *[] );
+int32_t main10( int, char *[] ); int32_t work10( int, char *[] );
+int32_t main11( int, char *[] );
+void rate11( char, const char *, int, uint32_t );
+int32_t main12( int, char *[] ); int32_t yield12( int, char *[] );
+int32_t round12( char, int, char *[] );
+int32_t main13( int, char *[] ); int32_t batch13( int );
 
 int32_t userA( int, char *[] ); int32_t userB( int, char *[] );
 int32_t userC( int, char *[] ); int32_t userD( int, char *[] );
@@ -104,6 +114,10 @@ int32_t userY( int, char *[] ); int32_t userZ( int, char *[] );
 #include "userland/userZ.c"
 #endif
 
+#if defined(SPAWN_O)
+#include "userland/userO.c"
+#endif
+
 #if defined(SPAWN_P)
 #include "userland/userP.c"
 #endif
@@ -129,6 +143,34 @@ int32_t userY( int, char *[] ); int32_t userZ( int, char *[] );
 #include "userland/userV.c"
 #endif
 
+#if defined(SPAWN_SCHED)
+#include "userland/main7.c"
+#endif
+
+#if defined(SPAWN_FAIR)
+#include "userland/main8.c"
+#endif
+
+#if defined(SPAWN_EDF)
+#include "userland/main9.c"
+#endif
+
+#if defined(SPAWN_SMP)
+#include "userland/main10.c"
+#endif
+
+#if defined(SPAWN_FORKS)
+#include "userland/main11.c"
+#endif
+
+#if defined(SPAWN_CSW)
+#include "userland/main12.c"
+#endif
+
+#if defined(SPAWN_COW)
+#include "userland/main13.c"
+#endif
+
 /*
 ** System processes - these should always be included here
 */
@@ -63,6 +63,10 @@
 // System calls in this system:   exit, fork, exec, kill, wait, sleep,
 //  read, write, sysstat, getpid, getppid, gettime
 //
+// userO also uses kmstat, main7 uses setpolicy, main8 uses setweight,
+// main9 uses setdeadline and edfstat, main12 uses pstat, and main13
+// uses sbrk and setfork, which aren't shown in the matrix.
+//
 // There is also a "bogus" system call which attempts to use an invalid
 // system call code; this should be caught by the syscall handler and
 // the process should be terminated.
@@ -83,10 +87,18 @@
 // main4    X    X    X    .     .    X    .     X    .   X    .    .    .
 // main5    X    X    X    .     .    .    .     X    .   .    .    .    .
 // main6    X    X    X    X     X    X    .     X    .   X    .    .    .
+// main7    X    X    X    X     X    X    .     X    .   .    .    X    .
+// main8    X    X    X    .     X    .    .     X    .   .    .    X    .
+// main9    X    X    X    X     X    X    .     X    .   .    .    X    .
+// main10   X    X    X    .     X    .    .     X    .   .    .    X    .
+// main11   X    X    .    X     X    X    .     X    .   .    .    X    .
+// main12   X    X    X    .     X    X    .     X    .   X    .    .    .
+// main13   X    X    .    X     X    X    .     X    .   .    .    X    .
 //
 // userH    X    X    X    .     .    X    .     X    .   .    .    .    .
 // userI    X    X    X    X     .    X    .     X    .   X    .    .    .
 // userJ    X    X    X    .     .    .    .     X    .   X    .    .    .
+// userO    X    X    .    .     X    X    .     X    .   .    .    .    .
 // userP    X    .    .    .     .    X    .     X    X   .    .    X    .
 // userQ    X    .    .    .     .    .    .     X    .   .    .    .    X
 // userR    X    .    .    .     .    X    X     X    .   .    .    .    .
@@ -124,7 +136,7 @@
 #define SPAWN_L
 #define SPAWN_M
 #define SPAWN_N
-// no user O
+#define SPAWN_O
 #define SPAWN_P
 #define SPAWN_Q
 #define SPAWN_R
@@ -138,6 +150,26 @@
 // should never be spawned directly by init().
 //
 
+//
+// Benchmarks.  These change system-wide settings while they run and
+// take a while, so they are not spawned by default.
+//
+// SPAWN_SCHED   main7 - response times under each scheduling policy
+// SPAWN_FAIR    main8 - CPU shares in the fair class vs. their weights
+// SPAWN_EDF     main9 - EDF class deadline misses under load
+// SPAWN_SMP     main10 - throughput scaling with 1 to 4 CPUs
+// SPAWN_FORKS   main11 - fork/exit/wait throughput with 5000 processes
+// SPAWN_CSW     main12 - context switch cost
+// SPAWN_COW     main13 - fork latency with and without copy-on-write
+//
+// #define SPAWN_SCHED
+// #define SPAWN_FAIR
+// #define SPAWN_EDF
+// #define SPAWN_SMP
+// #define SPAWN_FORKS
+// #define SPAWN_CSW
+// #define SPAWN_COW
+
 /*
 ** Prototypes for externally-visible routines
 */
@@ -0,0 +1,518 @@
+/**
+** @file vm.c
+**
+** @author CSCI-452 class of 20215
+**
+** Virtual memory module implementation
+*/
+
+#define SP_KERNEL_SRC
+
+#include "common.h"
+
+#include "x86arch.h"
+#include "kmem.h"
+#include "process.h"
+#include "scheduler.h"
+#include "syscalls.h"
+#include "vm.h"
+
+/*
+** PRIVATE DEFINITIONS
+*/
+
+// a process' page table for the window
+
+#define PTABLE_OF(pcb)  ((uint32_t *) ((pcb)->pgdir[PDX(VM_WINDOW)] & PTE_FRAME))
+
+// the number of processes sharing a data page frame, kept in its
+// kmem owner tag
+
+#define REFS(f)         ((uint32_t) _km_page_owner( (void *) (f) ))
+#define SET_REFS(f,n)   _km_page_set_owner( (void *) (f), 1, (void *) (n) )
+
+/*
+** PRIVATE DATA TYPES
+*/
+
+/*
+** PRIVATE GLOBAL VARIABLES
+*/
+
+// CR4 bits every CPU must set before enabling paging
+static uint32_t _vm_cr4;
+
+// PTE_G if this processor supports global pages, otherwise 0
+static uint32_t _vm_global;
+
+// how fork() copies the data segment
+static int _vm_forkmode = ForkCOW;
+
+// copy-on-write statistics
+static uint32_t _vm_shared;     // pages shared by fork()
+static uint32_t _vm_copied;     // copies made on write faults
+
+/*
+** PUBLIC GLOBAL VARIABLES
+*/
+
+// the template page directory
+uint32_t *_vm_kernel_pd;
+
+/*
+** PRIVATE FUNCTIONS
+*/
+
+/**
+** _vm_enable() - turn on paging on this CPU, using the kernel
+**                page directory
+**
+** Everything we could be executing is identity mapped, so the
+** instruction after the CR0 write is found at the same address.
+*/
+static void _vm_enable( void ) {
+
+    __set_cr4( __get_cr4() | _vm_cr4 );
+    __set_cr3( (uint32_t) _vm_kernel_pd );
+
+    // WP makes read-only pages read-only in ring 0, too
+    __set_cr0( __get_cr0() | CR0_PG | CR0_WP );
+}
+
+/**
+** _vm_flush() - discard this CPU's TLB entries for a process' window,
+**               if it is the one we are using
+**
+** @param pcb   The process
+*/
+static void _vm_flush( pcb_t *pcb ) {
+
+    if( __get_cr3() == (uint32_t) pcb->pgdir ) {
+        // (global entries survive this)
+        __set_cr3( (uint32_t) pcb->pgdir );
+    }
+}
+
+/**
+** _vm_unref() - drop one process' claim on a data page frame
+**
+** @param frame  The frame
+*/
+static void _vm_unref( uint32_t frame ) {
+    uint32_t refs = REFS( frame );
+
+    if( refs > 1 ) {
+        SET_REFS( frame, refs - 1 );
+    } else {
+        SET_REFS( frame, 0 );
+        _km_page_free( (void *) frame );
+    }
+}
+
+/**
+** _vm_unshare() - give a process its own copy of a shared data page
+**
+** If nobody else is still sharing the page, it is just made writable.
+**
+** @param pcb   The process
+** @param addr  An address in the page
+**
+** @return status of the operation
+*/
+static status_t _vm_unshare( pcb_t *pcb, uint32_t addr ) {
+    uint32_t *pte = &PTABLE_OF(pcb)[PTX(addr)];
+
+    if( (*pte & PTE_COW) == 0 ) {
+        return( E_SUCCESS );
+    }
+
+    uint32_t frame = *pte & PTE_FRAME;
+
+    if( REFS(frame) > 1 ) {
+        void *copy = _km_page_alloc( 1 );
+        if( copy == NULL ) {
+            return( E_NO_MEM );
+        }
+        __memcpy( copy, (void *) frame, SZ_PAGE );
+        SET_REFS( copy, 1 );
+        _vm_unref( frame );
+        *pte = (uint32_t) copy | PTE_RW | PTE_P;
+        ++_vm_copied;
+    } else {
+        *pte = frame | PTE_RW | PTE_P;
+    }
+
+    if( __get_cr3() == (uint32_t) pcb->pgdir ) {
+        __invlpg( (void *) addr );
+    }
+
+    return( E_SUCCESS );
+}
+
+/**
+** _vm_fault_isr() - page fault handler
+**
+** A write to a shared data page gets the process a copy of its own.
+** Anything else is a bug in the process, which is terminated.
+**
+** @param vector  Interrupt vector number
+** @param code    Error code pushed by the CPU
+*/
+static void _vm_fault_isr( int vector, int code ) {
+    uint32_t addr = __get_cr2();
+    pcb_t *pcb = _current;
+
+    if( (code & (PF_PRESENT | PF_WRITE)) == (PF_PRESENT | PF_WRITE) &&
+            addr >= VM_DATA && addr < pcb->brk &&
+            _vm_unshare(pcb, addr) == E_SUCCESS ) {
+        return;
+    }
+
+    __cio_printf( "*** pid %d: page fault at %08x (code %x), EIP %08x\n",
+                  pcb->pid, addr, code, REG(pcb,eip) );
+
+    pcb->exit_status = E_KILLED;
+    _perform_exit( pcb );
+    _dispatch();
+}
+
+/*
+** PUBLIC FUNCTIONS
+*/
+
+/**
+** _vm_init() - build the kernel page directory and enable paging
+**              on the bootstrap CPU
+*/
+void _vm_init( void ) {
+    uint32_t regs[4];
+
+    __cio_puts( " VM:" );
+
+    // 4MB pages are required; global pages are just nice to have
+    __cpuid( 1, regs );
+    if( (regs[3] & CPUID_1_EDX_PSE) == 0 ) {
+        _kpanic( "_vm_init: no 4MB page support" );
+    }
+    _vm_cr4 = CR4_PSE;
+    if( (regs[3] & CPUID_1_EDX_PGE) != 0 ) {
+        _vm_cr4 |= CR4_PGE;
+        _vm_global = PTE_G;
+    }
+
+    _vm_kernel_pd = (uint32_t *) _km_page_alloc_zero( 1 );
+    assert( _vm_kernel_pd != NULL );
+
+    // map everything but the user window
+    for( uint32_t i = 0; i < N_PDES; ++i ) {
+        uint32_t addr = i << PDE_SHIFT;
+
+        if( addr == VM_WINDOW ) {
+            continue;
+        }
+
+        uint32_t pde = addr | PTE_PS | PTE_RW | PTE_P | _vm_global;
+        if( addr >= VM_MMIO ) {
+            pde |= PTE_PCD | PTE_PWT;
+        }
+        _vm_kernel_pd[i] = pde;
+    }
+
+    _vm_enable();
+
+    __install_isr( INT_VEC_PAGE_FAULT, _vm_fault_isr );
+
+    __cio_puts( " done" );
+}
+
+/**
+** _vm_cpu_init() - enable paging on an application processor
+*/
+void _vm_cpu_init( void ) {
+
+    _vm_enable();
+}
+
+/**
+** _vm_create() - create the address space for a process
+**
+** @param pcb   The process
+**
+** @return status of the creation attempt
+*/
+status_t _vm_create( pcb_t *pcb ) {
+
+    uint32_t *pd = (uint32_t *) _km_page_alloc( 1 );
+    if( pd == NULL ) {
+        return( E_NO_MEM );
+    }
+
+    uint32_t *pt = (uint32_t *) _km_page_alloc_zero( 1 );
+    if( pt == NULL ) {
+        _km_page_free( pd );
+        return( E_NO_MEM );
+    }
+
+    // map the stack at the top of the window
+    uint32_t frame = (uint32_t) pcb->stack;
+    for( int i = 0; i < STACK_PAGES; ++i ) {
+        pt[PTX(VM_STACK) + i] = frame | PTE_RW | PTE_P;
+        frame += SZ_PAGE;
+    }
+
+    // everything else is the same for every process
+    __memcpy( pd, _vm_kernel_pd, SZ_PAGE );
+    pd[PDX(VM_WINDOW)] = (uint32_t) pt | PTE_RW | PTE_P;
+
+    pcb->pgdir = pd;
+    pcb->brk = VM_DATA;
+
+    return( E_SUCCESS );
+}
+
+/**
+** _vm_fork() - create the address space for a new child process
+**
+** @param parent  The parent process
+** @param child   The new child
+**
+** @return status of the creation attempt
+*/
+status_t _vm_fork( pcb_t *parent, pcb_t *child ) {
+
+    status_t status = _vm_create( child );
+    if( status != E_SUCCESS ) {
+        return( status );
+    }
+
+    uint32_t *ppt = PTABLE_OF( parent );
+    uint32_t *cpt = PTABLE_OF( child );
+
+    for( uint32_t a = VM_DATA; a < parent->brk; a += SZ_PAGE ) {
+        uint32_t *pte = &ppt[PTX(a)];
+        uint32_t frame = *pte & PTE_FRAME;
+
+        if( _vm_forkmode == ForkCOW ) {
+
+            // both sides lose write access until they unshare it
+            *pte = frame | PTE_COW | PTE_P;
+            SET_REFS( frame, REFS(frame) + 1 );
+            cpt[PTX(a)] = *pte;
+            ++_vm_shared;
+
+        } else {
+
+            void *copy = _km_page_alloc( 1 );
+            if( copy == NULL ) {
+                // (nothing of the parent's has changed)
+                _vm_destroy( child );
+                return( E_NO_MEM );
+            }
+            __memcpy( copy, (void *) frame, SZ_PAGE );
+            SET_REFS( copy, 1 );
+            cpt[PTX(a)] = (uint32_t) copy | PTE_RW | PTE_P;
+
+        }
+
+        // (so that _vm_destroy() knows how far we got)
+        child->brk = a + SZ_PAGE;
+    }
+
+    // the parent is normally the current process, and may have
+    // writable entries for these pages in the TLB
+    if( _vm_forkmode == ForkCOW ) {
+        _vm_flush( parent );
+    }
+
+    return( E_SUCCESS );
+}
+
+/**
+** _vm_setfork() - select how fork() copies the data segment
+**
+** @param mode  The new mode (ForkCopy or ForkCOW)
+**
+** @return the previous mode, or E_BAD_PARAM
+*/
+int _vm_setfork( int mode ) {
+    int old = _vm_forkmode;
+
+    if( mode < 0 || mode >= N_FORKMODES ) {
+        return( E_BAD_PARAM );
+    }
+
+    _vm_forkmode = mode;
+
+    return( old );
+}
+
+/**
+** _vm_sbrk() - grow or shrink a process' data segment
+**
+** @param pcb        The process
+** @param increment  Number of bytes to add (or remove, if negative)
+**
+** @return the previous end of the data segment, or 0 on failure
+*/
+uint32_t _vm_sbrk( pcb_t *pcb, int32_t increment ) {
+    uint32_t old = pcb->brk;
+    uint32_t *pt = PTABLE_OF( pcb );
+
+    // the segment is always a whole number of pages
+    // (done unsigned, so that huge increments can't overflow)
+    if( increment >= 0 ) {
+        uint32_t grow = ((uint32_t) increment + SZ_PAGE - 1) & ~(SZ_PAGE - 1);
+        if( grow > VM_DATA_MAX - old ) {
+            return( 0 );
+        }
+        increment = grow;
+    } else {
+        uint32_t shrink = (0U - (uint32_t) increment) & ~(SZ_PAGE - 1);
+        if( shrink > old - VM_DATA ) {
+            return( 0 );
+        }
+        increment = -(int32_t) shrink;
+    }
+
+    // growing?
+    while( pcb->brk < old + increment ) {
+        void *page = _km_page_alloc_zero( 1 );
+        if( page == NULL ) {
+            // give back whatever we got
+            (void) _vm_sbrk( pcb, old - pcb->brk );
+            return( 0 );
+        }
+        SET_REFS( page, 1 );
+        pt[PTX(pcb->brk)] = (uint32_t) page | PTE_RW | PTE_P;
+        pcb->brk += SZ_PAGE;
+    }
+
+    // shrinking?
+    while( pcb->brk > old + increment ) {
+        pcb->brk -= SZ_PAGE;
+        _vm_unref( pt[PTX(pcb->brk)] & PTE_FRAME );
+        pt[PTX(pcb->brk)] = 0;
+    }
+
+    if( increment < 0 ) {
+        _vm_flush( pcb );
+    }
+
+    return( old );
+}
+
+/**
+** _vm_exec() - discard a process' data segment, as part of exec()
+**
+** @param pcb   The process
+*/
+void _vm_exec( pcb_t *pcb ) {
+
+    (void) _vm_sbrk( pcb, VM_DATA - pcb->brk );
+}
+
+/**
+** _vm_touch() - make sure none of a range of a process' pages are
+**               shared, so that the kernel can write into them
+**
+** @param pcb     The process (must be current on this CPU)
+** @param addr    Start of the range
+** @param length  Its length, in bytes
+**
+** @return status of the operation (only fails if memory runs out)
+*/
+status_t _vm_touch( pcb_t *pcb, const void *addr, uint32_t length ) {
+    uint32_t first = (uint32_t) addr;
+    uint32_t end = first + length;
+
+    // only the data segment can be shared
+    if( first < VM_DATA ) {
+        first = VM_DATA;
+    }
+    if( end > pcb->brk || end < (uint32_t) addr ) {
+        end = pcb->brk;
+    }
+
+    for( uint32_t a = first & PTE_FRAME; a < end; a += SZ_PAGE ) {
+        if( _vm_unshare(pcb, a) != E_SUCCESS ) {
+            return( E_NO_MEM );
+        }
+    }
+
+    return( E_SUCCESS );
+}
+
+/**
+** _vm_destroy() - release a process' address space
+**
+** A process may be cleaned up by the CPU it last ran on before that
+** CPU has switched to another process; if so, we move it to the kernel
+** page directory first.  No other CPU can be using this one, because
+** each CPU switches away from a process before it releases the kernel
+** lock (see __isr_restore).
+**
+** @param pcb   The process
+*/
+void _vm_destroy( pcb_t *pcb ) {
+    uint32_t *pd = pcb->pgdir;
+
+    if( pd == NULL ) {
+        return;
+    }
+
+    if( __get_cr3() == (uint32_t) pd ) {
+        __set_cr3( (uint32_t) _vm_kernel_pd );
+    }
+
+    uint32_t *pt = PTABLE_OF( pcb );
+    for( uint32_t a = VM_DATA; a < pcb->brk; a += SZ_PAGE ) {
+        _vm_unref( pt[PTX(a)] & PTE_FRAME );
+    }
+
+    _km_page_free( pt );
+    _km_page_free( pd );
+    pcb->pgdir = NULL;
+    pcb->brk = VM_DATA;
+}
+
+/**
+** _vm_kaddr() - translate an address in a process' address space
+**               into one the kernel can use from any address space
+**
+** Only the window differs between address spaces.  The stack is
+** contiguous, so that is simple arithmetic; data pages are looked up.
+**
+** @param pcb   The process
+** @param addr  The address, as the process sees it
+**
+** @return the equivalent identity-mapped address, or NULL
+*/
+void *_vm_kaddr( pcb_t *pcb, const void *addr ) {
+    uint32_t a = (uint32_t) addr;
+
+    if( a < VM_WINDOW || a >= VM_WINDOW_END ) {
+        return( (void *) a );
+    }
+
+    if( a >= VM_STACK ) {
+        return( (void *) (a - VM_STACK + (uint32_t) pcb->stack) );
+    }
+
+    if( a >= pcb->brk || _vm_unshare(pcb, a) != E_SUCCESS ) {
+        return( NULL );
+    }
+
+    uint32_t frame = PTABLE_OF(pcb)[PTX(a)] & PTE_FRAME;
+
+    return( (void *) (frame + (a & ~PTE_FRAME)) );
+}
+
+/**
+** _vm_dump() - dump the copy-on-write statistics to the console
+*/
+void _vm_dump( void ) {
+
+    __cio_printf( "VM: fork mode %s, %d pages shared, %d copied on write\n",
+                  _vm_forkmode == ForkCOW ? "COW" : "copy",
+                  _vm_shared, _vm_copied );
+}
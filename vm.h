@@ -0,0 +1,238 @@
+/*
+** @file vm.h
+**
+** @author CSCI-452 class of 20215
+**
+** Virtual memory module declarations
+**
+** Paging is enabled with a template page directory that maps all
+** of the 32-bit physical address space one-to-one using 4MB pages,
+** marked global so that reloading CR3 doesn't flush them from the
+** TLB.  Every process gets its own copy of that directory, in which
+** a single 4MB slot (the "user window") is replaced by a page table
+** of the process' own; its stack is mapped at the top of the window,
+** so every process sees its stack at the same virtual address.  The
+** bottom of the window holds the process' data segment, which it can
+** grow and shrink with sbrk().
+**
+** Because the kernel, user code, and static user data all live in the
+** identity-mapped part of the address space, only the window differs
+** from one process to another.  The kernel reaches a process' window
+** through the identity mapping of the underlying page frames; see
+** _vm_kaddr() and CTX().
+**
+** The stack is always copied by fork().  Data segment pages may
+** instead be shared by parent and child (see setfork()); a shared page
+** is mapped read-only with PTE_COW set in every process that shares
+** it, and the first process to write to it gets a copy of its own from
+** the page fault handler.  The number of processes sharing a data page
+** frame is kept in its kmem owner tag.  Kernel code runs in ring 0
+** like everything else, so CR0.WP is set to make those writes fault;
+** the kernel itself must not fault in an ISR, so it unshares a page
+** before writing into it on a process' behalf (_vm_touch()).
+*/
+
+#ifndef VM_H_
+#define VM_H_
+
+/*
+** General (C and/or assembly) definitions
+*/
+
+// page directory and page table entry bits
+
+#define PTE_P       0x001       // present
+#define PTE_RW      0x002       // writable
+#define PTE_US      0x004       // user-accessible
+#define PTE_PWT     0x008       // write-through
+#define PTE_PCD     0x010       // cache disabled
+#define PTE_A       0x020       // accessed
+#define PTE_D       0x040       // dirty (4KB and 4MB pages only)
+#define PTE_PS      0x080       // 4MB page (directory entries only)
+#define PTE_G       0x100       // global
+#define PTE_COW     0x200       // shared copy-on-write (available bit)
+#define PTE_FRAME   0xfffff000  // page frame (or page table) address
+
+// sizes and shifts
+
+#define SZ_BIGPAGE  0x00400000  // one directory entry's worth
+#define PDE_SHIFT   22
+#define PTE_SHIFT   12
+#define N_PDES      1024
+#define N_PTES      1024
+
+#define PDX(a)      (((uint32_t) (a)) >> PDE_SHIFT)
+#define PTX(a)      ((((uint32_t) (a)) >> PTE_SHIFT) & (N_PTES - 1))
+
+// page fault error code bits
+
+#define PF_PRESENT  0x01        // protection violation (else not present)
+#define PF_WRITE    0x02        // caused by a write
+
+// the user window
+//
+// these addresses are never handed out by kmem, because the identity
+// mapping of them is hidden in every process' address space
+
+#define VM_WINDOW       0xbfc00000
+#define VM_WINDOW_END   0xc0000000
+
+// the data segment starts at the bottom of the window
+
+#define VM_DATA         VM_WINDOW
+
+// everything from the top of the window to 4GB is assumed to be
+// device memory (local and I/O APICs, PCI BARs, the VGA frame
+// buffer), and is mapped uncached
+
+#define VM_MMIO         VM_WINDOW_END
+
+#ifndef SP_ASM_SRC
+
+/*
+** Start of C-only definitions
+*/
+
+#include "common.h"
+
+// where each process' stack is mapped (see stacks.h for SZ_STACK)
+
+#define VM_STACK        (VM_WINDOW_END - SZ_STACK)
+
+// the largest the data segment can get (leaving an unmapped page
+// below the stack)
+
+#define VM_DATA_MAX     (VM_STACK - SZ_PAGE)
+
+/*
+** Types
+*/
+
+// (avoids a circular dependency with process.h)
+struct pcb_s;
+
+/*
+** Globals
+*/
+
+// the template page directory, used by itself when no process is current
+
+extern uint32_t *_vm_kernel_pd;
+
+/*
+** Prototypes
+*/
+
+/**
+** _vm_init() - build the kernel page directory and enable paging
+**              on the bootstrap CPU
+**
+** Dependencies:
+**    Must follow the kmem module
+**    Must precede process creation and _smp_start()
+*/
+void _vm_init( void );
+
+/**
+** _vm_cpu_init() - enable paging on an application processor
+*/
+void _vm_cpu_init( void );
+
+/**
+** _vm_create() - create the address space for a process
+**
+** The process' stack must already have been allocated; it is mapped
+** at VM_STACK.
+**
+** @param pcb   The process
+**
+** @return status of the creation attempt
+*/
+status_t _vm_create( struct pcb_s *pcb );
+
+/**
+** _vm_fork() - create the address space for a new child process
+**
+** The child's stack must already have been allocated and filled in.
+** Its data segment is a copy of the parent's, made now or on demand
+** according to the current fork mode.
+**
+** @param parent  The parent process
+** @param child   The new child
+**
+** @return status of the creation attempt
+*/
+status_t _vm_fork( struct pcb_s *parent, struct pcb_s *child );
+
+/**
+** _vm_setfork() - select how fork() copies the data segment
+**
+** @param mode  The new mode (ForkCopy or ForkCOW)
+**
+** @return the previous mode, or E_BAD_PARAM
+*/
+int _vm_setfork( int mode );
+
+/**
+** _vm_sbrk() - grow or shrink a process' data segment
+**
+** The increment is rounded to whole pages (see sbrk() in ulib.h);
+** new pages are zeroed.
+**
+** @param pcb        The process
+** @param increment  Number of bytes to add (or remove, if negative)
+**
+** @return the previous end of the data segment, or 0 on failure
+*/
+uint32_t _vm_sbrk( struct pcb_s *pcb, int32_t increment );
+
+/**
+** _vm_exec() - discard a process' data segment, as part of exec()
+**
+** @param pcb   The process
+*/
+void _vm_exec( struct pcb_s *pcb );
+
+/**
+** _vm_touch() - make sure none of a range of a process' pages are
+**               shared, so that the kernel can write into them
+**
+** @param pcb     The process (must be current on this CPU)
+** @param addr    Start of the range
+** @param length  Its length, in bytes
+**
+** @return status of the operation (only fails if memory runs out)
+*/
+status_t _vm_touch( struct pcb_s *pcb, const void *addr, uint32_t length );
+
+/**
+** _vm_destroy() - release a process' address space
+**
+** @param pcb   The process
+*/
+void _vm_destroy( struct pcb_s *pcb );
+
+/**
+** _vm_kaddr() - translate an address in a process' address space
+**               into one the kernel can use from any address space
+**
+** Intended for writing a single word into a process that may not be
+** current; a shared data page is unshared first.
+**
+** @param pcb   The process
+** @param addr  The address, as the process sees it
+**
+** @return the equivalent identity-mapped address, or NULL if the
+**         address is not mapped (or memory ran out)
+*/
+void *_vm_kaddr( struct pcb_s *pcb, const void *addr );
+
+/**
+** _vm_dump() - dump the copy-on-write statistics to the console
+*/
+void _vm_dump( void );
+
+#endif
+/* SP_ASM_SRC */
+
+#endif
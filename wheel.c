@@ -0,0 +1,534 @@
+/**
+** @file wheel.c
+**
+** @author CSCI-452 class of 20215
+**
+** Timing wheel module implementation
+*/
+
+#define SP_KERNEL_SRC
+
+#include "common.h"
+
+#include "wheel.h"
+#include "slab.h"
+
+/*
+** PRIVATE DEFINITIONS
+*/
+
+/*
+** Wheel organization
+** ------------------
+** This is a hierarchical timing wheel.  The near wheel has one slot
+** per tick; an object due within WHEEL_NEAR_SLOTS ticks of the wheel's
+** current time goes in the slot for its exact expiration time.  Each
+** outer wheel has WHEEL_OUTER_SLOTS slots, each covering one complete
+** revolution of the next-inner wheel; objects further in the future go
+** in the slot of the innermost wheel that can reach them.
+**
+** Each time the near wheel wraps around to slot 0, the current slot of
+** the first outer wheel is emptied and its objects are re-added, which
+** moves them to the near wheel; when that wheel wraps, the same is done
+** for the next wheel out, and so on ("cascading").  Each object is thus
+** moved at most WHEEL_OUTER times before it expires.
+**
+** Every slot is a circular doubly-linked list with a sentinel node, so
+** an object can be removed without knowing which slot it is in.  A
+** bitmap records which slots are non-empty, so finding the next
+** occupied slot doesn't require examining each one.
+**
+** Times are compared as signed differences, so the wheel keeps working
+** when the 32-bit tick counter wraps around.
+*/
+
+// total number of slots, and the index of the first slot of each wheel
+
+#define N_SLOTS     (WHEEL_NEAR_SLOTS + WHEEL_OUTER * WHEEL_OUTER_SLOTS)
+
+#define FIRST_SLOT(l)   ((l) == 0 ? 0 : \
+                         WHEEL_NEAR_SLOTS + ((l) - 1) * WHEEL_OUTER_SLOTS)
+
+// number of slots in wheel 'l'
+
+#define NSLOTS(l)   ((l) == 0 ? WHEEL_NEAR_SLOTS : WHEEL_OUTER_SLOTS)
+
+// bit position of the time field that selects a slot in wheel 'l'
+
+#define SHIFT(l)    ((l) == 0 ? 0 : \
+                     WHEEL_NEAR_BITS + ((l) - 1) * WHEEL_OUTER_BITS)
+
+// the slot in wheel 'l' for time 't'
+
+#define SLOT(l,t)   (FIRST_SLOT(l) + (((t) >> SHIFT(l)) & (NSLOTS(l) - 1)))
+
+// the span of times that wheels 0 through l can hold
+
+#define RANGE(l)    (1U << (SHIFT(l) + ((l) == 0 ? WHEEL_NEAR_BITS : \
+                                                   WHEEL_OUTER_BITS)))
+
+// number of words in the slot bitmap
+
+#define MAP_WORDS   (N_SLOTS / 32)
+
+// converters:  object to its link, and vice versa
+#define LINK(w,d)   ((wlink_t *) (((uint8_t *) (d)) + (w)->offset))
+#define OBJ(w,l)    ((void *) (((uint8_t *) (l)) - (w)->offset))
+
+// is time 'a' before time 'b'?
+#define BEFORE(a,b) ((int32_t) ((a) - (b)) < 0)
+
+/*
+** PRIVATE DATA TYPES
+*/
+
+// the wheel itself
+typedef struct wheel_s {
+    wlink_t slots[N_SLOTS];     // sentinels for the slot lists
+    wlink_t expired;            // sentinel for the list of expired objects
+    uint32_t map[MAP_WORDS];    // bitmap of non-empty slots
+    time_t now;                 // next time to be processed
+    uint_t count;               // number of objects on the wheel
+    uint32_t offset;            // offset of wlink_t within objects
+} winfo_t;
+
+/*
+** PRIVATE GLOBAL VARIABLES
+*/
+
+/*
+** PUBLIC GLOBAL VARIABLES
+*/
+
+/*
+** PRIVATE FUNCTIONS
+*/
+
+/**
+** _list_init() - make an empty list
+*/
+static void _list_init( wlink_t *head ) {
+    head->next = head->prev = head;
+}
+
+/**
+** _list_append() - add a link at the end of a list
+*/
+static void _list_append( wlink_t *head, wlink_t *wl ) {
+    wl->next = head;
+    wl->prev = head->prev;
+    head->prev->next = wl;
+    head->prev = wl;
+}
+
+/**
+** _list_unlink() - remove a link from whatever list it is on
+*/
+static void _list_unlink( wlink_t *wl ) {
+    wl->prev->next = wl->next;
+    wl->next->prev = wl->prev;
+    wl->next = wl->prev = NULL;
+}
+
+/**
+** _list_splice() - move the contents of one list to the end of another
+*/
+static void _list_splice( wlink_t *to, wlink_t *from ) {
+    if( from->next == from ) {
+        return;
+    }
+    from->next->prev = to->prev;
+    to->prev->next = from->next;
+    from->prev->next = to;
+    to->prev = from->prev;
+    _list_init( from );
+}
+
+/**
+** _map_find() - find the first occupied slot in one wheel
+**
+** Searches circularly, starting at a specified slot.
+**
+** @param w      The wheel
+** @param l      Which wheel (0 is the near wheel)
+** @param start  Index (within that wheel) of the slot to start at
+**
+** @return the distance from 'start' to the first occupied slot,
+**         or -1 if all of the slots are empty
+*/
+static int _map_find( wheel_t w, int l, int start ) {
+    uint32_t *map = &w->map[FIRST_SLOT(l) / 32];
+    int nwords = NSLOTS(l) / 32;
+    uint32_t low = (1U << (start & 31)) - 1;
+
+    // the first word is examined twice:  first the part at or
+    // after 'start', and (at the very end) the part before it
+    for( int i = 0; i <= nwords; ++i ) {
+        int word = ((start >> 5) + i) & (nwords - 1);
+        uint32_t bits = map[word];
+        if( i == 0 ) {
+            bits &= ~low;
+        } else if( i == nwords ) {
+            bits &= low;
+        }
+        if( bits != 0 ) {
+            int slot = (word << 5) + __bsf( bits );
+            return( (slot - start) & (NSLOTS(l) - 1) );
+        }
+    }
+
+    return( -1 );
+}
+
+/**
+** _place() - put a link into the appropriate slot
+**
+** @param w    The wheel
+** @param wl   The link (whose expiration time is set)
+*/
+static void _place( wheel_t w, wlink_t *wl ) {
+    time_t t = wl->expires;
+    uint32_t delta = t - w->now;
+    int slot;
+
+    if( BEFORE(t,w->now) ) {
+        // already due
+        _list_append( &w->expired, wl );
+        return;
+    }
+
+    if( delta < RANGE(0) ) {
+        slot = SLOT( 0, t );
+    } else {
+        int l;
+        for( l = 1; l < WHEEL_OUTER && delta >= RANGE(l); ++l ) {
+            ;
+        }
+        if( delta >= RANGE(l) ) {
+            // too far out:  park it in the furthest slot we have
+            t = w->now + RANGE(l) - 1;
+        }
+        slot = SLOT( l, t );
+    }
+
+    _list_append( &w->slots[slot], wl );
+    w->map[slot >> 5] |= 1U << (slot & 31);
+}
+
+/**
+** _cascade() - re-add everything in one slot of an outer wheel
+**
+** @param w      The wheel
+** @param l      Which wheel
+**
+** @return the index (within that wheel) of the slot that was emptied
+*/
+static int _cascade( wheel_t w, int l ) {
+    int index = (w->now >> SHIFT(l)) & (NSLOTS(l) - 1);
+    int slot = FIRST_SLOT(l) + index;
+    wlink_t list;
+
+    // take the whole list, then distribute its members
+    _list_init( &list );
+    _list_splice( &list, &w->slots[slot] );
+    w->map[slot >> 5] &= ~(1U << (slot & 31));
+
+    while( list.next != &list ) {
+        wlink_t *wl = list.next;
+        _list_unlink( wl );
+        _place( w, wl );
+    }
+
+    return( index );
+}
+
+/**
+** _tick() - process the wheel's current time, then advance it
+**
+** @param w   The wheel
+*/
+static void _tick( wheel_t w ) {
+    int index = w->now & (WHEEL_NEAR_SLOTS - 1);
+
+    // at the start of each near-wheel revolution, pull in the
+    // objects due during that revolution from the outer wheels
+    if( index == 0 ) {
+        for( int l = 1; l <= WHEEL_OUTER && _cascade(w,l) == 0; ++l ) {
+            ;
+        }
+    }
+
+    // everything in the current near slot is due now
+    if( w->slots[index].next != &w->slots[index] ) {
+        _list_splice( &w->expired, &w->slots[index] );
+        w->map[index >> 5] &= ~(1U << (index & 31));
+    }
+
+    w->now += 1;
+}
+
+/**
+** _soonest() - the next time at which the wheel has work to do
+**
+** That is the earliest of the expiration time of the first object in
+** the near wheel and the times at which non-empty outer wheel slots
+** are due to be cascaded.
+**
+** @param w    The wheel
+** @param when (output) The time
+**
+** @return true if there is such a time, else false
+*/
+static bool_t _soonest( wheel_t w, time_t *when ) {
+    bool_t found = false;
+    int d;
+
+    // near wheel:  the exact expiration time
+    d = _map_find( w, 0, w->now & (WHEEL_NEAR_SLOTS - 1) );
+    if( d >= 0 ) {
+        *when = w->now + d;
+        found = true;
+    }
+
+    // outer wheels:  the time at which the slot will cascade
+    for( int l = 1; l <= WHEEL_OUTER; ++l ) {
+        uint32_t period = w->now >> SHIFT(l);
+
+        // unless we're sitting at the start of a period (whose
+        // cascade hasn't happened yet), the current slot has already
+        // been cascaded, so start looking at the next one
+        if( (w->now & ((1U << SHIFT(l)) - 1)) != 0 ) {
+            period += 1;
+        }
+
+        d = _map_find( w, l, period & (NSLOTS(l) - 1) );
+        if( d >= 0 ) {
+            time_t t = (period + d) << SHIFT(l);
+            if( !found || BEFORE(t,*when) ) {
+                *when = t;
+                found = true;
+            }
+        }
+    }
+
+    return( found );
+}
+
+/*
+** PUBLIC FUNCTIONS
+*/
+
+/**
+** _wheel_create() - allocate a timing wheel
+**
+** @param offset  Offset of the wlink_t within each object
+** @param now     The current time
+**
+** @return the new wheel, or NULL
+*/
+wheel_t _wheel_create( uint32_t offset, time_t now ) {
+    wheel_t w = (wheel_t) _kzalloc( sizeof(winfo_t) );
+
+    if( w == NULL ) {
+        return( NULL );
+    }
+
+    for( int i = 0; i < N_SLOTS; ++i ) {
+        _list_init( &w->slots[i] );
+    }
+    _list_init( &w->expired );
+
+    w->now = now;
+    w->offset = offset;
+
+    return( w );
+}
+
+/**
+** _wheel_delete() - deallocate a timing wheel
+**
+** @param w   The wheel
+*/
+void _wheel_delete( wheel_t w ) {
+
+    // sanity check!
+    assert1( w != NULL );
+
+    _kfree( w );
+}
+
+/**
+** _wheel_add() - add an object to a wheel
+**
+** @param w        The wheel
+** @param data     The object
+** @param expires  When the object is to be expired
+*/
+void _wheel_add( wheel_t w, void *data, time_t expires ) {
+    wlink_t *wl = LINK( w, data );
+
+    // sanity check!
+    assert1( w != NULL );
+
+    // an object can only be on one wheel at a time
+    assert( wl->next == NULL );
+
+    wl->expires = expires;
+    _place( w, wl );
+    w->count += 1;
+}
+
+/**
+** _wheel_cancel() - remove an object from a wheel before it expires
+**
+** @param w     The wheel
+** @param data  The object
+**
+** @return the object, or NULL if it was not on the wheel
+*/
+void *_wheel_cancel( wheel_t w, void *data ) {
+    wlink_t *wl = LINK( w, data );
+
+    // sanity check!
+    assert1( w != NULL );
+
+    if( wl->next == NULL ) {
+        return( NULL );
+    }
+
+    // if this empties a slot, clear its bit in the map
+    wlink_t *head = wl->next;
+    _list_unlink( wl );
+    if( head->next == head && head >= w->slots && head < w->slots + N_SLOTS ) {
+        int slot = head - w->slots;
+        w->map[slot >> 5] &= ~(1U << (slot & 31));
+    }
+
+    w->count -= 1;
+
+    return( data );
+}
+
+/**
+** _wheel_expire() - retrieve an expired object
+**
+** @param w     The wheel
+** @param now   The current time
+**
+** @return an expired object, or NULL if there are no more
+*/
+void *_wheel_expire( wheel_t w, time_t now ) {
+
+    // sanity check!
+    assert1( w != NULL );
+
+    while( w->expired.next == &w->expired ) {
+        time_t next;
+
+        // have we caught up?
+        if( BEFORE(now,w->now) ) {
+            return( NULL );
+        }
+
+        // skip quickly over times when there's nothing to do
+        if( !_soonest(w,&next) ) {
+            w->now = now + 1;
+            return( NULL );
+        }
+        if( BEFORE(w->now,next) ) {
+            w->now = BEFORE(now,next) ? now : next;
+        }
+
+        _tick( w );
+    }
+
+    wlink_t *wl = w->expired.next;
+    _list_unlink( wl );
+    w->count -= 1;
+
+    return( OBJ(w,wl) );
+}
+
+/**
+** _wheel_next() - when might the next object expire?
+**
+** @param w     The wheel
+** @param when  (output) The time
+**
+** @return E_SUCCESS, or E_EMPTY if the wheel holds no objects
+*/
+status_t _wheel_next( wheel_t w, time_t *when ) {
+
+    // sanity check!
+    assert1( w != NULL );
+    assert1( when != NULL );
+
+    if( w->count == 0 ) {
+        return( E_EMPTY );
+    }
+
+    // anything already expired is due immediately
+    if( w->expired.next != &w->expired ) {
+        *when = w->now;
+        return( E_SUCCESS );
+    }
+
+    return( _soonest(w,when) ? E_SUCCESS : E_EMPTY );
+}
+
+/**
+** _wheel_length() - number of objects held by a wheel
+**
+** @param w   The wheel
+*/
+uint_t _wheel_length( wheel_t w ) {
+
+    // sanity check!
+    assert1( w != NULL );
+
+    return( w->count );
+}
+
+/*
+** Debugging/tracing routines
+*/
+
+/**
+** _wheel_dump(msg,w)
+**
+** dump the contents of the specified wheel to the console
+**
+** @param msg  Optional message to print
+** @param w    Wheel to dump
+*/
+void _wheel_dump( const char *msg, wheel_t w ) {
+    time_t next;
+
+    __cio_printf( "%s: ", msg );
+    if( w == NULL ) {
+        __cio_puts( "NULL???\n" );
+        return;
+    }
+
+    __cio_printf( "wheel %08x now %d count %d", (uint32_t) w, w->now,
+                  w->count );
+
+    if( _wheel_next(w,&next) == E_SUCCESS ) {
+        __cio_printf( " next %d", next );
+    }
+
+    // number of occupied slots in each wheel
+    __cio_puts( " slots:" );
+    for( int l = 0; l <= WHEEL_OUTER; ++l ) {
+        int n = 0;
+        for( int i = 0; i < NSLOTS(l); ++i ) {
+            int slot = FIRST_SLOT(l) + i;
+            if( w->map[slot >> 5] & (1U << (slot & 31)) ) {
+                ++n;
+            }
+        }
+        __cio_printf( " %d", n );
+    }
+
+    __cio_putchar( '\n' );
+}
@@ -0,0 +1,160 @@
+/**
+** @file wheel.h
+**
+** @author CSCI-452 class of 20215
+**
+** Timing wheel module declarations
+**
+** A timing wheel holds objects until a specified expiration time.
+** Like an intrusive queue, it links objects through a structure
+** (a wlink_t) embedded in each one, so adding an object never
+** allocates memory.  Insertion and cancellation take O(1) time,
+** and expiration takes amortized O(1) time per object.
+*/
+
+#ifndef WHEEL_H_
+#define WHEEL_H_
+
+/*
+** General (C and/or assembly) definitions
+*/
+
+// number of slots in the innermost wheel (one tick per slot), and
+// in each of the outer wheels (each slot spanning a full revolution
+// of the next-inner wheel)
+
+#define WHEEL_NEAR_BITS     8
+#define WHEEL_OUTER_BITS    6
+
+#define WHEEL_NEAR_SLOTS    (1 << WHEEL_NEAR_BITS)
+#define WHEEL_OUTER_SLOTS   (1 << WHEEL_OUTER_BITS)
+
+// number of outer wheels; times beyond the range of the outermost
+// wheel (2^26 ticks, about 18 hours at 1KHz) are parked in its last
+// slot and re-examined whenever that slot comes around
+
+#define WHEEL_OUTER         3
+
+#ifndef SP_ASM_SRC
+
+/*
+** Start of C-only definitions
+*/
+
+/*
+** Types
+*/
+
+// link embedded in each object held by a wheel; the contents are
+// private to the wheel module, and must be all zeroes when the
+// object is not on a wheel
+
+typedef struct wlink_s {
+    struct wlink_s *next;   // successor in this slot
+    struct wlink_s *prev;   // predecessor in this slot
+    time_t expires;         // expiration time
+} wlink_t;
+
+// the wheel itself is opaque to the rest of the system
+
+typedef struct wheel_s *wheel_t;
+
+// WLINK_OFFSET(type,member) -- offset of a wlink_t within a structure
+
+#define WLINK_OFFSET(type,member)   ((uint32_t) &(((type *) 0)->member))
+
+/*
+** Globals
+*/
+
+/*
+** Prototypes
+*/
+
+/**
+** _wheel_create() - allocate a timing wheel
+**
+** @param offset  Offset of the wlink_t within each object
+** @param now     The current time
+**
+** @return the new wheel, or NULL
+*/
+wheel_t _wheel_create( uint32_t offset, time_t now );
+
+/**
+** _wheel_delete() - deallocate a timing wheel
+**
+** The wheel should be empty; objects still on it are abandoned.
+**
+** @param w   The wheel
+*/
+void _wheel_delete( wheel_t w );
+
+/**
+** _wheel_add() - add an object to a wheel
+**
+** @param w        The wheel
+** @param data     The object
+** @param expires  When the object is to be expired
+*/
+void _wheel_add( wheel_t w, void *data, time_t expires );
+
+/**
+** _wheel_cancel() - remove an object from a wheel before it expires
+**
+** @param w     The wheel
+** @param data  The object
+**
+** @return the object, or NULL if it was not on the wheel
+*/
+void *_wheel_cancel( wheel_t w, void *data );
+
+/**
+** _wheel_expire() - retrieve an expired object
+**
+** Advances the wheel to the specified time.  Objects whose times
+** have arrived are returned one per call, in order of expiration
+** time (and in order of insertion for equal times).
+**
+** @param w     The wheel
+** @param now   The current time
+**
+** @return an expired object, or NULL if there are no more
+*/
+void *_wheel_expire( wheel_t w, time_t now );
+
+/**
+** _wheel_next() - when might the next object expire?
+**
+** The result is exact if an object is due within the next
+** WHEEL_NEAR_SLOTS ticks; otherwise, it is the time at which the
+** wheel must next be advanced to move objects toward expiration.
+**
+** @param w     The wheel
+** @param when  (output) The time
+**
+** @return E_SUCCESS, or E_EMPTY if the wheel holds no objects
+*/
+status_t _wheel_next( wheel_t w, time_t *when );
+
+/**
+** _wheel_length() - number of objects held by a wheel
+**
+** @param w   The wheel
+*/
+uint_t _wheel_length( wheel_t w );
+
+/**
+** _wheel_dump(msg,w)
+**
+** dump the contents of the specified wheel to the console
+**
+** @param msg  Optional message to print
+** @param w    Wheel to dump
+*/
+void _wheel_dump( const char *msg, wheel_t w );
+
+#endif
+/* SP_ASM_SRC */
+
+#endif
@@ -107,6 +107,14 @@
 #define CR4_PVI		0x00000002
 #define CR4_VME		0x00000001
 
+/*
+** CPUID function 1 feature flags (EDX)
+**
+** IA-32 V2, CPUID instruction.
+*/
+#define	CPUID_1_EDX_PSE	0x00000008
+#define	CPUID_1_EDX_PGE	0x00002000
+
 /*
 ** PMode segment selectors
 **